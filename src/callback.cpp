@@ -16,22 +16,59 @@
 
 #include "nuria/callback.hpp"
 
+#include <QFutureInterface>
+#include <QCoreApplication>
+#include <QVarLengthArray>
 #include <QMetaMethod>
 #include <QMetaObject>
+#include <QSemaphore>
+#include <QMutex>
+#include <QEvent>
+#include <QHash>
 #include <QAtomicInt>
 #include <QPointer>
 #include <QThread>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
 
+#include "private/argumentplan.hpp"
 #include "nuria/logger.hpp"
 
 // Callback types. We store them outside to easily add more options in the
 // future without rendering the Callback to be too heavy.
+typedef void (*StaticMetacall) (QObject *, QMetaObject::Call, int, void **);
 struct CallbackSlot {
 	Qt::ConnectionType type;
 	QPointer< QObject > qobj;
 	QMetaMethod method;
 	const char *name;
 	
+	// Resolved once in Callback::setCallback()
+	int methodIndex; // Absolute index
+	int relativeIndex; // Index relative to the enclosing meta object
+	StaticMetacall callFunction; // qt_static_metacall() of it, may be NULL
+	
+	void invoke (QObject *receiver, void **args) const {
+		if (callFunction) {
+			callFunction (receiver, QMetaObject::InvokeMetaMethod, relativeIndex, args);
+		} else {
+			QMetaObject::metacall (receiver, QMetaObject::InvokeMetaMethod, methodIndex, args);
+		}
+		
+	}
+	
+};
+
+using namespace Nuria::Internal;
+
+// An argument bound using Callback::bind(). This is either a constant value,
+// or a placeholder passing on the incoming argument at 'source'.
+struct BoundArgument {
+	void *value; // NULL for placeholders
+	int type;
+	int source; // -1 for constants
+	bool isInline;
 };
 
 // 
@@ -39,11 +76,19 @@ namespace Nuria {
 class CallbackPrivate : public QSharedData {
 public:
 	
+	// Trampolines up to this size are stored in-place.
+	enum { InlineTrampolineSize = 6 * sizeof(void *) };
+	
+	// Bound values are stored in-place as long as they fit.
+	enum { InlineBoundSize = 64, BoundAlignment = 16 };
+	
 	~CallbackPrivate () {
 		clear ();
 		freeBoundValues ();
 	}
 	
+	ArgumentPlan *buildPlan (const int *key, int count) const;
+	
 	void clear () {
 		switch (type) {
 		case Callback::Invalid: break;
@@ -51,25 +96,71 @@ public:
 			delete ptr.slot;
 			break;
 		default:
-			delete ptr.base;
+			ptr.base->~TrampolineBase ();
+			if (ptr.base != reinterpret_cast< Callback::TrampolineBase * > (trampolineStorage)) {
+				::operator delete (ptr.base);
+			}
+			
 			break;
 		}
 		
+		type = Callback::Invalid;
+		retType = 0;
+		args.resize (0);
+		plans.clear ();
 	}
 	
-	void freeBoundValues () {
-		for (int i = 0; i < boundCount; i++) {
-			QMetaType::destroy (boundTypes[i], boundValues[i]);
+	bool takesArgumentView () const {
+		int viewType = qMetaTypeId< Nuria::ArgumentView > ();
+		return std::find (args.begin (), args.end (), viewType) != args.end ();
+	}
+	
+	void *allocateTrampoline (size_t size) {
+		if (size <= InlineTrampolineSize) {
+			return trampolineStorage;
 		}
 		
-		// 
-		delete[] boundValues;
-		delete[] boundTypes;
+		return ::operator new (size);
+	}
+	
+	void addBoundValue (int valueType, const void *copy) {
+		int size = QMetaType::sizeOf (valueType);
+		int aligned = (size + BoundAlignment - 1) & ~(BoundAlignment - 1);
+		
+		if (size > 0 && boundStorageUsed + aligned <= InlineBoundSize) {
+			void *where = boundStorage + boundStorageUsed;
+			boundStorageUsed += aligned;
+			
+			bound.append (BoundArgument { QMetaType::construct (valueType, where, copy), valueType, -1, true });
+		} else {
+			bound.append (BoundArgument { QMetaType::create (valueType, copy), valueType, -1, false });
+		}
+		
+	}
+	
+	void addPlaceholder (int source) {
+		usesPlaceholders = usesPlaceholders || (bound.size () < args.size ());
+		bound.append (BoundArgument { nullptr, 0, source, false });
+	}
+	
+	void freeBoundValues () {
+		for (int i = 0; i < bound.size (); i++) {
+			const BoundArgument &cur = bound.at (i);
+			if (cur.source >= 0) {
+				continue;
+			} else if (cur.isInline) {
+				QMetaType::destruct (cur.type, cur.value);
+			} else {
+				QMetaType::destroy (cur.type, cur.value);
+			}
+			
+		}
 		
 		// 
-		boundValues = nullptr;
-		boundTypes = nullptr;
-		boundCount = 0;
+		bound.resize (0);
+		boundStorageUsed = 0;
+		usesPlaceholders = false;
+		plans.clear ();
 	}
 	
 	// Data
@@ -79,18 +170,95 @@ public:
 		CallbackSlot *slot;
 	} ptr;
 	
+	alignas(std::max_align_t) char trampolineStorage[InlineTrampolineSize];
+	
 	// Binding
-	void **boundValues = nullptr;
-	int *boundTypes = nullptr;
-	int boundCount = 0;
+	QVarLengthArray< BoundArgument, 4 > bound;
+	alignas(std::max_align_t) char boundStorage[InlineBoundSize];
+	int boundStorageUsed = 0;
+	bool usesPlaceholders = false;
 	bool variadic = false;
 	
 	// 
 	int retType = 0;
-	QList< int > args;
+	QVarLengthArray< int, 8 > args;
+	
+	// Conversion plans
+	ArgumentPlanCache plans;
 };
 }
 
+Nuria::ArgumentView::ArgumentView (int count, void **args, const int *types)
+	: m_count (count), m_args (args), m_types (types)
+{
+	
+}
+
+Nuria::ArgumentView::ArgumentView (const QVariantList &list)
+	: m_count (list.length ()), m_list (&list)
+{
+	
+}
+
+int Nuria::ArgumentView::count () const {
+	return this->m_count;
+}
+
+bool Nuria::ArgumentView::isEmpty () const {
+	return (this->m_count == 0);
+}
+
+int Nuria::ArgumentView::type (int index) const {
+	if (this->m_list) {
+		return this->m_list->at (index).userType ();
+	}
+	
+	int type = this->m_types[index];
+	if (type == QMetaType::QVariant) {
+		return reinterpret_cast< QVariant * > (this->m_args[index])->userType ();
+	}
+	
+	return type;
+}
+
+const void *Nuria::ArgumentView::data (int index) const {
+	if (this->m_list) {
+		return this->m_list->at (index).constData ();
+	}
+	
+	if (this->m_types[index] == QMetaType::QVariant) {
+		return reinterpret_cast< QVariant * > (this->m_args[index])->constData ();
+	}
+	
+	return this->m_args[index];
+}
+
+QVariant Nuria::ArgumentView::at (int index) const {
+	if (this->m_list) {
+		return this->m_list->at (index);
+	}
+	
+	if (this->m_types[index] == QMetaType::QVariant) {
+		return *reinterpret_cast< QVariant * > (this->m_args[index]);
+	}
+	
+	return QVariant (this->m_types[index], this->m_args[index]);
+}
+
+QVariantList Nuria::ArgumentView::toList () const {
+	if (this->m_list) {
+		return *this->m_list;
+	}
+	
+	QVariantList list;
+	list.reserve (this->m_count);
+	for (int i = 0; i < this->m_count; i++) {
+		list.append (at (i));
+	}
+	
+	return list;
+}
+
 Nuria::Callback::Callback ()
 	: d (new CallbackPrivate)
 {
@@ -157,7 +325,14 @@ int Nuria::Callback::returnType () const {
 }
 
 QList< int > Nuria::Callback::argumentTypes () const {
-	return this->d->args;
+	QList< int > list;
+	list.reserve (this->d->args.size ());
+	
+	for (int i = 0; i < this->d->args.size (); i++) {
+		list.append (this->d->args.at (i));
+	}
+	
+	return list;
 }
 
 bool Nuria::Callback::setCallback (QObject *receiver, const char *slot, Qt::ConnectionType connectionType) {
@@ -194,7 +369,11 @@ bool Nuria::Callback::setCallback (QObject *receiver, const char *slot, Qt::Conn
 	}
 	
 	// Store slot method
+	const QMetaObject *enclosing = method.enclosingMetaObject ();
 	this->d->ptr.slot->method = method;
+	this->d->ptr.slot->methodIndex = idx;
+	this->d->ptr.slot->relativeIndex = idx - enclosing->methodOffset ();
+	this->d->ptr.slot->callFunction = enclosing->d.static_metacall;
 	
 	//
 	return true;
@@ -208,108 +387,65 @@ void Nuria::Callback::bindList (const QVariantList &arguments) {
 		return;
 	}
 	
-	// Acquire memory
+	// Compile the QVariantList into constants of the target types and
+	// indices of the arguments to pass on.
 	int count = arguments.length ();
-	void **args = new void *[count];
-	int *types = new int[count];
-	
-	// Convert the QVariantList...
 	for (int i = 0; i < count; i++) {
 		QVariant cur = arguments.at (i);
+		int type = cur.userType ();
 		
-		// Convert now if needed.
-		const void *instance = 0;
-		
-		if (cur.userType () == qMetaTypeId< Nuria::Callback::Placeholder > ()) {
-			args[i] = new Placeholder (cur.value< Placeholder > ());
-			types[i] = cur.userType ();
+		// Placeholder?
+		if (type == qMetaTypeId< Nuria::Callback::Placeholder > ()) {
+			this->d->addPlaceholder (*reinterpret_cast< const Placeholder * > (cur.constData ()));
 			continue;
-			
-		} else if (cur.userType () != this->d->args.at (i)) {
-			types[i] = cur.userType ();
-			
-			if (cur.convert (this->d->args.at (i))) {
-				instance = cur.constData ();
-				types[i] = this->d->args.at (i);
-			}
-			
-		} else {
-			types[i] = cur.userType ();
-			instance = cur.constData ();
+		}
+		
+		// Convert now if needed. Use a default constructed value if the
+		// conversion fails.
+		bool valid = true;
+		if (i < this->d->args.size () && type != this->d->args.at (i)) {
+			type = this->d->args.at (i);
+			valid = cur.convert (type);
 		}
 		
 		// Copy new instance...
-		args[i] = QMetaType::create (types[i], instance);
+		this->d->addBoundValue (type, valid ? cur.constData () : nullptr);
 	}
 	
-	// Store and done.
-	this->d->boundCount = count;
-	this->d->boundValues = args;
-	this->d->boundTypes = types;
-	
 }
 
-/**
- * Helper function. Puts \a value at \a pos into \a args.
- * If \a valType doesn't match \a type, it will be converted. If it can't be
- * converted, a default constructed value will be inserted and \c false will
- * be returned. \a off is the offset in \a args.
- */
-static bool argumentHelper (void **args, bool *delMe, void *value, int valType,
-			    int pos, int off, int type) {
+ArgumentPlan *Nuria::CallbackPrivate::buildPlan (const int *key, int count) const {
+	ArgumentPlan *plan = new ArgumentPlan;
+	plan->next = nullptr;
+	plan->key.append (key, count);
 	
-	// Construct anyway?
-	if (!value) {
-		void *inst = QMetaType::create (type, 0);
-		
-		args[pos + off] = inst;
-		delMe[pos] = true;
+	// Prepend bound variables...
+	int i = 0;
+	for (; i < this->bound.size () && i < this->args.size (); i++) {
+		const BoundArgument &cur = this->bound.at (i);
 		
-		if (type < QMetaType::Double) {
-			*(int *)inst = 0;
-		} else if (type == QMetaType::Double) {
-			*(double *)inst = 0.0f;
+		if (cur.source >= 0) {
+			plan->steps.append (planArgument (key, count, cur.source, this->args.at (i)));
+		} else {
+			plan->steps.append (ArgumentStep { ConstantArgument, -1, cur.type, this->args.at (i), false, cur.value });
 		}
 		
-		return false;
 	}
 	
-	// Expects a QVariant?
-	if (type == QMetaType::QVariant) {
-		args[pos + off] = (valType == QMetaType::QVariant)
-		                  ? reinterpret_cast< QVariant * > (value)
-		                  : new QVariant (valType, value);
-		delMe[pos] = (valType != QMetaType::QVariant);
-		return true;
-	}
-	
-	// Do we have the value in a QVariant?
-	if (valType == QMetaType::QVariant) {
-		QVariant *variant = reinterpret_cast< QVariant * > (value);
-		valType = variant->userType ();
-		value = const_cast< void * > (variant->constData ());
-	}
-	
-	// Check value
-	if (valType == type) {
-		args[pos + off] = value;
-		delMe[pos] = false;
-		return true;
-	}
-	
-	// Try to convert
-	QVariant v (valType, value);
-	if (!v.convert (type)) {
-		// Conversion failed.
-		return argumentHelper (args, delMe, 0, 0, pos, off, type);
+	// Construct arguments. Skip if placeholders are used.
+	if (!this->usesPlaceholders) {
+		for (int j = 0; i < this->args.size () && j < count; i++, j++) {
+			plan->steps.append (planArgument (key, count, j, this->args.at (i)));
+		}
 		
 	}
 	
-	// Conversion succeeded!
-	args[pos + off] = QMetaType::create (type, v.constData ());
+	// Not enough arguments?
+	for (; i < this->args.size (); i++) {
+		plan->steps.append (planArgument (key, count, -1, this->args.at (i)));
+	}
 	
-	delMe[pos] = true;
-	return true;
+	return plan;
 }
 
 QVariant Nuria::Callback::invoke (const QVariantList &arguments) const {
@@ -319,9 +455,18 @@ QVariant Nuria::Callback::invoke (const QVariantList &arguments) const {
 		return QVariant();
 	}
 	
-	// Is this a variadic callback?
+	// Is this a variadic callback? Pass the list itself on.
 	if (this->d->variadic) {
-		return invokePrepared ({ QVariant(arguments) });
+		if (this->d->takesArgumentView ()) {
+			ArgumentView view (arguments);
+			void *argument[] = { &view };
+			int type = qMetaTypeId< ArgumentView > ();
+			return invokeInternal (1, argument, &type);
+		}
+		
+		void *argument[] = { const_cast< QVariantList * > (&arguments) };
+		int type = QMetaType::QVariantList;
+		return invokeInternal (1, argument, &type);
 	}
 	
 	return invokePrepared (arguments);
@@ -350,7 +495,14 @@ QVariant Nuria::Callback::invoke (int count, void **args, int *types) const {
 		return QVariant();
 	}
 	
-	// Variadic?
+	// Variadic? Pass a view on the arguments if the target supports it.
+	if (this->d->variadic && this->d->takesArgumentView ()) {
+		ArgumentView view (count, args, types);
+		void *argument[] = { &view };
+		int type = qMetaTypeId< ArgumentView > ();
+		return invokeInternal (1, argument, &type);
+	}
+	
 	if (this->d->variadic) {
 		QVariantList list;
 		
@@ -370,39 +522,272 @@ QVariant Nuria::Callback::invoke (int count, void **args, int *types) const {
 	return invokeInternal (count, args, types);
 }
 
-class InvokeCleanupHelper {
-public:
-	void **values;
-	const QList< int > *types;
-	bool *remove;
+bool Nuria::Callback::isDirectlyInvokable () const {
+	return (this->d->type != Invalid && this->d->type != Slot &&
+	        !this->d->variadic && this->d->bound.isEmpty ());
+}
+
+bool Nuria::Callback::invokeDirect (int count, void **args, int *types) const {
+	if (!this->d->bound.isEmpty ()) {
+		return invokeBoundDirect (count, args, types);
+	}
+	
+	if (!isDirectlyInvokable () || this->d->retType != types[0] ||
+	    this->d->args.size () != count) {
+		return false;
+	}
+	
+	// Check argument types
+	for (int i = 0; i < count; i++) {
+		if (this->d->args.at (i) != types[i + 1]) {
+			return false;
+		}
+		
+	}
+	
+	// Invoke!
+	this->d->ptr.base->trampoline (args);
+	return true;
+}
+
+bool Nuria::Callback::invokeBoundDirect (int count, void **args, int *types) const {
+	if (this->d->type == Invalid || this->d->type == Slot || this->d->variadic ||
+	    this->d->retType != types[0]) {
+		return false;
+	}
+	
+	// Argument array, works like the one from qt_metacall().
+	int total = this->d->args.size ();
+	void *rawArgs[total + 1];
+	rawArgs[0] = args[0];
 	
-	InvokeCleanupHelper (void **arr, const QList< int > *type, bool *toRemove)
-		: values (arr), types (type), remove (toRemove) {}
+	// Constants already have the target type, passed-on arguments must
+	// match exactly.
+	int i = 0;
+	for (; i < this->d->bound.size () && i < total; i++) {
+		const BoundArgument &cur = this->d->bound.at (i);
+		if (cur.source < 0) {
+			rawArgs[i + 1] = cur.value;
+		} else if (cur.source < count && types[cur.source + 1] == this->d->args.at (i)) {
+			rawArgs[i + 1] = args[cur.source + 1];
+		} else {
+			return false;
+		}
+		
+	}
 	
-	~InvokeCleanupHelper () {
-		for (int i = 0; i < types->length (); i++) {
-			if (remove[i]) {
-				QMetaType::destroy (types->at (i), values[i + 1]);
+	// Append the remaining arguments. With placeholders, they would have
+	// to be default constructed.
+	if (this->d->usesPlaceholders) {
+		if (i < total) {
+			return false;
+		}
+		
+	} else {
+		if (count != total - i) {
+			return false;
+		}
+		
+		for (int j = 0; i < total; i++, j++) {
+			if (types[j + 1] != this->d->args.at (i)) {
+				return false;
 			}
 			
+			rawArgs[i + 1] = args[j + 1];
+		}
+		
+	}
+	
+	// Invoke!
+	this->d->ptr.base->trampoline (rawArgs);
+	return true;
+}
+
+namespace {
+
+// Event carrying a call, which is run in the thread of a CallbackDispatcher.
+class CallbackEvent : public QEvent {
+public:
+	CallbackEvent () : QEvent (eventType ()) {}
+	
+	virtual void run () = 0;
+	
+	static QEvent::Type eventType () {
+		static int type = QEvent::registerEventType ();
+		return QEvent::Type (type);
+	}
+	
+};
+
+// Runs CallbackEvents in the thread it lives in. There is one instance per
+// thread, which is created on demand and destroyed with the thread.
+class CallbackDispatcher : public QObject {
+public:
+	
+	bool event (QEvent *e) override {
+		if (e->type () == CallbackEvent::eventType ()) {
+			static_cast< CallbackEvent * > (e)->run ();
+			return true;
+		}
+		
+		return QObject::event (e);
+	}
+	
+	static void post (QThread *thread, CallbackEvent *event);
+	
+};
+
+// Queued call of a slot. The arguments are owned by the event unless the
+// caller waits on 'semaphore' for it to finish.
+class SlotCallEvent : public CallbackEvent {
+public:
+	
+	SlotCallEvent (const CallbackSlot *target)
+		: slot (*target)
+	{ }
+	
+	~SlotCallEvent () {
+		if (semaphore) {
+			semaphore->release ();
+			return;
+		}
+		
+		for (int i = 1; i < args.size (); i++) {
+			QMetaType::destroy (types.at (i - 1), args.at (i));
+		}
+		
+	}
+	
+	void run () override {
+		if (!slot.qobj.isNull ()) {
+			slot.invoke (slot.qobj, args.data ());
+		}
+		
+	}
+	
+	CallbackSlot slot;
+	QVarLengthArray< void *, 8 > args;
+	QVarLengthArray< int, 8 > types;
+	QSemaphore *semaphore = nullptr;
+	
+};
+
+// Call started by Callback::invokeAsync(), reporting the result to 'future'.
+// If the event is destroyed without having run, e.g. because its thread
+// finished first, the future is canceled.
+class AsyncCallEvent : public CallbackEvent {
+public:
+	
+	AsyncCallEvent (const Nuria::Callback &cb, const QVariantList &args)
+		: callback (cb), arguments (args)
+	{
+		future.reportStarted ();
+	}
+	
+	~AsyncCallEvent () {
+		if (!ran) {
+			future.reportCanceled ();
+			future.reportFinished ();
 		}
 		
 	}
 	
+	void run () override {
+		ran = true;
+		future.reportResult (callback.invoke (arguments));
+		future.reportFinished ();
+	}
+	
+	Nuria::Callback callback;
+	QVariantList arguments;
+	QFutureInterface< QVariant > future;
+	bool ran = false;
+	
 };
 
+}
+
+static QMutex g_dispatcherMutex;
+static QHash< QThread *, CallbackDispatcher * > g_dispatchers;
+
+// Destroys the dispatcher of 'thread' along with its pending events, which
+// cancels them. The dispatcher lock must be held.
+static void dropDispatcher (QThread *thread) {
+	delete g_dispatchers.take (thread);
+}
+
+void CallbackDispatcher::post (QThread *thread, CallbackEvent *event) {
+	QMutexLocker lock (&g_dispatcherMutex);
+	
+	CallbackDispatcher *&dispatcher = g_dispatchers[thread];
+	if (!dispatcher) {
+		dispatcher = new CallbackDispatcher;
+		dispatcher->moveToThread (thread);
+		
+		// 'finished' is emitted in 'thread' itself. Also drop it when the
+		// thread is destroyed without having run, so a new QThread at the
+		// same address doesn't inherit it. The dispatcher is the context,
+		// so the connections go away with it.
+		auto drop = [thread] () {
+			QMutexLocker lock (&g_dispatcherMutex);
+			dropDispatcher (thread);
+		};
+		
+		QObject::connect (thread, &QThread::finished, dispatcher, drop, Qt::DirectConnection);
+		QObject::connect (thread, &QObject::destroyed, dispatcher, drop, Qt::DirectConnection);
+	}
+	
+	// Events posted to a finished thread would never run. Also catches the
+	// thread finishing before the connections above were made.
+	if (thread->isFinished ()) {
+		dropDispatcher (thread);
+		delete event;
+		return;
+	}
+	
+	// Post while holding the lock, so the dispatcher can't vanish.
+	QCoreApplication::postEvent (dispatcher, event);
+}
+
+QFuture< QVariant > Nuria::Callback::invokeAsyncList (QThread *thread,
+                                                      const QVariantList &arguments) const {
+	
+	// Sanity check
+	if (this->d->type == Invalid) {
+		QFutureInterface< QVariant > future (QFutureInterfaceBase::Started);
+		future.reportResult (QVariant ());
+		future.reportFinished ();
+		return future.future ();
+	}
+	
+	// Find the target thread
+	if (!thread && this->d->type == Slot && !this->d->ptr.slot->qobj.isNull ()) {
+		thread = this->d->ptr.slot->qobj->thread ();
+	} else if (!thread) {
+		thread = QThread::currentThread ();
+	}
+	
+	// 
+	AsyncCallEvent *event = new AsyncCallEvent (*this, arguments);
+	QFuture< QVariant > future = event->future.future ();
+	
+	CallbackDispatcher::post (thread, event);
+	return future;
+}
+
 QVariant Nuria::Callback::invokeInternal (int count, void **args, int *types) const {
 	
 	// Argument array, works like the one from qt_metacall().
-	void *rawArgs[this->d->args.length () + 1];
-	bool removeMe[this->d->args.length ()];
+	void *rawArgs[this->d->args.size () + 1];
+	bool removeMe[this->d->args.size ()];
 	
 	// Will destroy all elements in rawArgs which are marked by 'removeMe'.
-	InvokeCleanupHelper cleaner (rawArgs, &this->d->args, removeMe);
+	ArgumentCleanup cleaner (rawArgs, this->d->args.constData (), this->d->args.size (), removeMe);
 	Q_UNUSED(cleaner);
 	
 	// Construct return value
 	QVariant retVal;
+	rawArgs[0] = nullptr;
 	if (this->d->retType == QMetaType::QVariant) {
 		rawArgs[0] = &retVal;
 	} else if (this->d->retType != 0 && this->d->retType != QMetaType::Void) {
@@ -410,106 +795,80 @@ QVariant Nuria::Callback::invokeInternal (int count, void **args, int *types) co
 		rawArgs[0] = retVal.data ();
 	}
 	
-	// 
-	int i = 0;
+	// Look up the conversion plan for the incoming types
+	int key[count + 1];
+	buildPlanKey (key, count, args, types);
 	
-	// Prepend bound variables...
-	bool usesPlaceholders = false;
-	
-	if (this->d->boundCount) {
-		for (; i < this->d->boundCount && i < this->d->args.length (); i++) {
-			void *curValue = this->d->boundValues[i];
-			int curType = this->d->boundTypes[i];
-			
-			int type = this->d->args.at (i);
-			
-			// Placeholder?
-			if (curType == qMetaTypeId< Nuria::Callback::Placeholder > ()) {
-				usesPlaceholders = true;
-				
-				Placeholder *p = reinterpret_cast< Nuria::Callback::Placeholder * > (curValue);
-				int pos = (int)(*p);
-				
-				// Out of boundaries?
-				if (pos < 0 || pos >= count) {
-					argumentHelper (rawArgs, removeMe, 0, 0, i, 1, type);
-				} else {
-					argumentHelper (rawArgs, removeMe, args[pos], types[pos], i, 1, type);
-				}
-				
-			} else {
-				
-				// Bound value
-				rawArgs[i + 1] = curValue;
-				removeMe[i] = false;
-				
-			}
-			
+	std::unique_ptr< ArgumentPlan > uncached;
+	const ArgumentPlan *plan = this->d->plans.find (key, count);
+	if (!plan) {
+		ArgumentPlan *built = this->d->buildPlan (key, count);
+		if (!this->d->plans.insert (built)) {
+			uncached.reset (built);
 		}
 		
+		plan = built;
 	}
 	
-	// Construct arguments. Skip if placeholders are used.
-	if (!usesPlaceholders) {
-		for (int j = 0; i < this->d->args.length () && j < count; i++, j++) {
-			int curType = this->d->args.at (i);
-			
-			argumentHelper (rawArgs, removeMe, args[j], types[j], i, 1, curType);
-			
-		}
-		
-	}
-	
-	// Not enough arguments?
-	for (; i < this->d->args.length (); i++) {
-		
-		// Construct default instance
-		argumentHelper (rawArgs, removeMe, 0, 0, i, 1, this->d->args.at (i));
-		
-	}
+	// Construct arguments
+	applyPlan (plan, args, rawArgs, removeMe);
 	
 	// Is this a slot?
 	if (this->d->type == Slot) {
 		
 		// Has the object been destroyed?
-		if (this->d->ptr.slot->qobj.isNull ()) {
+		CallbackSlot *slot = this->d->ptr.slot;
+		QObject *receiver = slot->qobj.data ();
+		if (!receiver) {
 			return QVariant();
 		}
 		
 		// Does the QObject live in another thread?
 		// Use call-and-forget if we don't expect a result.
 		bool voidRet = (this->d->retType == 0 || this->d->retType == QMetaType::Void);
-		Qt::ConnectionType type = this->d->ptr.slot->type;
+		Qt::ConnectionType type = slot->type;
 		if (type == Qt::AutoConnection) {
-			type = (this->d->ptr.slot->qobj->thread () == QThread::currentThread ())
+			type = (receiver->thread () == QThread::currentThread ())
 			       ? Qt::DirectConnection
 			       : (voidRet ? Qt::QueuedConnection : Qt::BlockingQueuedConnection);
 		}
 		
-		// Create array of generic arguments
-		QGenericArgument gArgs[10];
-		for (int j = 0; j < this->d->args.length (); j++) {
-			const char *name = QMetaType::typeName (this->d->args.at (j));
-			gArgs[j] = QGenericArgument (name, rawArgs[j + 1]);
+		// Invoke!
+		if (type == Qt::DirectConnection) {
+			slot->invoke (receiver, rawArgs);
+			return retVal;
 		}
 		
-		// Return value argument
-		QGenericReturnArgument retArg;
-		if (this->d->retType == QMetaType::QVariant) {
-			retArg = QGenericReturnArgument ("QVariant", &retVal);
-		} else if (!voidRet) {
-			retArg = QGenericReturnArgument (retVal.typeName (), retVal.data ());
+		// Queue the call in the thread of the receiver
+		bool blocking = (type == Qt::BlockingQueuedConnection);
+		if (blocking && receiver->thread () == QThread::currentThread ()) {
+			nError() << "Blocking call to slot" << slot->name << "on" << receiver
+			         << "from its own thread would deadlock";
+			return QVariant();
 		}
 		
-		// Invoke!
-		if (!this->d->ptr.slot->method.invoke (this->d->ptr.slot->qobj, type, retArg,
-		                                       gArgs[0], gArgs[1], gArgs[2], gArgs[3], gArgs[4],
-		                                       gArgs[5], gArgs[6], gArgs[7], gArgs[8], gArgs[9])) {
-			nError() << "Failed to invoke slot" << this->d->ptr.slot->name
-			         << "on" << this->d->ptr.slot->qobj;
+		SlotCallEvent *event = new SlotCallEvent (slot);
+		int total = this->d->args.size ();
+		event->args.resize (total + 1);
+		event->types.append (this->d->args.constData (), total);
+		
+		if (blocking) {
+			QSemaphore semaphore;
+			event->semaphore = &semaphore;
+			::memcpy (event->args.data (), rawArgs, (total + 1) * sizeof(void *));
+			
+			CallbackDispatcher::post (receiver->thread (), event);
+			semaphore.acquire ();
+			return retVal;
 		}
 		
-		// Done.
+		// The caller won't wait for the result, copy the arguments.
+		event->args[0] = nullptr;
+		for (int i = 0; i < total; i++) {
+			event->args[i + 1] = QMetaType::create (this->d->args.at (i), rawArgs[i + 1]);
+		}
+		
+		CallbackDispatcher::post (receiver->thread (), event);
 		return retVal;
 	}
 	
@@ -521,8 +880,7 @@ QVariant Nuria::Callback::invokeInternal (int count, void **args, int *types) co
 	
 }
 
-bool Nuria::Callback::initBase (Nuria::Callback::TrampolineBase *base,
-				 int retType, const QList< int > &args) {
+void *Nuria::Callback::prepareTrampoline (size_t size) {
 	
 	// 
 	if (!this->d) {
@@ -533,11 +891,17 @@ bool Nuria::Callback::initBase (Nuria::Callback::TrampolineBase *base,
 		this->d->clear ();
 	}
 	
+	return this->d->allocateTrampoline (size);
+}
+
+bool Nuria::Callback::initBase (Nuria::Callback::TrampolineBase *base,
+				 int retType, const int *args, int count) {
+	
 	// Type
 	this->d->type = base->type;
 	this->d->ptr.base = base;
 	
 	this->d->retType = retType;
-	this->d->args = args;
+	this->d->args.append (args, count);
 	return true;
 }
@@ -0,0 +1,331 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nuria/callbacklist.hpp"
+
+#include <QVarLengthArray>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QVector>
+#include <QMutex>
+#include <algorithm>
+#include <memory>
+
+#include "private/argumentplan.hpp"
+
+using namespace Nuria::Internal;
+
+namespace {
+
+// Consecutive callbacks sharing one signature. Callbacks which can't be invoked
+// directly get a group of their own, with 'direct' being false.
+struct CallbackGroup {
+	bool direct;
+	QVarLengthArray< int, 8 > types; // Laid out like in qt_metacall()
+	QVector< Nuria::Callback > callbacks;
+	ArgumentPlanCache plans;
+};
+
+// Immutable state of a CallbackList. Invocations use the one which was current
+// when they started.
+struct CallbackListSnapshot {
+	~CallbackListSnapshot () { qDeleteAll (groups); }
+	
+	QVector< CallbackGroup * > groups;
+};
+
+struct Subscriber {
+	int id;
+	Nuria::Callback callback;
+};
+
+}
+
+namespace Nuria {
+
+class CallbackListPrivate {
+public:
+	
+	~CallbackListPrivate () {
+		delete current.loadAcquire ();
+		qDeleteAll (retired);
+		qDeleteAll (draining);
+	}
+	
+	void publish ();
+	void reclaim ();
+	static void invokeGroup (const CallbackGroup *group, const int *key,
+	                         int count, void **args, int *types);
+	
+	// Writers only
+	QMutex mutex;
+	QVector< Subscriber > subscribers;
+	int nextId = 1;
+	
+	// Snapshots replaced in the current epoch, and in the one before.
+	QVector< CallbackListSnapshot * > retired;
+	QVector< CallbackListSnapshot * > draining;
+	
+	// Invocations. Running ones are counted per parity of the epoch they
+	// started in.
+	QAtomicPointer< CallbackListSnapshot > current;
+	QAtomicInt epoch;
+	QAtomicInt readers[2];
+	
+};
+
+}
+
+namespace {
+
+// Counts a running invocation in the current epoch for its lifetime.
+class ReaderGuard {
+public:
+	ReaderGuard (Nuria::CallbackListPrivate *d) : m_d (d) {
+		this->m_epoch = d->epoch.loadAcquire ();
+		
+		// Retry if the epoch changed while registering
+		for (;;) {
+			d->readers[this->m_epoch & 1].fetchAndAddOrdered (1);
+			int now = d->epoch.loadAcquire ();
+			if (now == this->m_epoch) {
+				break;
+			}
+			
+			d->readers[this->m_epoch & 1].fetchAndAddOrdered (-1);
+			this->m_epoch = now;
+		}
+		
+	}
+	
+	~ReaderGuard () { this->m_d->readers[this->m_epoch & 1].fetchAndAddOrdered (-1); }
+	
+private:
+	Nuria::CallbackListPrivate *m_d;
+	int m_epoch;
+};
+
+}
+
+void Nuria::CallbackListPrivate::publish () {
+	CallbackListSnapshot *snapshot = nullptr;
+	
+	// Group consecutive callbacks by signature, keeping the order.
+	if (!this->subscribers.isEmpty ()) {
+		snapshot = new CallbackListSnapshot;
+	}
+	
+	for (const Subscriber &cur : this->subscribers) {
+		const Callback &cb = cur.callback;
+		if (!cb.isValid ()) {
+			continue;
+		}
+		
+		// 
+		bool direct = cb.isDirectlyInvokable ();
+		int retType = cb.returnType ();
+		QList< int > argTypes = cb.argumentTypes ();
+		
+		CallbackGroup *group = snapshot->groups.isEmpty () ? nullptr : snapshot->groups.last ();
+		if (!direct || !group || !group->direct || group->types.size () != argTypes.size () + 1 ||
+		    group->types.at (0) != retType ||
+		    !std::equal (argTypes.constBegin (), argTypes.constEnd (), group->types.constData () + 1)) {
+			group = new CallbackGroup;
+			group->direct = direct;
+			group->types.append (retType);
+			for (int type : argTypes) {
+				group->types.append (type);
+			}
+			
+			snapshot->groups.append (group);
+		}
+		
+		group->callbacks.append (cb);
+	}
+	
+	// Publish, then free old snapshots no invocation can still see.
+	CallbackListSnapshot *old = this->current.fetchAndStoreOrdered (snapshot);
+	if (old) {
+		this->retired.append (old);
+	}
+	
+	reclaim ();
+	
+}
+
+void Nuria::CallbackListPrivate::reclaim () {
+	int cur = this->epoch.loadAcquire ();
+	
+	// Invocations which started two epochs ago may still be running. They
+	// share their counter with the next epoch.
+	if (this->readers[(cur + 1) & 1].fetchAndAddOrdered (0) != 0) {
+		return;
+	}
+	
+	// Snapshots replaced in the last epoch were seen by invocations of the
+	// last or this epoch at most. Invocations starting from now on only
+	// see the current snapshot.
+	qDeleteAll (this->draining);
+	this->draining = this->retired;
+	this->retired.clear ();
+	this->epoch.fetchAndStoreOrdered (cur + 1);
+	
+}
+
+void Nuria::CallbackListPrivate::invokeGroup (const CallbackGroup *group, const int *key,
+                                              int count, void **args, int *types) {
+	int total = group->types.size () - 1;
+	int *groupTypes = const_cast< int * > (group->types.constData ());
+	
+	// Look up the conversion plan for the incoming types
+	std::unique_ptr< ArgumentPlan > uncached;
+	const ArgumentPlan *plan = group->plans.find (key, count);
+	if (!plan) {
+		ArgumentPlan *built = buildSimplePlan (key, count, groupTypes + 1, total);
+		if (!group->plans.insert (built)) {
+			uncached.reset (built);
+		}
+		
+		plan = built;
+	}
+	
+	// Argument array, works like the one from qt_metacall().
+	void *rawArgs[total + 1];
+	bool removeMe[total];
+	ArgumentCleanup cleaner (rawArgs, groupTypes + 1, total, removeMe);
+	Q_UNUSED(cleaner);
+	
+	// Storage for the return values, which are discarded.
+	QVariant retVal;
+	rawArgs[0] = nullptr;
+	if (groupTypes[0] == QMetaType::QVariant) {
+		rawArgs[0] = &retVal;
+	} else if (groupTypes[0] != 0 && groupTypes[0] != QMetaType::Void) {
+		retVal = QVariant (groupTypes[0], (const void *)0);
+		rawArgs[0] = retVal.data ();
+	}
+	
+	// Convert once, invoke all
+	applyPlan (plan, args, rawArgs, removeMe);
+	for (const Callback &cb : group->callbacks) {
+		
+		// The callback may have changed since it has been added.
+		if (!cb.invokeDirect (total, rawArgs, groupTypes)) {
+			cb.invoke (count, args, types);
+		}
+		
+	}
+	
+}
+
+Nuria::CallbackList::CallbackList ()
+	: d (new CallbackListPrivate)
+{
+
+}
+
+Nuria::CallbackList::~CallbackList () {
+	delete this->d;
+}
+
+int Nuria::CallbackList::add (const Callback &callback) {
+	QMutexLocker lock (&this->d->mutex);
+	
+	int id = this->d->nextId++;
+	this->d->subscribers.append (Subscriber { id, callback });
+	this->d->publish ();
+	
+	return id;
+}
+
+bool Nuria::CallbackList::remove (int id) {
+	QMutexLocker lock (&this->d->mutex);
+	
+	for (int i = 0; i < this->d->subscribers.size (); i++) {
+		if (this->d->subscribers.at (i).id == id) {
+			this->d->subscribers.remove (i);
+			this->d->publish ();
+			return true;
+		}
+		
+	}
+	
+	return false;
+}
+
+void Nuria::CallbackList::clear () {
+	QMutexLocker lock (&this->d->mutex);
+	this->d->subscribers.clear ();
+	this->d->publish ();
+}
+
+int Nuria::CallbackList::size () const {
+	QMutexLocker lock (&this->d->mutex);
+	return this->d->subscribers.size ();
+}
+
+bool Nuria::CallbackList::isEmpty () const {
+	return (size () == 0);
+}
+
+QList< Nuria::Callback > Nuria::CallbackList::callbacks () const {
+	QMutexLocker lock (&this->d->mutex);
+	
+	QList< Callback > list;
+	for (const Subscriber &cur : this->d->subscribers) {
+		list.append (cur.callback);
+	}
+	
+	return list;
+}
+
+void Nuria::CallbackList::invoke (const QVariantList &arguments) const {
+	int count = arguments.length ();
+	void *args[count];
+	int types[count];
+	
+	for (int i = 0; i < count; i++) {
+		const QVariant &cur = arguments.at (i);
+		types[i] = cur.userType ();
+		args[i] = const_cast< void * > (cur.constData ());
+	}
+	
+	invoke (count, args, types);
+}
+
+void Nuria::CallbackList::invoke (int count, void **args, int *types) const {
+	ReaderGuard guard (this->d);
+	Q_UNUSED(guard);
+	
+	CallbackListSnapshot *snapshot = this->d->current.loadAcquire ();
+	if (!snapshot) {
+		return;
+	}
+	
+	// 
+	int key[count + 1];
+	buildPlanKey (key, count, args, types);
+	
+	for (const CallbackGroup *group : snapshot->groups) {
+		if (group->direct) {
+			CallbackListPrivate::invokeGroup (group, key, count, args, types);
+		} else {
+			group->callbacks.first ().invoke (count, args, types);
+		}
+		
+	}
+	
+}
@@ -20,9 +20,15 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QThreadPool>
+#include <QRunnable>
 #include <QVector>
+#include <QMutex>
+#include <QFile>
 
 #include "nuria/runtimemetaobject.hpp"
+#include "nuria/logger.hpp"
+#include "private/metaobjectsnapshot.hpp"
 
 typedef QMap< QString, Nuria::MetaObjectMap > FileMetaObjectMap;
 
@@ -30,18 +36,30 @@ namespace Nuria {
 class JsonMetaObjectReaderPrivate {
 public:
 	
-	void clearData () {
+	static void deleteObjects (FileMetaObjectMap &objects) {
 		for (const Nuria::MetaObjectMap &metaObjects : objects) {
 			qDeleteAll (metaObjects);
-		}		
+		}
+		
+		objects.clear ();
+	}
+	
+	void clearData () {
+		deleteObjects (objects);
 	}
 	
 	~JsonMetaObjectReaderPrivate () {
 		clearData ();
+		qDeleteAll (mappedFiles);
 		
 	}
 	
 	FileMetaObjectMap objects;
+	bool lazy = false;
+	
+	// Storage of loaded snapshots. Must outlive the MetaObjects.
+	QList< QFile * > mappedFiles;
+	QList< QByteArray > snapshots;
 	
 };
 }
@@ -68,7 +86,7 @@ Nuria::JsonMetaObjectReader::JsonMetaObjectReader (QObject *parent)
 }
 
 Nuria::JsonMetaObjectReader::~JsonMetaObjectReader () {
-	// 
+	delete this->d_ptr;
 }
 
 static Nuria::JsonMetaObjectReader::Error parseAnnotationsArray (const QJsonArray &array,
@@ -300,76 +318,202 @@ static Nuria::JsonMetaObjectReader::Error parseFieldsObject (const QJsonObject &
 }
 
 static Nuria::JsonMetaObjectReader::Error parseBasesArray (const QJsonArray &bases,
-							   Nuria::RuntimeMetaObject *metaObject) {
-	QVector< QByteArray > baseNames;
-	
+							   QVector< QByteArray > &baseNames) {
 	for (const QJsonValue &cur : bases) {
 		if (!cur.isString ()) return Nuria::JsonMetaObjectReader::BasesContainsNonString;
 		baseNames.append (cur.toString ().toLatin1 ());
 		
 	}
 	
-	metaObject->setBaseClasses (baseNames);
 	return Nuria::JsonMetaObjectReader::NoError;
 	
 }
 
-static Nuria::JsonMetaObjectReader::Error parseTypeObject (const QByteArray &typeName, const QJsonObject &type,
-							   Nuria::MetaObjectMap &objects) {
+// Checks the types of all elements of a type object.
+static Nuria::JsonMetaObjectReader::Error checkTypeObject (const QJsonObject &type) {
 	using namespace Nuria;
 	
-	QJsonValue annotationsValue = type.value (QStringLiteral("annotations"));
-	QJsonValue basesValue = type.value (QStringLiteral("bases"));
-	QJsonValue memberMethodsValue = type.value (QStringLiteral("memberMethods"));
-	QJsonValue staticMethodsValue = type.value (QStringLiteral("staticMethods"));
-	QJsonValue constructorsValue = type.value (QStringLiteral("constructors"));
-	QJsonValue enumsValue = type.value (QStringLiteral("enums"));
-	QJsonValue fieldsValue = type.value (QStringLiteral("fields"));
+	if (!type.value (QStringLiteral("annotations")).isArray ()) return JsonMetaObjectReader::AnnotationsIsNotAnArray;
+	if (!type.value (QStringLiteral("bases")).isArray ()) return JsonMetaObjectReader::BasesIsNotAnArray;
+	if (!type.value (QStringLiteral("memberMethods")).isArray ()) return JsonMetaObjectReader::MemberMethodsIsNotAnArray;
+	if (!type.value (QStringLiteral("staticMethods")).isArray ()) return JsonMetaObjectReader::StaticMethodsIsNotAnArray;
+	if (!type.value (QStringLiteral("constructors")).isArray ()) return JsonMetaObjectReader::ConstructorsIsNotAnArray;
+	if (!type.value (QStringLiteral("enums")).isObject ()) return JsonMetaObjectReader::EnumsIsNotAnObject;
+	if (!type.value (QStringLiteral("fields")).isObject ()) return JsonMetaObjectReader::FieldsIsNotAnObject;
 	
-	// Type checks
-	if (!annotationsValue.isArray ()) return JsonMetaObjectReader::AnnotationsIsNotAnArray;
-	if (!basesValue.isArray ()) return JsonMetaObjectReader::BasesIsNotAnArray;
-	if (!memberMethodsValue.isArray ()) return JsonMetaObjectReader::MemberMethodsIsNotAnArray;
-	if (!staticMethodsValue.isArray ()) return JsonMetaObjectReader::StaticMethodsIsNotAnArray;
-	if (!constructorsValue.isArray ()) return JsonMetaObjectReader::ConstructorsIsNotAnArray;
-	if (!enumsValue.isObject ()) return JsonMetaObjectReader::EnumsIsNotAnObject;
-	if (!fieldsValue.isObject ()) return JsonMetaObjectReader::FieldsIsNotAnObject;
-	
-	// Create meta object
-	JsonMetaObjectReader::Error error;
-	RuntimeMetaObject *metaObject = new RuntimeMetaObject (typeName);
+	return JsonMetaObjectReader::NoError;
+}
+
+// Parses the bases and annotations of a checked type object.
+static Nuria::JsonMetaObjectReader::Error parseTypeHead (const QJsonObject &type, QVector< QByteArray > &bases,
+							 Nuria::RuntimeMetaObject::AnnotationMap &annotations) {
+	Nuria::JsonMetaObjectReader::Error error;
 	
-	// Parse bases
-	error = parseBasesArray (basesValue.toArray (), metaObject);
+	error = parseBasesArray (type.value (QStringLiteral("bases")).toArray (), bases);
 	if (error != Nuria::JsonMetaObjectReader::NoError) return error;
 	
-	// Parse annotations
-	RuntimeMetaObject::AnnotationMap annotations;
-	error = parseAnnotationsArray (annotationsValue.toArray (), annotations);
-	if (error != Nuria::JsonMetaObjectReader::NoError) return error;
+	return parseAnnotationsArray (type.value (QStringLiteral("annotations")).toArray (), annotations);
+}
+
+// Parses the methods, enums and fields of a checked type object.
+static Nuria::JsonMetaObjectReader::Error parseTypeMembers (const QJsonObject &type,
+							    Nuria::RuntimeMetaObject *metaObject) {
+	using namespace Nuria;
 	
 	// Parse methods
+	JsonMetaObjectReader::Error error;
 	JsonMetaObjectReader::Error errorMembers;
 	JsonMetaObjectReader::Error errorStatics;
 	JsonMetaObjectReader::Error errorCtors;
 	
-	errorMembers = parseMethodArray (MetaMethod::Method, memberMethodsValue.toArray (), metaObject);
-	errorStatics = parseMethodArray (MetaMethod::Static, staticMethodsValue.toArray (), metaObject);
-	errorCtors = parseMethodArray (MetaMethod::Constructor, constructorsValue.toArray (), metaObject);
+	errorMembers = parseMethodArray (MetaMethod::Method, type.value (QStringLiteral("memberMethods")).toArray (), metaObject);
+	errorStatics = parseMethodArray (MetaMethod::Static, type.value (QStringLiteral("staticMethods")).toArray (), metaObject);
+	errorCtors = parseMethodArray (MetaMethod::Constructor, type.value (QStringLiteral("constructors")).toArray (), metaObject);
 	
 	if (errorMembers != JsonMetaObjectReader::NoError) return errorMembers;
 	if (errorStatics != JsonMetaObjectReader::NoError) return errorStatics;
 	if (errorCtors != JsonMetaObjectReader::NoError) return errorCtors;
 	
 	// Parse enums
-	error = parseEnumsObject (enumsValue.toObject (), metaObject);
+	error = parseEnumsObject (type.value (QStringLiteral("enums")).toObject (), metaObject);
 	if (error != Nuria::JsonMetaObjectReader::NoError) return error;
 	
 	// Parse fields
-	error = parseFieldsObject (fieldsValue.toObject (), metaObject);
+	return parseFieldsObject (type.value (QStringLiteral("fields")).toObject (), metaObject);
+}
+
+// RuntimeMetaObject which parses its methods, enums and fields on first use.
+// The name, bases and annotations of the type are known up-front, so
+// registering the type doesn't parse the rest. Only the JSON text of the type
+// itself is kept, as a QJsonObject would keep the whole document alive.
+class LazyJsonMetaObject : public Nuria::RuntimeMetaObject {
+public:
+	
+	LazyJsonMetaObject (const QByteArray &name, const QByteArray &data, const QVector< QByteArray > &bases,
+			    const AnnotationMap &annotations)
+		: RuntimeMetaObject (name), m_name (name), m_bases (bases), m_annotations (annotations),
+		  m_data (data), m_loaded (0)
+	{
+		for (auto it = annotations.constBegin (), end = annotations.constEnd (); it != end; ++it) {
+			this->m_annotationNames.append (it.key ());
+			this->m_annotationValues.append (it.value ());
+		}
+		
+	}
+	
+protected:
+	void gateCall (GateMethod method, int category, int index, int nth,
+		       void *result, void *additional) override;
+	
+private:
+	void materialize ();
+	
+	// Immutable, thus usable while materializing
+	QByteArray m_name;
+	QVector< QByteArray > m_bases;
+	AnnotationMap m_annotations;
+	QVector< QByteArray > m_annotationNames;
+	QVector< QVariant > m_annotationValues;
+	
+	QByteArray m_data; // Compact JSON of the type object
+	QMutex m_mutex;
+	QAtomicInt m_loaded;
+	
+};
+
+#define RESULT(Type) *reinterpret_cast< Type * > (result)
+void LazyJsonMetaObject::gateCall (GateMethod method, int category, int index, int nth,
+				   void *result, void *additional) {
+	bool isType = (category == 0);
+	bool isAnnotation = (nth >= 0 && nth < this->m_annotationNames.size ());
+	
+	switch (method) {
+	case GateMethod::ClassName:
+		RESULT(QByteArray) = this->m_name;
+		return;
+	case GateMethod::MetaTypeId:
+	case GateMethod::PointerMetaTypeId:
+		RESULT(int) = 0;
+		return;
+	case GateMethod::BaseClasses:
+		RESULT(QVector< QByteArray >) = this->m_bases;
+		return;
+	case GateMethod::AnnotationCount:
+		if (!isType) break;
+		RESULT(int) = this->m_annotationNames.size ();
+		return;
+	case GateMethod::AnnotationName:
+		if (!isType) break;
+		RESULT(QByteArray) = isAnnotation ? this->m_annotationNames.at (nth) : QByteArray ();
+		return;
+	case GateMethod::AnnotationValue:
+		if (!isType) break;
+		RESULT(QVariant) = isAnnotation ? this->m_annotationValues.at (nth) : QVariant ();
+		return;
+	default:
+		break;
+	}
+	
+	materialize ();
+	RuntimeMetaObject::gateCall (method, category, index, nth, result, additional);
+	
+}
+
+void LazyJsonMetaObject::materialize () {
+	if (this->m_loaded.loadAcquire ()) {
+		return;
+	}
+	
+	QMutexLocker lock (&this->m_mutex);
+	if (this->m_loaded.load ()) {
+		return;
+	}
+	
+	QJsonObject type = QJsonDocument::fromJson (this->m_data).object ();
+	Nuria::JsonMetaObjectReader::Error error = parseTypeMembers (type, this);
+	if (error != Nuria::JsonMetaObjectReader::NoError) {
+		nError() << "Failed to read type" << this->m_name << "- Error code:" << error;
+	}
+	
+	setBaseClasses (this->m_bases);
+	setAnnotations (this->m_annotations);
+	finalize ();
+	
+	this->m_data = QByteArray ();
+	this->m_loaded.storeRelease (1);
+}
+
+static Nuria::JsonMetaObjectReader::Error parseTypeObject (const QByteArray &typeName, const QJsonObject &type,
+							   bool lazy, Nuria::MetaObjectMap &objects) {
+	using namespace Nuria;
+	
+	// Type checks
+	JsonMetaObjectReader::Error error = checkTypeObject (type);
 	if (error != Nuria::JsonMetaObjectReader::NoError) return error;
 	
+	// Parse bases and annotations
+	QVector< QByteArray > bases;
+	RuntimeMetaObject::AnnotationMap annotations;
+	error = parseTypeHead (type, bases, annotations);
+	if (error != Nuria::JsonMetaObjectReader::NoError) return error;
+	
+	// Lazy types parse the rest later on
+	if (lazy) {
+		QByteArray data = QJsonDocument (type).toJson (QJsonDocument::Compact);
+		objects.insert (typeName, new LazyJsonMetaObject (typeName, data, bases, annotations));
+		return Nuria::JsonMetaObjectReader::NoError;
+	}
+	
+	// Create meta object
+	RuntimeMetaObject *metaObject = new RuntimeMetaObject (typeName);
+	error = parseTypeMembers (type, metaObject);
+	if (error != Nuria::JsonMetaObjectReader::NoError) {
+		delete metaObject;
+		return error;
+	}
+	
 	// Store and done.
+	metaObject->setBaseClasses (bases);
 	metaObject->setAnnotations (annotations);
 	metaObject->finalize ();
 	
@@ -377,7 +521,8 @@ static Nuria::JsonMetaObjectReader::Error parseTypeObject (const QByteArray &typ
 	return Nuria::JsonMetaObjectReader::NoError;
 }
 
-static Nuria::JsonMetaObjectReader::Error parseTypesObject (const QJsonObject &types, Nuria::MetaObjectMap &objects) {
+static Nuria::JsonMetaObjectReader::Error parseTypesObject (const QJsonObject &types, bool lazy,
+							    Nuria::MetaObjectMap &objects) {
 	Nuria::JsonMetaObjectReader::Error error = Nuria::JsonMetaObjectReader::NoError;
 	
 	auto it = types.constBegin ();
@@ -387,7 +532,7 @@ static Nuria::JsonMetaObjectReader::Error parseTypesObject (const QJsonObject &t
 		QJsonValue typeValue = *it;
 		
 		if (!typeValue.isObject ()) return Nuria::JsonMetaObjectReader::TypeIsNotAnObject;
-		error = parseTypeObject (name.toLatin1 (), typeValue.toObject (), objects);
+		error = parseTypeObject (name.toLatin1 (), typeValue.toObject (), lazy, objects);
 		
 	}
 	
@@ -395,28 +540,35 @@ static Nuria::JsonMetaObjectReader::Error parseTypesObject (const QJsonObject &t
 	return error;
 }
 
-Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parse (const QJsonObject &root) {
-	Error error = NoError;
+// Parses all files in 'root' into 'objects'. Thread-safe.
+static Nuria::JsonMetaObjectReader::Error parseRoot (const QJsonObject &root, bool lazy, FileMetaObjectMap &objects) {
+	Nuria::JsonMetaObjectReader::Error error = Nuria::JsonMetaObjectReader::NoError;
 	
 	auto it = root.constBegin ();
 	auto end = root.constEnd ();
-	for (; it != end && error == NoError; ++it) {
+	for (; it != end && error == Nuria::JsonMetaObjectReader::NoError; ++it) {
 		QString fileName = it.key ();
 		QJsonValue fileValue = *it;
-		MetaObjectMap metaObjectMap;
+		Nuria::MetaObjectMap metaObjectMap;
 		
 		if (!fileValue.isObject ()) {
-			error = FileIsNotAnObject;
+			error = Nuria::JsonMetaObjectReader::FileIsNotAnObject;
 			break;
 		}
 		
-		error = parseTypesObject (fileValue.toObject (), metaObjectMap);
+		error = parseTypesObject (fileValue.toObject (), lazy, metaObjectMap);
 		
 		// Store
-		this->d_ptr->objects.insert (fileName, metaObjectMap);
+		objects.insert (fileName, metaObjectMap);
 		
 	}
 	
+	return error;
+}
+
+Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parse (const QJsonObject &root) {
+	Error error = parseRoot (root, this->d_ptr->lazy, this->d_ptr->objects);
+	
 	// 
 	if (error != NoError) {
 		this->d_ptr->clearData ();
@@ -426,6 +578,97 @@ Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parse (const QJs
 	
 }
 
+// Reads and parses a file on a thread pool.
+class ParseFileTask : public QRunnable {
+public:
+	
+	ParseFileTask (const QString &fileName, bool lazy)
+		: fileName (fileName), lazy (lazy)
+	{ setAutoDelete (false); }
+	
+	void run () override {
+		QFile file (this->fileName);
+		if (!file.open (QIODevice::ReadOnly)) {
+			this->error = Nuria::JsonMetaObjectReader::FileNotReadable;
+			return;
+		}
+		
+		QJsonParseError parseError;
+		QJsonDocument doc = QJsonDocument::fromJson (file.readAll (), &parseError);
+		
+		if (parseError.error != QJsonParseError::NoError) {
+			this->error = Nuria::JsonMetaObjectReader::JsonParseError;
+		} else if (!doc.isObject ()) {
+			this->error = Nuria::JsonMetaObjectReader::RootIsNotAnObject;
+		} else {
+			this->error = parseRoot (doc.object (), this->lazy, this->objects);
+		}
+		
+	}
+	
+	QString fileName;
+	bool lazy;
+	Nuria::JsonMetaObjectReader::Error error = Nuria::JsonMetaObjectReader::NoError;
+	FileMetaObjectMap objects;
+	
+};
+
+Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parseFiles (const QStringList &fileNames) {
+	QVector< ParseFileTask * > tasks;
+	
+	// Parse all files concurrently
+	QThreadPool pool;
+	for (const QString &fileName : fileNames) {
+		ParseFileTask *task = new ParseFileTask (fileName, this->d_ptr->lazy);
+		tasks.append (task);
+		pool.start (task);
+	}
+	
+	pool.waitForDone ();
+	
+	// Report the first error in order of 'fileNames'
+	Error error = NoError;
+	for (ParseFileTask *task : tasks) {
+		if (task->error != NoError) {
+			error = task->error;
+			break;
+		}
+		
+	}
+	
+	// Store the results
+	for (ParseFileTask *task : tasks) {
+		if (error != NoError) {
+			JsonMetaObjectReaderPrivate::deleteObjects (task->objects);
+			continue;
+		}
+		
+		for (auto it = task->objects.constBegin (), end = task->objects.constEnd (); it != end; ++it) {
+			this->d_ptr->objects.insert (it.key (), it.value ());
+		}
+		
+	}
+	
+	qDeleteAll (tasks);
+	if (error != NoError) {
+		this->d_ptr->clearData ();
+	}
+	
+	return error;
+}
+
+void Nuria::JsonMetaObjectReader::registerMetaObjects () {
+	MetaObjectMap all;
+	for (const MetaObjectMap &objects : this->d_ptr->objects) {
+		for (auto it = objects.constBegin (), end = objects.constEnd (); it != end; ++it) {
+			all.insert (it.key (), it.value ());
+		}
+		
+	}
+	
+	MetaObject::registerMetaObjects (all);
+}
+
 Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parse (const QJsonDocument &jsonDocument) {
 	
 	if (!jsonDocument.isObject ()) {
@@ -450,6 +693,14 @@ Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::parse (const QBy
 	return parse (doc);
 }
 
+void Nuria::JsonMetaObjectReader::setLazy (bool lazy) {
+	this->d_ptr->lazy = lazy;
+}
+
+bool Nuria::JsonMetaObjectReader::isLazy () const {
+	return this->d_ptr->lazy;
+}
+
 QStringList Nuria::JsonMetaObjectReader::sourceFiles () {
 	return this->d_ptr->objects.keys ();
 }
@@ -457,3 +708,63 @@ QStringList Nuria::JsonMetaObjectReader::sourceFiles () {
 Nuria::MetaObjectMap Nuria::JsonMetaObjectReader::metaObjects (const QString &sourceFile) {
 	return this->d_ptr->objects.value (sourceFile);
 }
+
+QByteArray Nuria::JsonMetaObjectReader::snapshot () {
+	return Internal::writeSnapshot (this->d_ptr->objects);
+}
+
+// Creates the MetaObjects of the snapshot in 'data' and adds them to 'objects'.
+static bool loadSnapshotData (const char *data, qint64 size, FileMetaObjectMap &objects) {
+	Nuria::Internal::SnapshotView view;
+	if (!view.load (data, size)) {
+		return false;
+	}
+	
+	for (quint32 i = 0; i < view.header->files.count; i++) {
+		const Nuria::Internal::SnapshotFile &file = view.files[i];
+		Nuria::MetaObjectMap &map = objects[QString::fromUtf8 (view.string (file.name))];
+		
+		for (quint32 j = 0; j < file.types.count; j++) {
+			const Nuria::Internal::SnapshotType *type = view.types + file.types.first + j;
+			Nuria::MetaObject *object = new Nuria::Internal::SnapshotMetaObject (view, type);
+			
+			// Don't leave the former instance behind
+			delete map.value (object->className ());
+			map.insert (object->className (), object);
+		}
+		
+	}
+	
+	return true;
+}
+
+Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::loadSnapshot (const QString &fileName) {
+	QFile *file = new QFile (fileName);
+	
+	const uchar *data = nullptr;
+	if (file->open (QIODevice::ReadOnly)) {
+		data = file->map (0, file->size ());
+	}
+	
+	if (!data) {
+		delete file;
+		return SnapshotFileError;
+	}
+	
+	if (!loadSnapshotData (reinterpret_cast< const char * > (data), file->size (), this->d_ptr->objects)) {
+		delete file;
+		return SnapshotIsInvalid;
+	}
+	
+	this->d_ptr->mappedFiles.append (file);
+	return NoError;
+}
+
+Nuria::JsonMetaObjectReader::Error Nuria::JsonMetaObjectReader::loadSnapshot (const QByteArray &data) {
+	if (!loadSnapshotData (data.constData (), data.size (), this->d_ptr->objects)) {
+		return SnapshotIsInvalid;
+	}
+	
+	this->d_ptr->snapshots.append (data);
+	return NoError;
+}
@@ -68,6 +68,14 @@ QJsonDocument Nuria::JsonStreamReader::nextPendingElement (QJsonParseError *pars
 	return QJsonDocument::fromJson (jsonData, parseError);
 }
 
+QByteArray Nuria::JsonStreamReader::nextPendingElementData () {
+	if (!this->d_ptr->streamer.hasWaitingElement ()) {
+		return QByteArray ();
+	}
+	
+	return this->d_ptr->streamer.nextWaitingElement ();
+}
+
 qint64 Nuria::JsonStreamReader::readData (char *data, qint64 maxlen) {
 	return -1;
 }
@@ -0,0 +1,506 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nuria/jsontokenreader.hpp"
+
+#include <QVarLengthArray>
+#include <QVariantMap>
+#include <QChar>
+#include <cstring>
+#include <climits>
+
+namespace Nuria {
+class JsonTokenReaderPrivate {
+public:
+	
+	// What the parser expects next
+	enum Expect {
+		ExpectValue,
+		ExpectValueOrEnd, // After '['
+		ExpectKeyOrEnd, // After '{'
+		ExpectCommaOrEnd,
+		ExpectEndOfData
+	};
+	
+	JsonTokenReader::Token fail ();
+	JsonTokenReader::Token endContainer ();
+	JsonTokenReader::Token readKey ();
+	JsonTokenReader::Token readValue ();
+	JsonTokenReader::Token readNumber ();
+	JsonTokenReader::Token readLiteral (const char *literal, int length);
+	bool readString ();
+	void skipWhitespace ();
+	
+	QByteArray json;
+	const char *begin;
+	const char *pos;
+	const char *end;
+	
+	JsonTokenReader::Token token = JsonTokenReader::NoToken;
+	Expect expect = ExpectValue;
+	QVarLengthArray< char, 32 > stack;
+	int errorOffset = -1;
+	
+	QString string;
+	bool boolean = false;
+	bool isInteger = false;
+	qint64 integer = 0;
+	const char *numberBegin = nullptr;
+	int numberLength = 0;
+	
+};
+
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::fail () {
+	if (this->errorOffset < 0) {
+		this->errorOffset = int (this->pos - this->begin);
+	}
+	
+	return JsonTokenReader::Error;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::endContainer () {
+	char type = this->stack.last ();
+	this->stack.removeLast ();
+	this->pos++;
+	
+	this->expect = (this->stack.isEmpty ()) ? ExpectEndOfData : ExpectCommaOrEnd;
+	return (type == '{') ? JsonTokenReader::EndMap : JsonTokenReader::EndList;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::readKey () {
+	if (this->pos >= this->end || *this->pos != '"' || !readString ()) {
+		return fail ();
+	}
+	
+	skipWhitespace ();
+	if (this->pos >= this->end || *this->pos != ':') {
+		return fail ();
+	}
+	
+	this->pos++;
+	this->expect = ExpectValue;
+	return JsonTokenReader::Key;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::readValue () {
+	JsonTokenReader::Token result;
+	
+	switch (*this->pos) {
+	case '{':
+		this->pos++;
+		this->stack.append ('{');
+		this->expect = ExpectKeyOrEnd;
+		return JsonTokenReader::BeginMap;
+	case '[':
+		this->pos++;
+		this->stack.append ('[');
+		this->expect = ExpectValueOrEnd;
+		return JsonTokenReader::BeginList;
+	case '"':
+		result = (readString ()) ? JsonTokenReader::String : fail ();
+		break;
+	case 't':
+		this->boolean = true;
+		result = readLiteral ("true", 4);
+		break;
+	case 'f':
+		this->boolean = false;
+		result = readLiteral ("false", 5);
+		break;
+	case 'n':
+		result = readLiteral ("null", 4);
+		break;
+	default:
+		result = readNumber ();
+	}
+	
+	this->expect = (this->stack.isEmpty ()) ? ExpectEndOfData : ExpectCommaOrEnd;
+	return result;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::readNumber () {
+	const char *it = this->pos;
+	bool negative = false;
+	bool overflow = false;
+	quint64 value = 0;
+	
+	if (it < this->end && *it == '-') {
+		negative = true;
+		it++;
+	}
+	
+	// Integer part, which must not have leading zeroes
+	if (it >= this->end || *it < '0' || *it > '9') {
+		return fail ();
+	}
+	
+	if (*it == '0') {
+		it++;
+	} else {
+		for (; it < this->end && *it >= '0' && *it <= '9'; it++) {
+			quint64 digit = quint64 (*it - '0');
+			overflow = overflow || value > (Q_UINT64_C(0xFFFFFFFFFFFFFFFF) - digit) / 10;
+			value = value * 10 + digit;
+		}
+		
+	}
+	
+	// Fraction and exponent
+	bool integral = true;
+	if (it < this->end && *it == '.') {
+		integral = false;
+		it++;
+		
+		if (it >= this->end || *it < '0' || *it > '9') {
+			this->pos = it;
+			return fail ();
+		}
+		
+		while (it < this->end && *it >= '0' && *it <= '9') {
+			it++;
+		}
+		
+	}
+	
+	if (it < this->end && (*it == 'e' || *it == 'E')) {
+		integral = false;
+		it++;
+		
+		if (it < this->end && (*it == '+' || *it == '-')) {
+			it++;
+		}
+		
+		if (it >= this->end || *it < '0' || *it > '9') {
+			this->pos = it;
+			return fail ();
+		}
+		
+		while (it < this->end && *it >= '0' && *it <= '9') {
+			it++;
+		}
+		
+	}
+	
+	// 
+	quint64 limit = (negative) ? Q_UINT64_C(0x8000000000000000) : Q_UINT64_C(0x7FFFFFFFFFFFFFFF);
+	this->isInteger = integral && !overflow && value <= limit;
+	this->integer = (negative) ? qint64 (0 - value) : qint64 (value);
+	this->numberBegin = this->pos;
+	this->numberLength = int (it - this->pos);
+	this->pos = it;
+	return JsonTokenReader::Number;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReaderPrivate::readLiteral (const char *literal, int length) {
+	if (this->end - this->pos < length || ::memcmp (this->pos, literal, length)) {
+		return fail ();
+	}
+	
+	this->pos += length;
+	return (length == 4 && *literal == 'n') ? JsonTokenReader::Null : JsonTokenReader::Bool;
+}
+
+static int hexDigit (char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	
+	return -1;
+}
+
+static bool readHex4 (const char *it, uint &result) {
+	result = 0;
+	for (int i = 0; i < 4; i++) {
+		int digit = hexDigit (it[i]);
+		if (digit < 0) {
+			return false;
+		}
+		
+		result = (result << 4) | uint (digit);
+	}
+	
+	return true;
+}
+
+bool Nuria::JsonTokenReaderPrivate::readString () {
+	const char *it = ++this->pos;
+	
+	// Fast path for strings without escape sequences
+	while (it < this->end && *it != '"' && *it != '\\' && uchar (*it) >= 0x20) {
+		it++;
+	}
+	
+	if (it < this->end && *it == '"') {
+		this->string = QString::fromUtf8 (this->pos, int (it - this->pos));
+		this->pos = it + 1;
+		return true;
+	}
+	
+	// Unescape into a UTF-16 buffer
+	QString result = QString::fromUtf8 (this->pos, int (it - this->pos));
+	const char *chunk = it;
+	
+	while (it < this->end && *it != '"') {
+		if (uchar (*it) < 0x20) {
+			this->pos = it;
+			return false;
+		}
+		
+		if (*it != '\\') {
+			it++;
+			continue;
+		}
+		
+		result.append (QString::fromUtf8 (chunk, int (it - chunk)));
+		if (this->end - it < 2) {
+			this->pos = it;
+			return false;
+		}
+		
+		char c = it[1];
+		it += 2;
+		switch (c) {
+		case '"': result.append (QLatin1Char ('"')); break;
+		case '\\': result.append (QLatin1Char ('\\')); break;
+		case '/': result.append (QLatin1Char ('/')); break;
+		case 'b': result.append (QLatin1Char ('\b')); break;
+		case 'f': result.append (QLatin1Char ('\f')); break;
+		case 'n': result.append (QLatin1Char ('\n')); break;
+		case 'r': result.append (QLatin1Char ('\r')); break;
+		case 't': result.append (QLatin1Char ('\t')); break;
+		case 'u': {
+			uint code;
+			if (this->end - it < 4 || !readHex4 (it, code)) {
+				this->pos = it;
+				return false;
+			}
+			
+			result.append (QChar (ushort (code)));
+			it += 4;
+		} break;
+		default:
+			this->pos = it - 2;
+			return false;
+		}
+		
+		chunk = it;
+	}
+	
+	if (it >= this->end) {
+		this->pos = it;
+		return false;
+	}
+	
+	result.append (QString::fromUtf8 (chunk, int (it - chunk)));
+	this->string = result;
+	this->pos = it + 1;
+	return true;
+}
+
+void Nuria::JsonTokenReaderPrivate::skipWhitespace () {
+	while (this->pos < this->end &&
+	       (*this->pos == ' ' || *this->pos == '\n' || *this->pos == '\r' || *this->pos == '\t')) {
+		this->pos++;
+	}
+	
+}
+
+Nuria::JsonTokenReader::JsonTokenReader (const QByteArray &json)
+	: d_ptr (new JsonTokenReaderPrivate)
+{
+	
+	this->d_ptr->json = json;
+	this->d_ptr->begin = this->d_ptr->json.constData ();
+	this->d_ptr->pos = this->d_ptr->begin;
+	this->d_ptr->end = this->d_ptr->begin + this->d_ptr->json.length ();
+	
+}
+
+Nuria::JsonTokenReader::~JsonTokenReader () {
+	delete this->d_ptr;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReader::next () {
+	JsonTokenReaderPrivate *d = this->d_ptr;
+	if (d->token == Error) {
+		return Error;
+	}
+	
+	d->skipWhitespace ();
+	if (d->expect == JsonTokenReaderPrivate::ExpectEndOfData) {
+		d->token = (d->pos < d->end) ? d->fail () : EndOfData;
+		return d->token;
+	}
+	
+	if (d->pos >= d->end) {
+		d->token = d->fail ();
+		return d->token;
+	}
+	
+	// 
+	char c = *d->pos;
+	switch (d->expect) {
+	case JsonTokenReaderPrivate::ExpectValue:
+		d->token = d->readValue ();
+		break;
+	case JsonTokenReaderPrivate::ExpectValueOrEnd:
+		d->token = (c == ']') ? d->endContainer () : d->readValue ();
+		break;
+	case JsonTokenReaderPrivate::ExpectKeyOrEnd:
+		d->token = (c == '}') ? d->endContainer () : d->readKey ();
+		break;
+	case JsonTokenReaderPrivate::ExpectCommaOrEnd:
+		if (c == ((d->stack.last () == '{') ? '}' : ']')) {
+			d->token = d->endContainer ();
+		} else if (c != ',') {
+			d->token = d->fail ();
+		} else {
+			d->pos++;
+			d->skipWhitespace ();
+			
+			if (d->pos >= d->end) {
+				d->token = d->fail ();
+			} else {
+				d->token = (d->stack.last () == '{') ? d->readKey () : d->readValue ();
+			}
+			
+		}
+		
+		break;
+	case JsonTokenReaderPrivate::ExpectEndOfData:
+		break;
+	}
+	
+	return d->token;
+}
+
+Nuria::JsonTokenReader::Token Nuria::JsonTokenReader::token () const {
+	return this->d_ptr->token;
+}
+
+bool Nuria::JsonTokenReader::hasError () const {
+	return (this->d_ptr->token == Error);
+}
+
+int Nuria::JsonTokenReader::errorOffset () const {
+	return this->d_ptr->errorOffset;
+}
+
+QString Nuria::JsonTokenReader::string () const {
+	return this->d_ptr->string;
+}
+
+bool Nuria::JsonTokenReader::toBool () const {
+	return this->d_ptr->boolean;
+}
+
+bool Nuria::JsonTokenReader::isInteger () const {
+	return this->d_ptr->isInteger;
+}
+
+qint64 Nuria::JsonTokenReader::toInteger () const {
+	return this->d_ptr->integer;
+}
+
+double Nuria::JsonTokenReader::toDouble () const {
+	if (this->d_ptr->isInteger) {
+		return double (this->d_ptr->integer);
+	}
+	
+	QByteArray number = QByteArray::fromRawData (this->d_ptr->numberBegin, this->d_ptr->numberLength);
+	return number.toDouble ();
+}
+
+QVariant Nuria::JsonTokenReader::value () const {
+	switch (this->d_ptr->token) {
+	case Key:
+	case String:
+		return this->d_ptr->string;
+	case Bool:
+		return this->d_ptr->boolean;
+	case Number:
+		if (!this->d_ptr->isInteger) {
+			return toDouble ();
+		} else if (this->d_ptr->integer >= INT_MIN && this->d_ptr->integer <= INT_MAX) {
+			return int (this->d_ptr->integer);
+		}
+		
+		return this->d_ptr->integer;
+	default:
+		return QVariant ();
+	}
+	
+}
+
+QVariant Nuria::JsonTokenReader::readValue () {
+	switch (this->d_ptr->token) {
+	case BeginMap: {
+		QVariantMap map;
+		while (next () == Key) {
+			QString key = this->d_ptr->string;
+			next ();
+			map.insert (key, readValue ());
+		}
+		
+		return (this->d_ptr->token == EndMap) ? QVariant (map) : QVariant ();
+	}
+	case BeginList: {
+		QVariantList list;
+		for (Token cur = next (); cur != EndList; cur = next ()) {
+			if (cur == Error) {
+				return QVariant ();
+			}
+			
+			list.append (readValue ());
+		}
+		
+		return list;
+	}
+	default:
+		return value ();
+	}
+	
+}
+
+bool Nuria::JsonTokenReader::skipValue () {
+	Token cur = this->d_ptr->token;
+	if (cur != BeginMap && cur != BeginList) {
+		return (cur != Error);
+	}
+	
+	// 
+	int depth = 1;
+	while (depth > 0) {
+		cur = next ();
+		if (cur == BeginMap || cur == BeginList) {
+			depth++;
+		} else if (cur == EndMap || cur == EndList) {
+			depth--;
+		} else if (cur == Error) {
+			return false;
+		}
+		
+	}
+	
+	return true;
+}
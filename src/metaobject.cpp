@@ -16,9 +16,17 @@
 
 #include "nuria/metaobject.hpp"
 
-#include <QReadWriteLock>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QVarLengthArray>
+#include <QThreadStorage>
+#include <QMutex>
+#include <QHash>
 #include <functional>
+#include <algorithm>
 
+#include "private/metaobjectindex.hpp"
+#include "private/enumtable.hpp"
 #include "nuria/logger.hpp"
 
 enum Categories {
@@ -28,68 +36,241 @@ enum Categories {
 	EnumCategory = 3
 };
 
-// 
-static QReadWriteLock g_lock;
-static Nuria::MetaObjectMap g_metaObjects;
-
-// Binary find in the range 0 to total. If not found, returns the position
-// the element would've been.
-// f(index, value) returns the result of storage[index] < value.
-template< typename T, typename Func >
-static int binaryFind (int total, const T &value, Func f) {
-	if (!total) {
-		return -1;
+// Immutable snapshot of the registry. Lookups use the current one without
+// taking a lock.
+struct MetaObjectRegistry {
+	Nuria::MetaObjectMap all;
+	QHash< QByteArray, Nuria::MetaObject * > byName;
+	QVector< Nuria::MetaObject * > byTypeId; // Indexed by Qt type id
+	QHash< QByteArray, Nuria::MetaObjectMap > byParent; // Base class -> Types
+	QHash< QByteArray, Nuria::MetaObjectMap > byAnnotation; // Name -> Types
+};
+
+// Registrations change 'g_master' and mark the registry as stale. The next
+// lookup publishes a deep copy of it, so 'g_master' itself is never shared.
+// Lookups announce the snapshot they're reading through the hazard pointer of
+// their thread. Old snapshots are freed as soon as no hazard points to them.
+static QBasicMutex g_registryMutex;
+static MetaObjectRegistry g_master;
+static QVector< MetaObjectRegistry * > g_retired;
+static QAtomicInt g_retiredCount;
+static QAtomicInt g_stale;
+static QAtomicPointer< MetaObjectRegistry > g_registry;
+
+// Hazard pointer of a thread. Never freed, but reused by later threads.
+struct RegistryHazard {
+	QAtomicPointer< MetaObjectRegistry > snapshot;
+	QAtomicInt inUse;
+	RegistryHazard *next;
+};
+
+static QAtomicPointer< RegistryHazard > g_hazards;
+
+static RegistryHazard *acquireHazard () {
+	for (RegistryHazard *cur = g_hazards.loadAcquire (); cur; cur = cur->next) {
+		if (cur->inUse.testAndSetOrdered (0, 1)) {
+			return cur;
+		}
+		
+	}
+	
+	// Prepend a new one
+	RegistryHazard *hazard = new RegistryHazard;
+	hazard->inUse.store (1);
+	do {
+		hazard->next = g_hazards.loadAcquire ();
+	} while (!g_hazards.testAndSetOrdered (hazard->next, hazard));
+	
+	return hazard;
+}
+
+// Owns the hazard of a thread until it exits.
+struct ThreadHazard {
+	ThreadHazard () : hazard (acquireHazard ()) {}
+	~ThreadHazard () { hazard->inUse.storeRelease (0); }
+	
+	RegistryHazard *hazard;
+};
+
+static QThreadStorage< ThreadHazard * > g_threadHazard;
+
+static RegistryHazard *threadHazard () {
+	ThreadHazard *local = g_threadHazard.localData ();
+	if (!local) {
+		local = new ThreadHazard;
+		g_threadHazard.setLocalData (local);
 	}
 	
-	int min = 0;
-	while (min < total) {
-		int mid = min + (total - min) / 2;
-		if (f (mid, value)) {
-			min = mid + 1;
-		} else {
-			total = mid;
+	return local->hazard;
+}
+
+// Frees retired snapshots no hazard points to. The registry lock must be held.
+static void reclaimRegistries () {
+	QVarLengthArray< MetaObjectRegistry *, 16 > used;
+	for (RegistryHazard *cur = g_hazards.loadAcquire (); cur; cur = cur->next) {
+		if (MetaObjectRegistry *snapshot = cur->snapshot.loadAcquire ()) {
+			used.append (snapshot);
 		}
 		
 	}
 	
-	return (total == min) ? min : -1;
+	for (int i = g_retired.size () - 1; i >= 0; i--) {
+		MetaObjectRegistry *snapshot = g_retired.at (i);
+		if (std::find (used.constBegin (), used.constEnd (), snapshot) == used.constEnd ()) {
+			g_retired.remove (i);
+			delete snapshot;
+		}
+		
+	}
+	
+	g_retiredCount.storeRelease (g_retired.size ());
+}
+
+// Returns a copy of 'g_master' not sharing its data. Otherwise, the next
+// registration would have to copy all of it while holding the registry lock.
+static MetaObjectRegistry *copyMaster () {
+	MetaObjectRegistry *copy = new MetaObjectRegistry (g_master);
+	copy->all.detach ();
+	copy->byName.detach ();
+	copy->byTypeId.detach ();
+	copy->byParent.detach ();
+	copy->byAnnotation.detach ();
+	return copy;
 }
 
-// Common implementation for lower-bound search of annotations.
-template< typename T >
-static int annotationLowerBoundImpl (T &self, const QByteArray &name) {
-	auto compare = [&self, &name](int i, const T &) {
-		return self.annotation (i).name () < name;
-	};
+static void publishRegistry () {
+	QMutexLocker lock (&g_registryMutex);
+	if (!g_stale.loadAcquire ()) {
+		return;
+	}
 	
-	int total = self.annotationCount ();
-	int mid = binaryFind (total, self, compare);
+	MetaObjectRegistry *old = g_registry.fetchAndStoreOrdered (copyMaster ());
+	g_stale.storeRelease (0);
 	
-	if (mid < 0 || self.annotation (mid).name () != name) {
-		return -1;
+	if (old) {
+		g_retired.append (old);
+	}
+	
+	reclaimRegistries ();
+	
+}
+
+// Gives access to the current registry snapshot for its lifetime.
+class RegistryReader {
+public:
+	
+	RegistryReader () {
+		if (g_stale.loadAcquire ()) {
+			publishRegistry ();
+		}
+		
+		// Nested in another reader of this thread, which protects its
+		// snapshot already?
+		this->m_hazard = threadHazard ();
+		this->m_registry = this->m_hazard->snapshot.loadAcquire ();
+		this->m_nested = (this->m_registry != nullptr);
+		if (this->m_nested) {
+			return;
+		}
+		
+		// Announce the snapshot, then make sure it is still current
+		MetaObjectRegistry *snapshot = g_registry.loadAcquire ();
+		for (;;) {
+			this->m_hazard->snapshot.fetchAndStoreOrdered (snapshot);
+			MetaObjectRegistry *now = g_registry.loadAcquire ();
+			if (now == snapshot) {
+				break;
+			}
+			
+			snapshot = now;
+		}
+		
+		this->m_registry = snapshot;
+	}
+	
+	~RegistryReader () {
+		if (this->m_nested) {
+			return;
+		}
+		
+		this->m_hazard->snapshot.storeRelease (nullptr);
+		
+		// Free snapshots this one may have kept alive
+		if (g_retiredCount.loadAcquire () > 0 && g_registryMutex.tryLock ()) {
+			reclaimRegistries ();
+			g_registryMutex.unlock ();
+		}
+		
+	}
+	
+	const MetaObjectRegistry *operator-> () const { return m_registry; }
+	operator bool () const { return m_registry; }
+	
+private:
+	RegistryHazard *m_hazard;
+	const MetaObjectRegistry *m_registry;
+	bool m_nested;
+};
+
+static void indexTypeId (int typeId, Nuria::MetaObject *object) {
+	if (typeId <= 0) {
+		return;
 	}
 	
-	for (mid--; mid >= 0 && self.annotation (mid).name () == name; mid--);
-	return mid + 1;
+	if (g_master.byTypeId.size () <= typeId) {
+		g_master.byTypeId.resize (typeId + 1);
+	}
 	
+	g_master.byTypeId[typeId] = object;
 }
 
-// Common implementation for upper-bound search of annotations.
-template< typename T >
-static int annotationUpperBoundImpl (T &self, const QByteArray &name) {
-	auto compare = [&self, &name](int i, const T &) {
-		return self.annotation (i).name () < name;
-	};
+static void unindexTypeId (int typeId, Nuria::MetaObject *object) {
+	if (typeId > 0 && typeId < g_master.byTypeId.size () && g_master.byTypeId.at (typeId) == object) {
+		g_master.byTypeId[typeId] = nullptr;
+	}
 	
-	int total = self.annotationCount ();
-	int mid = binaryFind (total, self, compare);
+}
+
+// Returns the distinct names of the annotations of 'object'.
+static QVector< QByteArray > annotationNames (Nuria::MetaObject *object) {
+	QVector< QByteArray > names;
 	
-	if (mid < 0 || self.annotation (mid).name () != name) {
-		return -1;
+	int count = object->annotationCount ();
+	for (int i = 0; i < count; i++) {
+		QByteArray name = object->annotation (i).name ();
+		if (names.isEmpty () || names.last () != name) {
+			names.append (name);
+		}
+		
+	}
+	
+	return names;
+}
+
+static void addToIndex (QHash< QByteArray, Nuria::MetaObjectMap > &index,
+			const QVector< QByteArray > &keys, const QByteArray &name,
+			Nuria::MetaObject *object) {
+	for (const QByteArray &key : keys) {
+		index[key].insert (name, object);
+	}
+	
+}
+
+static void removeFromIndex (QHash< QByteArray, Nuria::MetaObjectMap > &index,
+			     const QVector< QByteArray > &keys, const QByteArray &name) {
+	for (const QByteArray &key : keys) {
+		auto it = index.find (key);
+		if (it == index.end ()) {
+			continue;
+		}
+		
+		it->remove (name);
+		if (it->isEmpty ()) {
+			index.erase (it);
+		}
+		
 	}
 	
-	for (mid++; mid < total && self.annotation (mid).name () == name; mid++);
-	return mid - 1;
 }
 
 #define RETURN_CALL_GATE(Method, Category, Index, Nth) \
@@ -99,32 +280,39 @@ static int annotationUpperBoundImpl (T &self, const QByteArray &name) {
 
 // 
 Nuria::MetaObject *Nuria::MetaObject::byName (const QByteArray &type) {
-	MetaObject *meta = nullptr;
-	
-	g_lock.lockForRead ();
-	meta = g_metaObjects.value (type);
-	g_lock.unlock ();
-	
-	return meta;
+	RegistryReader registry;
+	return (registry) ? registry->byName.value (type) : nullptr;
 }
 
 Nuria::MetaObject *Nuria::MetaObject::byTypeId (int typeId) {
+	RegistryReader registry;
+	if (!registry) {
+		return nullptr;
+	}
+	
+	// Registered with this type id?
+	if (typeId > 0 && typeId < registry->byTypeId.size ()) {
+		if (MetaObject *meta = registry->byTypeId.at (typeId)) {
+			return meta;
+		}
+		
+	}
+	
+	// Look for it by name, the meta object may not know its type ids.
 	const char *typeName = QMetaType::typeName (typeId);
 	if (!typeName) {
 		return nullptr;
 	}
 	
-	// Look for it
 	QByteArray name = QByteArray::fromRawData (typeName, strlen (typeName));
-	QReadLocker lock (&g_lock);
-	if (MetaObject *meta = g_metaObjects.value (name)) {
+	if (MetaObject *meta = registry->byName.value (name)) {
 		return meta;
 	}
 	
 	// Failed. Is it a pointer type?
 	if (name.endsWith ('*')) {
 		name.chop (1);
-		return g_metaObjects.value (name);
+		return registry->byName.value (name);
 	}
 	
 	// Failed.
@@ -132,70 +320,134 @@ Nuria::MetaObject *Nuria::MetaObject::byTypeId (int typeId) {
 }
 
 Nuria::MetaObjectMap Nuria::MetaObject::typesInheriting (const QByteArray &typeName) {
-	MetaObjectMap map;
+	RegistryReader registry;
+	return (registry) ? registry->byParent.value (typeName) : MetaObjectMap ();
+}
+
+Nuria::MetaObjectMap Nuria::MetaObject::typesWithAnnotation (const QByteArray &name) {
+	RegistryReader registry;
+	return (registry) ? registry->byAnnotation.value (name) : MetaObjectMap ();
+}
+
+Nuria::MetaObjectMap Nuria::MetaObject::allTypes () {
+	RegistryReader registry;
+	return (registry) ? registry->all : MetaObjectMap ();
+}
+
+// Data of a type needed to register it. Gathered before taking the lock.
+struct Registration {
+	Nuria::MetaObject *object;
+	QByteArray name;
+	int typeId;
+	int pointerTypeId;
+	QVector< QByteArray > parents;
+	QVector< QByteArray > annotations;
+};
+
+static Registration prepareRegistration (Nuria::MetaObject *object) {
+	return Registration { object, object->className (), object->metaTypeId (), object->pointerMetaTypeId (),
+			      object->parents (), annotationNames (object) };
+}
+
+// Adds 'reg' to 'g_master'. The registry lock must be held.
+static void applyRegistration (const Registration &reg) {
+	Nuria::MetaObject *old = g_master.all.value (reg.name, reg.object);
+	if (old != reg.object) {
+		nWarn() << "Registering already registered type" << reg.name;
+		removeFromIndex (g_master.byParent, old->parents (), reg.name);
+		removeFromIndex (g_master.byAnnotation, annotationNames (old), reg.name);
+		unindexTypeId (old->metaTypeId (), old);
+		unindexTypeId (old->pointerMetaTypeId (), old);
+	}
 	
-	g_lock.lockForRead ();
-	auto it = g_metaObjects.constBegin ();
-	auto end = g_metaObjects.constEnd ();
+	addToIndex (g_master.byParent, reg.parents, reg.name, reg.object);
+	addToIndex (g_master.byAnnotation, reg.annotations, reg.name, reg.object);
+	g_master.all.insert (reg.name, reg.object);
+	g_master.byName.insert (reg.name, reg.object);
+	indexTypeId (reg.typeId, reg.object);
+	indexTypeId (reg.pointerTypeId, reg.object);
+}
+
+void Nuria::MetaObject::registerMetaObject (Nuria::MetaObject *object) {
+	Registration reg = prepareRegistration (object);
 	
-	for (; it != end; ++it) {
-		QVector< QByteArray > parents = it.value ()->parents ();
-		if (std::binary_search (parents.constBegin (), parents.constEnd (), typeName)) {
-			map.insert (it.key (), it.value ());
-		}
-		
-	}
+//	nDebug() << "Registering" << object << reg.name;
 	
-	g_lock.unlock ();
+	QMutexLocker lock (&g_registryMutex);
+	applyRegistration (reg);
+	g_stale.storeRelease (1);
 	
-	return map;
 }
 
-Nuria::MetaObjectMap Nuria::MetaObject::typesWithAnnotation (const QByteArray &name) {
-	MetaObjectMap map;
-	
-	auto compare = [&name](int i, MetaObject *obj) {
-		return obj->annotation (i).name () < name;
-	};
+void Nuria::MetaObject::registerMetaObjects (const MetaObjectMap &objects) {
+	QVector< Registration > registrations;
+	registrations.reserve (objects.size ());
 	
-	g_lock.lockForRead ();
-	auto it = g_metaObjects.constBegin ();
-	auto end = g_metaObjects.constEnd ();
+	for (MetaObject *object : objects) {
+		registrations.append (prepareRegistration (object));
+	}
 	
-	for (; it != end; ++it) {
-		MetaObject *cur = *it;
-		int idx = binaryFind (cur->annotationCount (), cur, compare);
-		
-		if (idx != -1 && cur->annotation (idx).name () == name) {
-			map.insert (it.key (), cur);
-		}
-		
+	// Apply all at once
+	QMutexLocker lock (&g_registryMutex);
+	for (const Registration &reg : registrations) {
+		applyRegistration (reg);
 	}
 	
-	g_lock.unlock ();
+	g_stale.storeRelease (1);
 	
-	return map;
 }
 
-Nuria::MetaObjectMap Nuria::MetaObject::allTypes () {
-	return g_metaObjects;
+Nuria::MetaObject::MetaObject ()
+	: m_lookupIndex (nullptr), m_retiredIndexes (nullptr)
+{
+	
 }
 
-void Nuria::MetaObject::registerMetaObject (Nuria::MetaObject *object) {
-	QByteArray name = object->className ();
+Nuria::MetaObject::~MetaObject () {
+	delete this->m_lookupIndex.loadAcquire ();
 	
-//	nDebug() << "Registering" << object << name;
+	Internal::MetaObjectIndex *cur = this->m_retiredIndexes.loadAcquire ();
+	while (cur) {
+		Internal::MetaObjectIndex *next = cur->nextRetired;
+		delete cur;
+		cur = next;
+	}
 	
-	g_lock.lockForWrite ();
-	if (g_metaObjects.value (name, object) != object) {
-		nWarn() << "Registering already registered type" << name;
+}
+
+void Nuria::MetaObject::invalidateLookupIndex () {
+	Internal::MetaObjectIndex *index = this->m_lookupIndex.fetchAndStoreOrdered (nullptr);
+	if (!index) {
+		return;
 	}
 	
-	g_metaObjects.insert (name, object);
-	g_lock.unlock ();
+	// Other threads may still use it, so keep it around.
+	do {
+		index->nextRetired = this->m_retiredIndexes.loadAcquire ();
+	} while (!this->m_retiredIndexes.testAndSetOrdered (index->nextRetired, index));
 	
 }
 
+void Nuria::MetaObject::discardLookupIndex () {
+	delete this->m_lookupIndex.fetchAndStoreOrdered (nullptr);
+}
+
+const Nuria::Internal::MetaObjectIndex *Nuria::MetaObject::lookupIndex () const {
+	Internal::MetaObjectIndex *index = this->m_lookupIndex.loadAcquire ();
+	if (index) {
+		return index;
+	}
+	
+	// Build it. If another thread was faster, use its index instead.
+	index = new Internal::MetaObjectIndex (const_cast< MetaObject * > (this));
+	if (!this->m_lookupIndex.testAndSetOrdered (nullptr, index)) {
+		delete index;
+		index = this->m_lookupIndex.loadAcquire ();
+	}
+	
+	return index;
+}
+
 QByteArray Nuria::MetaObject::className () {
 	QByteArray name;
 	gateCall (GateMethod::ClassName, 0, 0, 0, &name);
@@ -232,11 +484,11 @@ Nuria::MetaAnnotation Nuria::MetaObject::annotation (int idx) const {
 }
 
 int Nuria::MetaObject::annotationLowerBound (const QByteArray &name) const {
-	return annotationLowerBoundImpl (*const_cast< MetaObject * > (this), name);
+	return lookupIndex ()->annotationLowerBound (ObjectCategory, 0, name);
 }
 
 int Nuria::MetaObject::annotationUpperBound (const QByteArray &name) const {
-	return annotationUpperBoundImpl (*const_cast< MetaObject * > (this), name);
+	return lookupIndex ()->annotationUpperBound (ObjectCategory, 0, name);
 }
 
 int Nuria::MetaObject::methodCount () {
@@ -250,37 +502,11 @@ Nuria::MetaMethod Nuria::MetaObject::method (int idx) {
 }
 
 int Nuria::MetaObject::methodLowerBound (const QByteArray &name) {
-	auto compare = [&name](int i, MetaObject *obj) {
-		return obj->method (i).name () < name;
-	};
-	
-	int total = methodCount ();
-	int mid = binaryFind (total, this, compare);
-	
-	if (mid < 0 || MetaMethod (this, mid).name () != name) {
-		return -1;
-	}
-	
-	for (mid--; mid >= 0 && method (mid).name () == name; mid--);
-	return mid + 1;
-	
+	return lookupIndex ()->methodLowerBound (name);
 }
 
 int Nuria::MetaObject::methodUpperBound (const QByteArray &name) {
-	auto compare = [&name](int i, MetaObject *obj) {
-		return obj->method (i).name () < name;
-	};
-	
-	int total = methodCount ();
-	int mid = binaryFind (total, this, compare);
-	
-	if (mid < 0 || MetaMethod (this, mid).name () != name) {
-		return -1;
-	}
-	
-	for (mid++; mid < total && method (mid).name () == name; mid++);
-	return mid - 1;
-	
+	return lookupIndex ()->methodUpperBound (name);
 }
 
 inline static bool methodArgumentCheck (const QVector< QByteArray > &prototype,
@@ -290,13 +516,46 @@ inline static bool methodArgumentCheck (const QVector< QByteArray > &prototype,
     return (i == arguments.size ());
 }
 
+// Hash of a method prototype, used by the prototype cache.
+static uint prototypeHash (const QVector< QByteArray > &prototype) {
+	uint hash = uint (prototype.size ());
+	for (const QByteArray &cur : prototype) {
+		hash = hash * 31 + qHash (cur);
+	}
+	
+	return hash;
+}
+
+int Nuria::MetaObject::methodIndex (const QVector< QByteArray > &prototype) {
+	if (prototype.isEmpty ()) {
+		return -1;
+	}
+	
+	const Internal::MetaObjectIndex *index = lookupIndex ();
+	uint hash = prototypeHash (prototype);
+	int result = index->findPrototype (prototype, hash);
+	
+	// Resolve and remember it
+	if (result == -2) {
+		result = resolveMethod (prototype);
+		index->insertPrototype (prototype, hash, result);
+	}
+	
+	return result;
+}
+
 Nuria::MetaMethod Nuria::MetaObject::method (const QVector< QByteArray > &prototype) {
+	int index = methodIndex (prototype);
+	return (index < 0) ? MetaMethod () : MetaMethod (this, index);
+}
+
+int Nuria::MetaObject::resolveMethod (const QVector< QByteArray > &prototype) {
 	int lowerBound = methodLowerBound (prototype.first ());
 	int upperBound = methodUpperBound (prototype.first ());
 	
 	// Found?
 	if (lowerBound < 0) {
-		return MetaMethod ();
+		return -1;
 	}
 	
 	// Not overloaded?
@@ -304,11 +563,11 @@ Nuria::MetaMethod Nuria::MetaObject::method (const QVector< QByteArray > &protot
 		QVector< QByteArray > args = MetaMethod (this, lowerBound).argumentTypes ();
         if (args.size () + 1 == prototype.size () &&
 		    methodArgumentCheck (prototype, args)) {
-			return MetaMethod (this, lowerBound);
+			return lowerBound;
 			
 		}
 		
-		return MetaMethod ();
+		return -1;
 	}
 	
 	// Argument count
@@ -317,7 +576,7 @@ Nuria::MetaMethod Nuria::MetaObject::method (const QVector< QByteArray > &protot
     int maxArguments = MetaMethod (this, upperBound).argumentTypes ().size ();
 	
 	if (argumentCount < leastArguments || argumentCount > maxArguments) {
-		return MetaMethod ();
+		return -1;
 	}
 	
 	// Test possible methods
@@ -327,13 +586,13 @@ Nuria::MetaMethod Nuria::MetaObject::method (const QVector< QByteArray > &protot
 		// Test argument count and types
         if (args.size () == argumentCount &&
 		    methodArgumentCheck (prototype, args)) {
-			return MetaMethod (this, i);
+			return i;
 		}
 		
 	}
 	
 	// Not found.
-	return MetaMethod ();
+	return -1;
 	
 }
 
@@ -352,12 +611,8 @@ Nuria::MetaField Nuria::MetaObject::field (int idx) {
 }
 
 Nuria::MetaField Nuria::MetaObject::fieldByName (const QByteArray &name) {
-	auto compare = [&name](int i, MetaObject *obj) {
-		return obj->field (i).name () < name;
-	};
-	
-	int index = binaryFind (fieldCount (), this, compare);
-	if (index < 0 || MetaField (this, index).name () != name) {
+	int index = lookupIndex ()->fieldIndex (name);
+	if (index < 0) {
 		return MetaField ();
 	}
 	
@@ -375,12 +630,8 @@ Nuria::MetaEnum Nuria::MetaObject::enumAt (int idx) {
 }
 
 Nuria::MetaEnum Nuria::MetaObject::enumByName (const QByteArray &name) {
-	auto compare = [&name](int i, MetaObject *obj) {
-		return MetaEnum (obj, i).name () < name;
-	};
-	
-	int index = binaryFind (enumCount (), this, compare);
-	if (index < 0 || MetaEnum (this, index).name () != name) {
+	int index = lookupIndex ()->enumIndex (name);
+	if (index < 0) {
 		return MetaEnum ();
 	}
 	
@@ -477,6 +728,64 @@ Nuria::Callback Nuria::MetaMethod::testCallback (void *instance) const {
 	return result;
 }
 
+QVariant Nuria::MetaMethod::invoke (void *instance, void **args, int *types) const {
+	int count = 0;
+	const Callback *cb = invoker (&count);
+	if (!cb) {
+		return (this->m_meta) ? callback (instance).invoke (argumentTypes ().size (), args, types)
+				      : QVariant ();
+	}
+	
+	// Prepend the instance
+	QVarLengthArray< void *, 16 > list (count + 1);
+	QVarLengthArray< int, 16 > listTypes (count + 1);
+	list[0] = &instance;
+	listTypes[0] = QMetaType::VoidStar;
+	
+	for (int i = 0; i < count; i++) {
+		list[i + 1] = args[i];
+		listTypes[i + 1] = types[i];
+	}
+	
+	return cb->invoke (count + 1, list.data (), listTypes.data ());
+}
+
+const Nuria::Callback *Nuria::MetaMethod::invoker (int *argumentCount) const {
+	if (!this->m_meta) {
+		return nullptr;
+	}
+	
+	QAtomicPointer< Internal::MethodInvoker > *slot = this->m_meta->lookupIndex ()->invoker (this->m_index);
+	if (!slot) {
+		return nullptr;
+	}
+	
+	// Prepare it on first use. If another thread was faster, use its one.
+	Internal::MethodInvoker *prepared = slot->loadAcquire ();
+	if (!prepared) {
+		prepared = new Internal::MethodInvoker;
+		prepared->argumentCount = argumentTypes ().size ();
+		this->m_meta->gateCall (MetaObject::GateMethod::MethodInvoker, 0, this->m_index,
+					0, &prepared->callback);
+		
+		if (!slot->testAndSetOrdered (nullptr, prepared)) {
+			delete prepared;
+			prepared = slot->loadAcquire ();
+		}
+		
+	}
+	
+	if (!prepared->callback.isValid ()) {
+		return nullptr;
+	}
+	
+	if (argumentCount) {
+		*argumentCount = prepared->argumentCount;
+	}
+	
+	return &prepared->callback;
+}
+
 int Nuria::MetaMethod::annotationCount () const {
 	int result = 0;
 	RETURN_CALL_GATE(MetaObject::GateMethod::AnnotationCount, MethodCategory, this->m_index, 0);
@@ -492,11 +801,19 @@ Nuria::MetaAnnotation Nuria::MetaMethod::annotation (int idx) const {
 }
 
 int Nuria::MetaMethod::annotationLowerBound (const QByteArray &name) const {
-	return annotationLowerBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationLowerBound (MethodCategory, this->m_index, name);
 }
 
 int Nuria::MetaMethod::annotationUpperBound (const QByteArray &name) const {
-	return annotationUpperBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationUpperBound (MethodCategory, this->m_index, name);
 }
 
 Nuria::MetaField::MetaField ()
@@ -548,6 +865,104 @@ bool Nuria::MetaField::write (void *instance, const QVariant &value) {
 	
 }
 
+// Replaces the value of 'type' at 'target' with a copy of 'source'.
+static bool replaceValue (int type, void *target, const void *source) {
+	QMetaType::destruct (type, target);
+	return QMetaType::construct (type, target, source);
+}
+
+bool Nuria::MetaField::readInto (void *instance, void *out, int typeId) const {
+	const Internal::FieldAccessor *fieldAccessor = accessor ();
+	if (!fieldAccessor) {
+		return false;
+	}
+	
+	// Plain member?
+	if (fieldAccessor->offset >= 0 && fieldAccessor->typeId == typeId) {
+		return replaceValue (typeId, out, static_cast< char * > (instance) + fieldAccessor->offset);
+	}
+	
+	// Ask the back-end
+	bool result = false;
+	void *additional[] = { instance, out, &typeId };
+	this->m_meta->gateCall (MetaObject::GateMethod::FieldReadInto, 0,
+				this->m_index, 0, &result, additional);
+	if (result) {
+		return true;
+	}
+	
+	// Fall back to read()
+	QVariant value = read (instance);
+	if (!value.isValid () || (value.userType () != typeId && !value.convert (typeId))) {
+		return false;
+	}
+	
+	return replaceValue (typeId, out, value.constData ());
+}
+
+bool Nuria::MetaField::writeFrom (void *instance, const void *value, int typeId) {
+	const Internal::FieldAccessor *fieldAccessor = accessor ();
+	if (!fieldAccessor || !fieldAccessor->writable) {
+		return false;
+	}
+	
+	// Plain member?
+	if (fieldAccessor->offset >= 0 && fieldAccessor->typeId == typeId) {
+		return replaceValue (typeId, static_cast< char * > (instance) + fieldAccessor->offset, value);
+	}
+	
+	// Ask the back-end
+	bool result = false;
+	void *additional[] = { instance, const_cast< void * > (value), &typeId };
+	this->m_meta->gateCall (MetaObject::GateMethod::FieldWriteFrom, 0,
+				this->m_index, 0, &result, additional);
+	if (result) {
+		return true;
+	}
+	
+	// Fall back to write()
+	return write (instance, QVariant (typeId, value));
+}
+
+int Nuria::MetaField::offset () const {
+	const Internal::FieldAccessor *fieldAccessor = accessor ();
+	return (fieldAccessor) ? fieldAccessor->offset : -1;
+}
+
+const Nuria::Internal::FieldAccessor *Nuria::MetaField::accessor () const {
+	if (!this->m_meta) {
+		return nullptr;
+	}
+	
+	QAtomicPointer< Internal::FieldAccessor > *slot = this->m_meta->lookupIndex ()->fieldAccessor (this->m_index);
+	if (!slot) {
+		return nullptr;
+	}
+	
+	// Prepare it on first use. If another thread was faster, use its one.
+	Internal::FieldAccessor *prepared = slot->loadAcquire ();
+	if (!prepared) {
+		prepared = new Internal::FieldAccessor;
+		prepared->offset = -1;
+		prepared->typeId = QMetaType::type (typeName ().constData ());
+		prepared->writable = (access () & WriteOnly);
+		this->m_meta->gateCall (MetaObject::GateMethod::FieldOffset, 0,
+					this->m_index, 0, &prepared->offset);
+		
+		if (prepared->typeId == QMetaType::UnknownType) {
+			prepared->offset = -1;
+		}
+		
+		if (!slot->testAndSetOrdered (nullptr, prepared)) {
+			delete prepared;
+			prepared = slot->loadAcquire ();
+		}
+		
+	}
+	
+	return prepared;
+}
+
 int Nuria::MetaField::annotationCount () const {
 	int result = 0;
 	RETURN_CALL_GATE(MetaObject::GateMethod::AnnotationCount, FieldCategory, this->m_index, 0);
@@ -562,11 +977,19 @@ Nuria::MetaAnnotation Nuria::MetaField::annotation (int idx) const {
 }
 
 int Nuria::MetaField::annotationLowerBound (const QByteArray &name) const {
-	return annotationLowerBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationLowerBound (FieldCategory, this->m_index, name);
 }
 
 int Nuria::MetaField::annotationUpperBound (const QByteArray &name) const {
-	return annotationUpperBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationUpperBound (FieldCategory, this->m_index, name);
 }
 
 
@@ -601,36 +1024,56 @@ int Nuria::MetaEnum::value (int at) const {
 }
 
 QByteArray Nuria::MetaEnum::valueToKey (int value) const {
-	if (!this->m_meta) {
+	const Internal::EnumTable *enumTable = table ();
+	if (!enumTable) {
 		return QByteArray ();
 	}
 	
-	int count = elementCount ();
-	for (int i = 0; i < count; i++) {
-		if (this->value (i) == value) {
-			return key (i);
-		}
-		
+	int index = enumTable->indexOfValue (value);
+	return (index != -1) ? enumTable->key (index) : QByteArray ();
+}
+
+int Nuria::MetaEnum::keyToValue (const QByteArray &key) const {
+	const Internal::EnumTable *enumTable = table ();
+	if (!enumTable) {
+		return -1;
 	}
 	
-	return QByteArray ();
+	int index = enumTable->indexOfKey (key);
+	return (index != -1) ? enumTable->value (index) : -1;
+	
 }
 
-int Nuria::MetaEnum::keyToValue (const QByteArray &key) const {
+const Nuria::Internal::EnumTable *Nuria::MetaEnum::table () const {
 	if (!this->m_meta) {
-		return -1;
+		return nullptr;
 	}
 	
-	int count = elementCount ();
-	for (int i = 0; i < count; i++) {
-		if (this->key (i) == key) {
-			return value (i);
+	QAtomicPointer< Internal::EnumTable > *slot = this->m_meta->lookupIndex ()->enumTable (this->m_index);
+	if (!slot) {
+		return nullptr;
+	}
+	
+	// Build it on first use. If another thread was faster, use its one.
+	Internal::EnumTable *enumTable = slot->loadAcquire ();
+	if (!enumTable) {
+		int count = elementCount ();
+		QVector< QByteArray > keys (count);
+		QVector< int > values (count);
+		for (int i = 0; i < count; i++) {
+			keys[i] = key (i);
+			values[i] = value (i);
+		}
+		
+		enumTable = new Internal::EnumTable (keys, values);
+		if (!slot->testAndSetOrdered (nullptr, enumTable)) {
+			delete enumTable;
+			enumTable = slot->loadAcquire ();
 		}
 		
 	}
 	
-	return -1;
-	
+	return enumTable;
 }
 
 int Nuria::MetaEnum::annotationCount () const {
@@ -647,9 +1090,17 @@ Nuria::MetaAnnotation Nuria::MetaEnum::annotation (int idx) const {
 }
 
 int Nuria::MetaEnum::annotationLowerBound (const QByteArray &name) const {
-	return annotationLowerBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationLowerBound (EnumCategory, this->m_index, name);
 }
 
 int Nuria::MetaEnum::annotationUpperBound (const QByteArray &name) const {
-	return annotationLowerBoundImpl (*this, name);
+	if (!this->m_meta) {
+		return -1;
+	}
+	
+	return this->m_meta->lookupIndex ()->annotationUpperBound (EnumCategory, this->m_index, name);
 }
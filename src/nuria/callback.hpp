@@ -19,8 +19,10 @@
 
 #include <type_traits>
 #include <functional>
+#include <new>
 
 #include <QSharedData>
+#include <QFuture>
 #include <QMetaType>
 #include <QVariant>
 #include <QList>
@@ -75,6 +77,74 @@ namespace CallbackHelper {
 	
 }
 
+/**
+ * \brief Non-owning view on the arguments of a variadic Callback invocation.
+ * 
+ * A variadic callback, whose target method takes a ArgumentView instead of a
+ * QVariantList, receives the passed arguments without copying them. Values
+ * are only wrapped in a QVariant when asked for.
+ * 
+ * \warning The view and the values are only valid during the invocation.
+ * Use toList() to keep them.
+ */
+class NURIA_CORE_EXPORT ArgumentView {
+public:
+	
+	/** Constructs an empty view. */
+	ArgumentView () = default;
+	
+	/** Constructs a view on \a count arguments of \a types. */
+	ArgumentView (int count, void **args, const int *types);
+	
+	/** Constructs a view on the elements of \a list. */
+	ArgumentView (const QVariantList &list);
+	
+	/** Returns the count of arguments. */
+	int count () const;
+	
+	/** Returns \c true if there are no arguments. */
+	bool isEmpty () const;
+	
+	/**
+	 * Returns the type of the argument at \a index. For arguments passed
+	 * as QVariant, this is the type of the contained value.
+	 */
+	int type (int index) const;
+	
+	/** Returns a pointer to the value of the argument at \a index. */
+	const void *data (int index) const;
+	
+	/** Returns the argument at \a index as QVariant. */
+	QVariant at (int index) const;
+	
+	/** \overload */
+	inline QVariant operator[] (int index) const
+	{ return at (index); }
+	
+	/**
+	 * Returns the argument at \a index as \c T. If the argument is not of
+	 * type \c T, it is converted using QVariant.
+	 */
+	template< typename T >
+	T value (int index) const {
+		if (type (index) == qMetaTypeId< T > ()) {
+			return *reinterpret_cast< const T * > (data (index));
+		}
+		
+		return at (index).template value< T > ();
+	}
+	
+	/** Returns a copy of all arguments. */
+	QVariantList toList () const;
+	
+private:
+	int m_count = 0;
+	void **m_args = nullptr;
+	const int *m_types = nullptr;
+	const QVariantList *m_list = nullptr;
+	
+};
+
 /**
  * \brief A modern style callback mechanism which can be bound to various method
  * types including slots.
@@ -117,6 +187,9 @@ namespace CallbackHelper {
  * variables are applied after this process. The placeholder \a _1 points to the
  * QVariantList.
  * 
+ * If the target method takes a ArgumentView instead of a QVariantList, the
+ * arguments are not copied at all, but passed as they are.
+ * 
  * \par Binding
  * Just like std::function Callback supports a mechanism to bind arguments to
  * a callback. Placeholders are also supported (Using _1, ..., _10).
@@ -130,7 +203,7 @@ namespace CallbackHelper {
  * be blocked until the callee (The slot) has finished its operation. If the
  * callee returns something different than a \a void, then the caller will be
  * \b blocked until the callee finished and returned the result to the calling
- * thread.
+ * thread. Use invokeAsync() to receive the result without blocking.
  *  
  * \par Multi-threading
  * Callback is \b re-entrant. Do not change a instance from multiple threads
@@ -240,7 +313,10 @@ public:
 	/** Returns the type of this callback. */
 	Type type () const;
 	
-	/** Returns if this callback is variadic. */
+	/**
+	 * Returns if this callback is variadic.
+	 * \sa ArgumentView
+	 */
 	bool isVariadic () const;
 	
 	/** Sets if this callback is variadic or not. */
@@ -259,10 +335,8 @@ public:
 	// 
 	template< typename Ret, typename ... Args >
 	bool setCallback (Ret (*func)(Args ...)) {
-		QList< int > args;
-		buildArgList< Args ... > (args);
-		return initBase (new MethodHelper< Ret, Args ... > (func),
-				 CallbackHelper::typeId< Ret > (), args);
+		typedef MethodHelper< Ret, Args ... > Helper;
+		return initTrampoline< Ret, Args ... > (new (prepareTrampoline (sizeof (Helper))) Helper (func));
 	}
 	
 	// Member methods
@@ -274,19 +348,15 @@ public:
 	
 	template< typename Class, typename Ret, typename ... Args >
 	bool setCallback (Class *instance, Ret (Class::*func)(Args ...)) {
-		QList< int > args;
-		buildArgList< Args ... > (args);
-		return initBase (new MemberMethodHelper< Class, Ret, Args ... > (instance, func),
-				 CallbackHelper::typeId< Ret > (), args);
+		typedef MemberMethodHelper< Class, Ret, Args ... > Helper;
+		return initTrampoline< Ret, Args ... > (new (prepareTrampoline (sizeof (Helper))) Helper (instance, func));
 	}
 	
 	// std::function
 	template< typename Ret, typename ... Args >
 	bool setCallback (std::function< Ret(Args ...) > func) {
-		QList< int > args;
-		buildArgList< Args ... > (args);
-		return initBase (new LambdaHelper< std::function< Ret(Args ...) >, Ret, Args ... > (func),
-				 CallbackHelper::typeId< Ret > (), args);
+		typedef LambdaHelper< std::function< Ret(Args ...) >, Ret, Args ... > Helper;
+		return initTrampoline< Ret, Args ... > (new (prepareTrampoline (sizeof (Helper))) Helper (func));
 	}
 	
 	/**
@@ -299,6 +369,9 @@ public:
 	 * current thread. If it lives in another thread,
 	 * \c Qt::BlockingQueuedConnection is chosen when the callback returns
 	 * something (as in, is non-void), else \c Qt::QueuedConnection is used.
+	 * 
+	 * The slot is resolved once here and later invoked through the
+	 * meta-call of its class, so there's no limit on the argument count.
 	 */
 	bool setCallback (QObject *receiver, const char *slot,
 	                  Qt::ConnectionType connectionType = Qt::AutoConnection);
@@ -362,11 +435,108 @@ public:
 		return invoke (0, 0, 0);
 	}
 	
+	/**
+	 * Invokes the callback in \a thread, passing \a args, and returns a
+	 * future which will receive the result. The calling thread is never
+	 * blocked, even if the callback returns something.
+	 * 
+	 * If \a thread is \c nullptr, slots are invoked in the thread of
+	 * their receiver and all other callbacks in the current thread, once
+	 * control returns to its event loop. The future is canceled if
+	 * \a thread finishes before the callback could be invoked.
+	 * 
+	 * \note \a thread needs a running event loop.
+	 * 
+	 * \code
+	 * QFuture< QVariant > result = cb.invokeAsync (ioThread, 1, 2);
+	 * \endcode
+	 */
+	template< typename ... Args >
+	inline QFuture< QVariant > invokeAsync (QThread *thread, const Args &... args) const {
+		return invokeAsyncList (thread, Variant::buildList (args ...));
+	}
+	
+	/**
+	 * \overload
+	 * Use this method if you have the arguments themself as list.
+	 */
+	QFuture< QVariant > invokeAsyncList (QThread *thread, const QVariantList &arguments) const;
+	
+	/**
+	 * Invokes the callback, passing \a args, and returns the result as
+	 * \c Ret. If the types of \a args and \c Ret match the signature of
+	 * the target method exactly, it's called directly without creating a
+	 * QVariant or any temporary argument. Otherwise, this behaves like
+	 * operator() and converts the result to \c Ret afterwards.
+	 * 
+	 * Bound arguments and placeholders are resolved when binding them, so
+	 * this also works for callbacks with bound arguments, as long as the
+	 * remaining arguments match exactly.
+	 * 
+	 * \note Slots and variadic callbacks always take the slower path.
+	 * 
+	 * \code
+	 * Callback cb (someIntMethod);
+	 * int result = cb.call< int > (1, 2);
+	 * \endcode
+	 */
+	template< typename Ret, typename ... Args >
+	inline Ret call (const Args &... args) const {
+		return callImpl< Ret > (std::is_void< Ret > (), args ...);
+	}
+	
 private:
 	
 	friend class CallbackPrivate;
+	friend class CallbackList;
+	friend class CallbackListPrivate;
+	friend class MetaMethod;
 	
 	QVariant invoke (int count, void **args, int *types) const;
+	
+	/**
+	 * \internal
+	 * Calls the target method directly if the signature matches \a types
+	 * exactly. \a args and \a types are laid out like in qt_metacall(),
+	 * meaning that index 0 holds the return value. Returns \c false if the
+	 * call was not done.
+	 */
+	bool invokeDirect (int count, void **args, int *types) const;
+	
+	/** \internal Like invokeDirect(), for callbacks with bound arguments. */
+	bool invokeBoundDirect (int count, void **args, int *types) const;
+	
+	/**
+	 * \internal
+	 * Returns \c true if the callback can be called through its trampoline
+	 * without any preparation. This is not the case for slots, variadic
+	 * callbacks and callbacks with bound arguments.
+	 */
+	bool isDirectlyInvokable () const;
+	
+	template< typename Ret, typename ... Args >
+	Ret callImpl (std::false_type, const Args &... args) const {
+		Ret result = Ret ();
+		void *list[] = { &result, const_cast< Args * > (&args) ... };
+		int types[] = { qMetaTypeId< Ret > (), qMetaTypeId< Args > () ... };
+		
+		if (invokeDirect (sizeof... (Args), list, types)) {
+			return result;
+		}
+		
+		return invoke (sizeof... (Args), list + 1, types + 1).template value< Ret > ();
+	}
+	
+	template< typename Ret, typename ... Args >
+	void callImpl (std::true_type, const Args &... args) const {
+		void *list[] = { nullptr, const_cast< Args * > (&args) ... };
+		int types[] = { 0, qMetaTypeId< Args > () ... };
+		
+		if (!invokeDirect (sizeof... (Args), list, types)) {
+			invoke (sizeof... (Args), list + 1, types + 1);
+		}
+		
+	}
 	QVariant invokePrepared (const QVariantList &arguments) const;
 	
 	/** \internal */
@@ -382,39 +552,40 @@ private:
 	
 	/**
 	 * \internal
+	 * The lambda is stored as-is, so small lambdas don't need any
+	 * additional memory.
 	 */
 	template< typename Lambda, typename Ret, typename ... Args >
-	inline static Callback fromLambdaImpl (Lambda l, Ret (Lambda::*)(Args ...) const) {
-		return Callback (std::function< Ret(Args ...) > (l));
+	inline static Callback fromLambdaImpl (const Lambda &l, Ret (Lambda::*)(Args ...) const) {
+		typedef LambdaHelper< Lambda, Ret, Args ... > Helper;
+		
+		Callback cb;
+		cb.initTrampoline< Ret, Args ... > (new (cb.prepareTrampoline (sizeof (Helper))) Helper (l));
+		return cb;
 	}
 	
 	/**
 	 * \internal
-	 *  Initializes a native function.
+	 * Resets the callback and returns memory for a trampoline of \a size
+	 * bytes. Small trampolines are stored inside the d-pointer.
 	 */
-	bool initBase (TrampolineBase *base, int retType, const QList< int > &args);
+	void *prepareTrampoline (size_t size);
 	
-	template< typename T1, typename ... T2 >
-	inline void buildArgListDo (QList< int > &list, T1 cur, T2 ... next) {
-		list.append (cur);
-		buildArgListDo (list, next ...);
-	}
-	
-	template< typename T >
-	inline void buildArgListDo (QList< int > &list, T cur)
-	{ list.append (cur); }
-	
-	/** \overload No-op. */
-	inline void buildArgListDo (QList< int > &) { }
+	/**
+	 * \internal
+	 *  Initializes a native function.
+	 */
+	bool initBase (TrampolineBase *base, int retType, const int *args, int count);
 	
 	/**
 	 * \internal
-	 * This variadic template function populates \a list with the type ids
-	 * of the typenames passed in as template.
+	 * Initializes a native function, using the type ids of \a Ret and
+	 * \a Args as prototype.
 	 */
-	template< typename ... Args >
-	inline void buildArgList (QList< int > &list) {
-		buildArgListDo (list, qMetaTypeId< typename removeRef< Args >::type > () ...);
+	template< typename Ret, typename ... Args >
+	inline bool initTrampoline (TrampolineBase *base) {
+		int args[] = { qMetaTypeId< typename removeRef< Args >::type > () ..., 0 };
+		return initBase (base, CallbackHelper::typeId< Ret > (), args, sizeof... (Args));
 	}
 	
 	/**
@@ -555,5 +726,6 @@ private:
 // 
 Q_DECLARE_METATYPE(Nuria::Callback)
 Q_DECLARE_METATYPE(Nuria::Callback::Placeholder)
+Q_DECLARE_METATYPE(Nuria::ArgumentView)
 
 #endif // NURIA_CALLBACK_HPP
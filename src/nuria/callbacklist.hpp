@@ -0,0 +1,113 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NURIA_CALLBACKLIST_HPP
+#define NURIA_CALLBACKLIST_HPP
+
+#include "essentials.hpp"
+#include "callback.hpp"
+
+namespace Nuria {
+
+class CallbackListPrivate;
+
+/**
+ * \brief Multicast delegate, invoking a list of Callbacks at once.
+ * 
+ * Callbacks are added using add(), which returns an id to later remove() the
+ * callback again. Invoking the list invokes all callbacks with the given
+ * arguments. Return values are discarded.
+ * 
+ * Callbacks are invoked in the order they were added in. Consecutive
+ * callbacks sharing the same signature are grouped: The arguments are
+ * converted only once per group, and then passed to all of them. Callbacks
+ * which can't be invoked directly (Slots, variadic callbacks and callbacks
+ * with bound arguments) are invoked one after another, like a plain loop
+ * would.
+ * 
+ * \par Multi-threading
+ * Invoking the list never takes a lock, even while other threads add or
+ * remove callbacks: Changes create a new list, which is used by invocations
+ * started afterwards. Invocations which are still running continue using the
+ * list they started with.
+ */
+class NURIA_CORE_EXPORT CallbackList {
+public:
+	
+	/** Constructs an empty list. */
+	CallbackList ();
+	
+	/** Destructor. */
+	~CallbackList ();
+	
+	/**
+	 * Adds \a callback to the list and returns its id. The id is never
+	 * \c 0.
+	 */
+	int add (const Callback &callback);
+	
+	/**
+	 * Removes the callback with \a id from the list. Returns \c true on
+	 * success.
+	 */
+	bool remove (int id);
+	
+	/** Removes all callbacks. */
+	void clear ();
+	
+	/** Returns the count of callbacks in the list. */
+	int size () const;
+	
+	/** Returns \c true if there are no callbacks in the list. */
+	bool isEmpty () const;
+	
+	/** Returns all callbacks in the order they were added in. */
+	QList< Callback > callbacks () const;
+	
+	/**
+	 * Invokes all callbacks using \a arguments.
+	 * \sa operator()
+	 */
+	void invoke (const QVariantList &arguments) const;
+	
+	/**
+	 * Invokes all callbacks, passing \a args.
+	 */
+	template< typename ... Args >
+	void operator() (const Args &... args) const {
+		void *list[sizeof... (Args)];
+		int types[sizeof... (Args)];
+		CallbackHelper::getArguments (list, types, 0, const_cast< Args * > (&args) ...);
+		invoke (sizeof... (Args), list, types);
+	}
+	
+	/** Invokes all callbacks without arguments. */
+	inline void operator() () const {
+		invoke (0, nullptr, nullptr);
+	}
+	
+private:
+	Q_DISABLE_COPY(CallbackList)
+	
+	void invoke (int count, void **args, int *types) const;
+	
+	CallbackListPrivate *d;
+	
+};
+
+}
+
+#endif // NURIA_CALLBACKLIST_HPP
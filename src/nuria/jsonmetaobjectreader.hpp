@@ -47,6 +47,29 @@ class JsonMetaObjectReaderPrivate;
  * 
  * \note The JSON format is documented in Tria's source in src/jsongenerator.hpp
  * 
+ * \par Loading many files
+ * parseFiles() reads and parses files in parallel, and registerMetaObjects()
+ * registers all read types in one step. When loading the metadata of many
+ * libraries, this scales with the count of cores instead of files.
+ * 
+ * \par Lazy loading
+ * Processes usually only use a small fraction of all types. With setLazy(),
+ * parse() only reads the name, base classes and annotations of each type,
+ * which is enough to register it. Methods, enums and fields of a type are
+ * read the first time they're used, at most once, even if multiple threads
+ * ask for them concurrently. As errors in these elements can't be reported
+ * by parse() anymore, they're logged and leave the type partially empty.
+ * Until then, each type only keeps the compact JSON text of its own members,
+ * the parsed document is freed right away.
+ * 
+ * \par Snapshots
+ * Parsing JSON gets slow when there are many types. Instead, you can store
+ * the parsed types once using snapshot() and later load them again using
+ * loadSnapshot(). Snapshot files are mapped into memory, and the MetaObjects
+ * read their names and tables right from there instead of copying them.
+ * Snapshots are only meant to be read by the same version of this library on
+ * the same platform, loading anything else fails with \c SnapshotIsInvalid.
+ * 
  * \par Limitations
  * Please note that a lot functionality is lost, for example MetaObjects created
  * by this class are not able to call methods. Annotations are currently limited
@@ -131,9 +154,20 @@ public:
 		 */
 		FieldIsNotAnObject,
 		FieldTypeIsNotAString,
-		FieldReadOnlyIsNotABoolean
+		FieldReadOnlyIsNotABoolean,
+		/** @} */
+		
+		/**
+		 * \addtogroup Snapshot errors.
+		 * @{
+		 */
+		SnapshotFileError, ///< The snapshot file couldn't be opened or mapped.
+		SnapshotIsInvalid, ///< The snapshot is corrupt or from another version.
 		/** @} */
 		
+		/** A file passed to parseFiles() couldn't be read. */
+		FileNotReadable
+		
 	};
 	
 	/** Constructor. \sa parse */
@@ -142,6 +176,15 @@ public:
 	/** Destructor. */
 	~JsonMetaObjectReader ();
 	
+	/**
+	 * If \a lazy is \c true, types read by following calls to parse()
+	 * are only read completely when they're used. Default is \c false.
+	 */
+	void setLazy (bool lazy);
+	
+	/** Returns \c true if types are read lazily. \sa setLazy */
+	bool isLazy () const;
+	
 	/**
 	 * Parses \a jsonDocument. The format is expected to match the
 	 * one documented in Tria. Returns \c NoError on success. If a error
@@ -155,6 +198,20 @@ public:
 	/** \overload */
 	Error parse (const QByteArray &jsonData);
 	
+	/**
+	 * Reads and parses all \a fileNames concurrently on a private thread
+	 * pool. On success, the types of all files are added in the order of
+	 * \a fileNames. Returns the error of the first failed file in that
+	 * order otherwise.
+	 */
+	Error parseFiles (const QStringList &fileNames);
+	
+	/**
+	 * Registers all known types to the global meta system at once.
+	 * \sa MetaObject::registerMetaObjects
+	 */
+	void registerMetaObjects ();
+	
 	/**
 	 * Returns a list of all known source files.
 	 * \sa metaObjects
@@ -167,6 +224,26 @@ public:
 	 */
 	MetaObjectMap metaObjects (const QString &sourceFile);
 	
+	/**
+	 * Returns a binary snapshot of all known types, which can be loaded
+	 * again using loadSnapshot().
+	 */
+	QByteArray snapshot ();
+	
+	/**
+	 * Loads the snapshot stored in \a fileName by mapping it into memory.
+	 * The file must not be changed while this instance is alive. Returns
+	 * \c NoError on success.
+	 * \sa snapshot
+	 */
+	Error loadSnapshot (const QString &fileName);
+	
+	/**
+	 * \overload
+	 * Loads the snapshot in \a data, which is kept by this instance.
+	 */
+	Error loadSnapshot (const QByteArray &data);
+	
 private:
 	JsonMetaObjectReaderPrivate *d_ptr;
 };
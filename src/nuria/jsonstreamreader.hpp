@@ -121,6 +121,15 @@ public:
 	 */
 	QJsonDocument nextPendingElement (QJsonParseError *parseError = nullptr);
 	
+	/**
+	 * Returns the JSON data of the next pending element without parsing
+	 * it, e.g. to read it using a JsonTokenReader. If there's no pending
+	 * element, an empty QByteArray is returned.
+	 * 
+	 * \sa nextPendingElement Serializer::deserialize
+	 */
+	QByteArray nextPendingElementData ();
+	
 signals:
 	
 	/** Emitted for each newly found element. \sa nextPendingElement */
@@ -0,0 +1,167 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NURIA_JSONTOKENREADER_HPP
+#define NURIA_JSONTOKENREADER_HPP
+
+#include "essentials.hpp"
+#include <QByteArray>
+#include <QVariant>
+
+namespace Nuria {
+
+class JsonTokenReaderPrivate;
+
+/**
+ * \brief Pull-parser reading JSON token by token.
+ * 
+ * Instead of parsing a whole document into a QJsonDocument, this reader
+ * returns one token at a time through next(). Plain values can then be
+ * read using string(), toBool(), toInteger() and toDouble(), or as QVariant
+ * using value(). To read a whole map or list as QVariant, use readValue().
+ * 
+ * \code
+ * JsonTokenReader reader (json);
+ * while (reader.next () != JsonTokenReader::EndOfData) {
+ *     if (reader.token () == JsonTokenReader::Key) {
+ *         qDebug() << reader.string ();
+ *     }
+ * }
+ * \endcode
+ * 
+ * The reader expects a single complete JSON value, as delivered by
+ * JsonStreamReader. Syntax errors are reported by the token Error, after
+ * which the reader stays in this state.
+ * 
+ * \note The whole document has to be passed to the constructor, incremental
+ * input is not supported. Use JsonStreamReader to split a stream into values
+ * first.
+ * 
+ * \sa Serializer::deserialize
+ */
+class NURIA_CORE_EXPORT JsonTokenReader {
+public:
+	
+	enum Token {
+		
+		/** next() has not been called yet. */
+		NoToken = 0,
+		
+		/** Start of a JSON object. */
+		BeginMap,
+		
+		/** End of a JSON object. */
+		EndMap,
+		
+		/** Start of a JSON array. */
+		BeginList,
+		
+		/** End of a JSON array. */
+		EndList,
+		
+		/** Key in a JSON object. The value follows as next token. */
+		Key,
+		
+		/** A string value. */
+		String,
+		
+		/** A number. */
+		Number,
+		
+		/** \c true or \c false. */
+		Bool,
+		
+		/** \c null. */
+		Null,
+		
+		/** The whole value has been read. */
+		EndOfData,
+		
+		/** Invalid JSON was encountered. \sa errorOffset */
+		Error
+	};
+	
+	/** Constructs a reader for the JSON value in \a json. */
+	explicit JsonTokenReader (const QByteArray &json);
+	
+	/** Destructor. */
+	~JsonTokenReader ();
+	
+	/** Reads the next token and returns it. */
+	Token next ();
+	
+	/** Returns the current token. */
+	Token token () const;
+	
+	/** Returns \c true if the reader encountered invalid JSON. */
+	bool hasError () const;
+	
+	/**
+	 * Returns the offset in bytes of the invalid JSON, or \c -1 if there
+	 * was no error.
+	 */
+	int errorOffset () const;
+	
+	/** Returns the current string for the tokens Key and String. */
+	QString string () const;
+	
+	/** Returns the value of the current Bool token. */
+	bool toBool () const;
+	
+	/**
+	 * Returns \c true if the current Number token has neither a fraction
+	 * nor an exponent, and fits into a qint64.
+	 */
+	bool isInteger () const;
+	
+	/** Returns the value of the current Number token as integer. */
+	qint64 toInteger () const;
+	
+	/** Returns the value of the current Number token as double. */
+	double toDouble () const;
+	
+	/**
+	 * Returns the current plain value as QVariant. Integers are returned
+	 * as \c int if they fit, as \c qint64 otherwise. \c null and all
+	 * other tokens result in an invalid QVariant.
+	 */
+	QVariant value () const;
+	
+	/**
+	 * Reads the value starting at the current token, including all nested
+	 * maps and lists, and returns it as QVariant. Objects are returned as
+	 * QVariantMap, arrays as QVariantList. Afterwards, the current token
+	 * is the last token of the value.
+	 */
+	QVariant readValue ();
+	
+	/**
+	 * Skips the value starting at the current token, like readValue()
+	 * without building the QVariant. Returns \c false on error.
+	 */
+	bool skipValue ();
+	
+private:
+	Q_DISABLE_COPY(JsonTokenReader)
+	
+	JsonTokenReaderPrivate *d_ptr;
+	
+};
+
+} // namespace Nuria
+
+#endif // NURIA_JSONTOKENREADER_HPP
@@ -20,11 +20,19 @@
 #include "essentials.hpp"
 #include "callback.hpp"
 
+#include <QAtomicPointer>
 #include <QVariant>
 #include <QString>
 
 namespace Nuria {
 
+namespace Internal {
+class MetaObjectIndex;
+class EnumTable;
+struct MethodInvoker;
+struct FieldAccessor;
+}
+
 class MetaObject;
 class MetaMethod;
 class MetaField;
@@ -120,6 +128,10 @@ private:
  * \note Returned Callback instances are bound to whatever instance you passed
  * to the getter method.
  * 
+ * If you call methods on many instances, use invoke() or call() instead. These
+ * use an invoker which is prepared once per method, and don't create a new
+ * Callback on each call.
+ * 
  * \par Constructors
  * Unlike the Qt API, constructors are exposed as methods and to be used like
  * static methods. The returned QVariant will report a type of \c Type*.
@@ -200,6 +212,39 @@ public:
 	 */
 	Callback testCallback (void *instance = nullptr) const;
 	
+	/**
+	 * Invokes the method on \a instance, passing \a args of \a types.
+	 * Both must hold one element per argument of the method. Arguments are
+	 * validated like when using callback().
+	 * 
+	 * The first call prepares an invoker, which is then used for all
+	 * further calls, regardless of the instance.
+	 * 
+	 * \sa call
+	 */
+	QVariant invoke (void *instance, void **args, int *types) const;
+	
+	/**
+	 * Calls the method on \a instance, passing \a args, and returns the
+	 * result as \c Ret. Like Callback::call(), the method is called
+	 * directly if the types match the signature exactly.
+	 * 
+	 * \code
+	 * MetaMethod method = meta->method ({ "add", "int", "int" });
+	 * int result = method.call< int > (instance, 1, 2);
+	 * \endcode
+	 * 
+	 * \sa invoke
+	 */
+	template< typename Ret, typename ... Args >
+	inline Ret call (void *instance, const Args &... args) const {
+		if (const Callback *cb = invoker ()) {
+			return cb->call< Ret > (instance, args ...);
+		}
+		
+		return callback (instance).call< Ret > (args ...);
+	}
+	
 	/**
 	 * Returns the number of known annotations.
 	 * \sa annotation
@@ -227,6 +272,9 @@ public:
 private:
 	friend class MetaObject;
 	
+	// Returns the prepared invoker, or nullptr if there's none.
+	const Callback *invoker (int *argumentCount = nullptr) const;
+	
 	inline MetaMethod (MetaObject *meta, int index)
 		: m_meta (meta), m_index (index)
 	{}
@@ -327,6 +375,28 @@ public:
 	 */
 	bool write (void *instance, const QVariant &value);
 	
+	/**
+	 * Reads the current value from \a instance into \a out, which must
+	 * point to a constructed value of \a typeId. Plain members of type
+	 * \a typeId are copied directly, without creating a QVariant. Other
+	 * fields are converted to \a typeId if needed.
+	 * On failure \c false is returned.
+	 */
+	bool readInto (void *instance, void *out, int typeId) const;
+	
+	/**
+	 * Sets the current value in \a instance to \a value of \a typeId.
+	 * Like readInto(), plain members of type \a typeId are written
+	 * directly. On failure \c false is returned.
+	 */
+	bool writeFrom (void *instance, const void *value, int typeId);
+	
+	/**
+	 * Returns the byte offset of the field in an instance if it is a plain
+	 * data member, else \c -1 is returned.
+	 */
+	int offset () const;
+	
 	/**
 	 * Returns the number of known annotations.
 	 * \sa annotation
@@ -358,6 +428,9 @@ private:
 		: m_meta (meta), m_index (index)
 	{}
 	
+	// Returns the prepared accessor, or nullptr if this field is invalid.
+	const Internal::FieldAccessor *accessor () const;
+	
 	mutable MetaObject *m_meta;
 	short m_index;
 };
@@ -392,6 +465,10 @@ public:
 	/**
 	 * Returns the first key which points to \a value.
 	 * If no key points to \a value, a empty QByteArray is returned.
+	 * 
+	 * \note Conversions in both directions use tables which are built on
+	 * first use. The returned key shares its data with the table, so no
+	 * memory is allocated.
 	 */
 	QByteArray valueToKey (int value) const;
 	
@@ -432,6 +509,8 @@ private:
 		: m_meta (meta), m_index (index)
 	{}
 	
+	const Internal::EnumTable *table () const;
+	
 	mutable MetaObject *m_meta;
 	int m_index;
 	
@@ -541,6 +620,9 @@ typedef QMap< QByteArray, MetaObject * > MetaObjectMap;
  * 
  * This means that all elements are sorted in ascending order, which allows you
  * to use binary search algorithms.
+ * Lookups by name, like fieldByName() or methodLowerBound(), use an index
+ * which is built once per MetaObject on the first lookup. It holds all names
+ * in a single string table, so lookups don't call gateCall().
  * 
  * \par Creating types at run-time
  * You can sub-class MetaObject yourself if you need to create types at
@@ -585,12 +667,16 @@ public:
 		MethodCallback = 25, // Nuria::Callback, additional = void *instance
 		MethodUnsafeCallback = 26, // Nuria::Callback, additional = void *instance
 		MethodArgumentTest = 27, // Nuria::Callback, additional = void *instance
+		MethodInvoker = 28, // Nuria::Callback, taking the instance (void *) first
 		
 		FieldName = 30, // QByteArray
 		FieldType = 31, // QByteArray
 		FieldRead = 32, // QVariant, additional = void *instance
 		FieldWrite = 33, // bool, additional = void** = { instance, value }
 		FieldAccess = 34, // MetaField::Access
+		FieldReadInto = 35, // bool, additional = void** = { instance, out, int *typeId }
+		FieldWriteFrom = 36, // bool, additional = void** = { instance, value, int *typeId }
+		FieldOffset = 37, // int, -1 if the field is not a plain member
 		
 		EnumName = 40, // QByteArray
 		EnumElementCount = 41, // int
@@ -607,9 +693,7 @@ public:
 	 */
 	template< typename T >
 	static MetaObject *of () {
-		int id = qMetaTypeId< T * > ();
-		const char *typeName = QMetaType::typeName (id);
-		return MetaObject::byName (QByteArray (typeName, ::strlen (typeName) - 1));
+		return MetaObject::byTypeId (qMetaTypeId< T * > ());
 	}
 	
 	/**
@@ -628,12 +712,16 @@ public:
 	/**
 	 * Returns all types which inherit \a typeName.
 	 * \note A type does not inherit itself.
+	 * \note This uses an index built by registerMetaObject(), and thus
+	 * reflects the base classes at the time of registration.
 	 */
 	static MetaObjectMap typesInheriting (const QByteArray &typeName);
 	
 	/**
 	 * Returns all types which have a annotation called \a name stored
 	 * in the type. This method does not search through methods, etc.
+	 * Like typesInheriting(), this uses an index and doesn't scan all
+	 * types.
 	 */
 	static MetaObjectMap typesWithAnnotation (const QByteArray &name);
 	
@@ -654,11 +742,18 @@ public:
 	 */
 	static void registerMetaObject (MetaObject *object);
 	
-	/** Constructor, does nothing. */
-	inline MetaObject () {}
+	/**
+	 * Registers all \a objects at once. This is faster than registering
+	 * them one by one, as the registry is only locked and published once.
+	 * \sa registerMetaObject
+	 */
+	static void registerMetaObjects (const MetaObjectMap &objects);
+	
+	/** Constructor. */
+	MetaObject ();
 	
-	/** Destructor, does nothing. */
-	virtual ~MetaObject () {}
+	/** Destructor. */
+	virtual ~MetaObject ();
 	
 	/**
 	 * Returns the class name of the represented type.
@@ -736,9 +831,19 @@ public:
 	 * 
 	 * The method name of a constructor is "" (Empty).
 	 * If the method can't be found, the returned method is invalid.
+	 * 
+	 * \sa methodIndex
 	 */
 	MetaMethod method (const QVector< QByteArray > &prototype);
 	
+	/**
+	 * Returns the index of the method \a prototype, as used by method(),
+	 * or \c -1 if there's no such method. Resolved prototypes are cached,
+	 * so looking up the same prototype again is cheap. The index can be
+	 * kept and passed to method(int) later on.
+	 */
+	int methodIndex (const QVector< QByteArray > &prototype);
+	
 	/**
 	 * Destroys \a instance.
 	 * \warning \a instance must be of the type the MetaObject represents,
@@ -793,12 +898,38 @@ protected:
 	virtual void gateCall (GateMethod method, int category, int index, int nth,
 			       void *result, void *additional = 0) = 0;
 	
+	/**
+	 * Discards the index used to look up elements by name. Sub-classes
+	 * need to call this when their methods, fields, enums or annotations
+	 * change after the MetaObject has been used. Lookups still using the
+	 * old index are not disturbed, it is kept until the MetaObject is
+	 * destroyed.
+	 */
+	void invalidateLookupIndex ();
+	
+	/**
+	 * Like invalidateLookupIndex(), but frees the index right away. Only
+	 * use this while no other thread can be using this MetaObject.
+	 */
+	void discardLookupIndex ();
+	
 private:
+	Q_DISABLE_COPY(MetaObject)
 	friend class MetaAnnotation;
 	friend class MetaMethod;
 	friend class MetaField;
 	friend class MetaEnum;
 	
+	// Returns the name lookup index, building it on first use. Not built on
+	// registration, as that would populate lazy back-ends.
+	const Internal::MetaObjectIndex *lookupIndex () const;
+	
+	// Resolves 'prototype' without using the cache.
+	int resolveMethod (const QVector< QByteArray > &prototype);
+	
+	mutable QAtomicPointer< Internal::MetaObjectIndex > m_lookupIndex;
+	QAtomicPointer< Internal::MetaObjectIndex > m_retiredIndexes;
+	
 };
 
 }
@@ -48,6 +48,15 @@ class QtMetaObjectWrapperPrivate;
  * with the value as QString. To expose methods which are not public slots
  * prefix them with \c Q_INVOKABLE - This also applies to constructors.
  * 
+ * \par Lazy population
+ * Creating a wrapper is cheap: Only the class name and the base class are read
+ * up-front. The class annotations, and the methods, enums and fields, are read
+ * from the QMetaObject the first time they're accessed. This happens once,
+ * even if multiple threads access the wrapper concurrently.
+ * 
+ * Use forMetaObject() to share wrappers instead of creating a new one for
+ * each use.
+ * 
  */
 class NURIA_CORE_EXPORT QtMetaObjectWrapper : public RuntimeMetaObject {
 public:
@@ -62,13 +71,29 @@ public:
 	/** Destructor. */
 	~QtMetaObjectWrapper () override;
 	
+	/**
+	 * Returns the wrapper of \a metaObject. The wrapper is created on the
+	 * first call, and then shared process-wide. It is owned by the
+	 * process and must not be deleted. Thread-safe.
+	 */
+	static QtMetaObjectWrapper *forMetaObject (const QMetaObject *metaObject);
+	
+protected:
+	void gateCall (GateMethod method, int category, int index, int nth,
+		       void *result, void *additional) override;
+	
 private:
 	
+	void populateTypeAnnotations ();
+	void populateMembers ();
 	void installDeleter ();
 	void populateAnnotations (const QMetaObject *meta);
 	void populateMethods (const QMetaObject *meta);
 	void populateEnums (const QMetaObject *meta);
 	void populateFields (const QMetaObject *meta);
+	bool accessProperty (bool write, int index, void *additional);
+	
+	QtMetaObjectWrapperPrivate *d_ptr;
 	
 };
 
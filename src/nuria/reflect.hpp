@@ -0,0 +1,315 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NURIA_REFLECT_HPP
+#define NURIA_REFLECT_HPP
+
+#include <type_traits>
+#include <utility>
+
+#include "runtimemetaobject.hpp"
+
+namespace Nuria {
+
+/**
+ * \brief Compile-time reflection table of \c T
+ * 
+ * Where MetaObject describes a type at run-time, Reflect describes it at
+ * compile-time: The fields and methods of a type are listed as descriptors
+ * holding their name and member pointer. Code which knows the type it works
+ * on can iterate over these using templates, which the compiler can inline
+ * completely. No lookups, locks or QVariants are involved.
+ * 
+ * Types without a table use this primary template, for which \c IsReflected
+ * is \c false.
+ * 
+ * \par Writing a table
+ * A table is a specialization of Reflect deriving from ReflectedType. It's
+ * usually written by Tria for NURIA_INTROSPECT types, but can also be written
+ * by hand:
+ * 
+ * \code
+ * struct Point {
+ *   int x;
+ *   int y;
+ *   int length () const;
+ * };
+ * 
+ * namespace Nuria {
+ * template< >
+ * struct Reflect< Point > : ReflectedType< Point > {
+ *   static constexpr const char *name () { return "Point"; }
+ *   
+ *   template< typename Visitor >
+ *   static void fields (Visitor &&visit) {
+ *     visit (NURIA_REFLECT_FIELD(Point, x));
+ *     visit (NURIA_REFLECT_FIELD(Point, y));
+ *   }
+ *   
+ *   template< typename Visitor >
+ *   static void methods (Visitor &&visit) {
+ *     visit (NURIA_REFLECT_METHOD(Point, length));
+ *   }
+ * };
+ * }
+ * \endcode
+ * 
+ * Fields and methods are listed in ascending order by name, like in a
+ * MetaObject.
+ * 
+ * \par Usage
+ * Use forEachField() to visit all fields of an instance. To get a MetaObject
+ * built from the same table, use reflectedMetaObject().
+ * 
+ * \sa ReflectField ReflectMethod
+ */
+template< typename T >
+struct Reflect {
+	enum { IsReflected = false };
+};
+
+/** Base of all Reflect specializations. */
+template< typename T >
+struct ReflectedType {
+	typedef T Type;
+	enum { IsReflected = true };
+	
+	template< typename Visitor >
+	static void fields (Visitor &&) { }
+	
+	template< typename Visitor >
+	static void methods (Visitor &&) { }
+	
+};
+
+/**
+ * Descriptor of the field \a name of type \c T in \c Class.
+ * \sa NURIA_REFLECT_FIELD
+ */
+template< typename Class, typename T >
+struct ReflectField {
+	typedef Class ClassType;
+	typedef T ValueType;
+	
+	constexpr ReflectField (const char *name, T Class::*member)
+		: name (name), member (member) {}
+		
+	/** Returns the value of this field in \a object. */
+	T &get (Class &object) const { return object.*member; }
+	
+	/** \overload */
+	const T &get (const Class &object) const { return object.*member; }
+	
+	/** Sets the value of this field in \a object to \a value. */
+	void set (Class &object, const T &value) const { object.*member = value; }
+	
+	const char *name;
+	T Class::*member;
+};
+
+/**
+ * Descriptor of the method \a name of \c Class, \c Pointer being its member
+ * function pointer type.
+ * \sa NURIA_REFLECT_METHOD
+ */
+template< typename Class, typename Pointer >
+struct ReflectMethod {
+	typedef Class ClassType;
+	typedef Pointer PointerType;
+	
+	constexpr ReflectMethod (const char *name, Pointer method)
+		: name (name), method (method) {}
+		
+	/** Invokes this method on \a object, passing \a args. */
+	template< typename ... Args >
+	auto invoke (Class &object, Args &&... args) const
+	-> decltype ((std::declval< Class & > ().*std::declval< Pointer > ())(std::forward< Args > (args) ...)) {
+		return (object.*method)(std::forward< Args > (args) ...);
+	}
+	
+	const char *name;
+	Pointer method;
+};
+
+/** Creates the ReflectField of \a Field in \a Class. */
+#define NURIA_REFLECT_FIELD(Class, Field) \
+	::Nuria::ReflectField< Class, decltype(Class::Field) > (#Field, &Class::Field)
+	
+/** Creates the ReflectMethod of \a Method in \a Class. It must not be overloaded. */
+#define NURIA_REFLECT_METHOD(Class, Method) \
+	::Nuria::ReflectMethod< Class, decltype(&Class::Method) > (#Method, &Class::Method)
+	
+namespace Internal {
+
+// Passes name and value of each visited field of 'object' on to 'visitor'.
+template< typename T, typename Visitor >
+struct FieldValueVisitor {
+	T &object;
+	Visitor &visitor;
+	
+	template< typename Field >
+	void operator() (const ReflectField< typename std::remove_const< T >::type, Field > &field) const {
+		visitor (field.name, field.get (object));
+	}
+	
+};
+
+// Return and argument types of member function pointers.
+template< typename Pointer >
+struct MethodTraits;
+
+template< typename Class, typename Ret, typename ... Args >
+struct MethodTraits< Ret (Class::*)(Args ...) > {
+	typedef Ret ReturnType;
+	enum { ArgumentCount = sizeof... (Args) };
+	
+	static QVector< QByteArray > argumentTypes ();
+};
+
+template< typename Class, typename Ret, typename ... Args >
+struct MethodTraits< Ret (Class::*)(Args ...) const > : MethodTraits< Ret (Class::*)(Args ...) > { };
+
+// Returns the name of 'T' as used by MetaObject.
+template< typename T >
+QByteArray reflectTypeName () {
+	return QByteArray (QMetaType::typeName (qMetaTypeId< typename std::decay< T >::type > ()));
+}
+
+template< >
+inline QByteArray reflectTypeName< void > () {
+	return QByteArrayLiteral("void");
+}
+
+template< typename Class, typename Ret, typename ... Args >
+QVector< QByteArray > MethodTraits< Ret (Class::*)(Args ...) >::argumentTypes () {
+	return QVector< QByteArray > { reflectTypeName< Args > () ... };
+}
+
+inline bool reflectAcceptArguments (void *) { return true; }
+
+// Adds the visited fields and methods of 'T' to a RuntimeMetaObject.
+template< typename T >
+struct RuntimeMetaObjectBuilder {
+	RuntimeMetaObject *meta;
+	
+	template< typename Field >
+	void operator() (const ReflectField< T, Field > &field) const {
+		Field T::*member = field.member;
+		
+		auto getter = [member](void *instance) {
+			return QVariant::fromValue (static_cast< T * > (instance)->*member);
+		};
+		
+		auto setter = [member](void *instance, const QVariant &value) {
+			QVariant converted (value);
+			if (!converted.convert (qMetaTypeId< Field > ())) {
+				return false;
+			}
+			
+			static_cast< T * > (instance)->*member = converted.value< Field > ();
+			return true;
+		};
+		
+		meta->addField (field.name, reflectTypeName< Field > (), { }, getter, setter);
+	}
+	
+	template< typename Pointer >
+	void operator() (const ReflectMethod< T, Pointer > &method) const {
+		typedef MethodTraits< Pointer > Traits;
+		Pointer pointer = method.method;
+		
+		auto creator = [pointer](void *instance, RuntimeMetaObject::InvokeAction action) {
+			if (action == RuntimeMetaObject::InvokeAction::ArgumentTest) {
+				return Callback (reflectAcceptArguments);
+			}
+			
+			return Callback (static_cast< T * > (instance), pointer);
+		};
+		
+		QVector< QByteArray > argumentTypes = Traits::argumentTypes ();
+		QVector< QByteArray > argumentNames (argumentTypes.size ());
+		meta->addMethod (MetaMethod::Method, method.name, reflectTypeName< typename Traits::ReturnType > (),
+				 argumentNames, argumentTypes, { }, creator);
+	}
+	
+};
+
+// Returns the Qt type id of 'T', or 0 if 'T' is not known to the Qt meta system.
+template< typename T, bool Defined = QMetaTypeId2< T >::Defined >
+struct ReflectTypeId {
+	static int get () { return qMetaTypeId< T > (); }
+};
+
+template< typename T >
+struct ReflectTypeId< T, false > {
+	static int get () { return 0; }
+};
+
+template< typename T >
+MetaObject *createReflectedMetaObject () {
+	RuntimeMetaObject *meta = new RuntimeMetaObject (Reflect< T >::name ());
+	RuntimeMetaObjectBuilder< T > builder { meta };
+	Reflect< T >::fields (builder);
+	Reflect< T >::methods (builder);
+	
+	// Make it known to MetaObject::of() and byTypeId()
+	meta->setQtMetaTypeId (ReflectTypeId< T >::get ());
+	meta->setQtMetaTypePointerId (ReflectTypeId< T * >::get ());
+	meta->setInstanceDeleter ([](void *instance) { delete static_cast< T * > (instance); });
+	meta->finalize ();
+	
+	MetaObject::registerMetaObject (meta);
+	return meta;
+}
+
+} // namespace Internal
+
+/**
+ * Calls \a visitor for each field of \a object, passing the name of the field
+ * as <tt>const char *</tt> and a reference to the value. \c T must have a
+ * Reflect table. As \a visitor is called with differently typed values,
+ * it's usually a generic functor:
+ * 
+ * \code
+ * struct Printer {
+ *   template< typename T >
+ *   void operator() (const char *name, const T &value) const { ... }
+ * };
+ * \endcode
+ */
+template< typename T, typename Visitor >
+void forEachField (T &object, Visitor &&visitor) {
+	typedef typename std::remove_const< T >::type Type;
+	static_assert(Reflect< Type >::IsReflected, "T has no Reflect table");
+	
+	Reflect< Type >::fields (Internal::FieldValueVisitor< T, Visitor > { object, visitor });
+}
+
+/**
+ * Returns the MetaObject of \c T built from its Reflect table. It's created
+ * and registered on the first call. The types of all fields, arguments and
+ * return values must be known to the Qt meta system. Methods have no
+ * argument names and annotations aren't part of Reflect tables.
+ */
+template< typename T >
+MetaObject *reflectedMetaObject () {
+	static MetaObject *meta = Internal::createReflectedMetaObject< T > ();
+	return meta;
+}
+
+}
+
+#endif // NURIA_REFLECT_HPP
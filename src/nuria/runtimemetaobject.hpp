@@ -38,6 +38,13 @@ class RuntimeMetaObjectPrivate;
  * You may want to use MetaObject::registerMetaObject() if you want to make your
  * type known application-wide.
  * 
+ * \par Memory usage
+ * finalize() freezes all elements into a compact layout: Elements are stored
+ * as arrays per property, equal strings and argument lists share their data,
+ * and equal annotation maps are only stored once. Adding elements afterwards
+ * is still possible, but is more expensive, as the layout is turned back into
+ * the editable form first.
+ * 
  * \par Behaviour on uniqueness
  * The add*() methods will always ensure uniqueness. If two elements are added
  * deemed equal by C++ rules, then the latter one replaces the one already
@@ -152,6 +159,19 @@ public:
 			const QVector< QByteArray > &argumentNames, const QVector< QByteArray > &argumentTypes,
 			const AnnotationMap &annotations, InvokeCreator invokeCreator);
 	
+	/**
+	 * \overload
+	 * \a invoker is used by MetaMethod::invoke() and MetaMethod::call(),
+	 * so calls don't need to go through \a invokeCreator. It's invoked with
+	 * the instance (As \c void *) as first argument, followed by the
+	 * arguments of the method, and should behave like the callback
+	 * returned for InvokeAction::Invoke.
+	 */
+	void addMethod (MetaMethod::Type type, const QByteArray &name, const QByteArray &returnType,
+			const QVector< QByteArray > &argumentNames, const QVector< QByteArray > &argumentTypes,
+			const AnnotationMap &annotations, InvokeCreator invokeCreator,
+			const Callback &invoker);
+	
 	/**
 	 * Adds enum \a name with elements \a keyValueMap to the type.
 	 */
@@ -173,17 +193,44 @@ public:
 	void addField (const QByteArray &name, const QByteArray &valueType, const AnnotationMap &annotations,
 		       FieldGetter getter);
 	
+	/**
+	 * Adds a plain data member \a name of \a valueType, which is located
+	 * \a offset bytes into an instance. It's accessed directly, without
+	 * needing a getter or setter. \a valueType must be known to the Qt
+	 * meta system.
+	 * \sa MetaField::offset
+	 */
+	void addPlainField (const QByteArray &name, const QByteArray &valueType, const AnnotationMap &annotations,
+			    int offset, MetaField::Access access = MetaField::ReadWrite);
+	
 	/**
 	 * Calling this method will ensure that all assumptions MetaObject has
 	 * are met - That is, everything that is sorted is sorted. You \b have
 	 * to call this method before using this instance as meta-object.
+	 * 
+	 * Elements added since the last call are still visible before that,
+	 * though methods are not sorted yet and reading from multiple threads
+	 * is not safe until this method has been called. Until then, they're
+	 * read from the editable form, which is only frozen here.
+	 * 
+	 * \note The tables used by MetaEnum::valueToKey() and keyToValue()
+	 * are not built here, but on their first use.
 	 */
 	void finalize ();
 	
+	/**
+	 * Returns the count of bytes the last call to finalize() saved by
+	 * freezing the elements into a compact layout. This is an estimate,
+	 * it only considers strings, containers and their shared data.
+	 */
+	qint64 savedBytes () const;
+	
 protected:
 	void gateCall (GateMethod method, int category, int index, int nth, void *result, void *additional) override;
 	
 private:
+	void beginEdit ();
+	
 	int runtimeAnnotationCount (int category, int index);
 	QByteArray runtimeAnnotationName (int category, int index, int nth);
 	QVariant runtimeAnnotationValue (int category, int index, int nth);
@@ -193,15 +240,20 @@ private:
 	QByteArray runtimeMethodReturnType (int index);
 	QVector< QByteArray > runtimeMethodArgumentNames (int index);
 	QVector< QByteArray > runtimeMethodArgumentTypes (int index);
+	Callback createCallback (void *instance, int index, InvokeAction action);
 	Callback runtimeMethodCallback (void *instance, int index);
 	Callback runtimeMethodUnsafeCallback (void *instance, int index);
 	Callback runtimeMethodArgumentTest (void *instance, int index);
+	Callback runtimeMethodInvoker (int index);
 	
 	QByteArray runtimeFieldName (int index);
 	QByteArray runtimeFieldType (int index);
 	QVariant runtimeFieldRead (int index, void *instance);
 	bool runtimeFieldWrite (int index, void *instance, const QVariant &value);
 	MetaField::Access runtimeFieldAccess (int index);
+	int runtimeFieldOffset (int index);
+	bool runtimeFieldReadInto (int index, void *instance, void *out, int typeId);
+	bool runtimeFieldWriteFrom (int index, void *instance, const void *value, int typeId);
 	
 	QByteArray runtimeEnumName (int index);
 	int runtimeEnumElementCount (int index);
@@ -26,6 +26,10 @@
 namespace Nuria {
 
 class SerializerPrivate;
+class StructuredWriter;
+class JsonTokenReader;
+struct SerializerField;
+struct SerializerPlan;
 
 /**
  * \brief (De-)Serializer for arbitary types based on Nuria::MetaObject.
@@ -67,6 +71,12 @@ class SerializerPrivate;
  * If all above steps fail, it'll be noted in the failed list.
  * \sa failedFields
  * 
+ * \par Performance
+ * The first time a type is (de-)serialized, the serializer looks up its
+ * fields, their types and their MetaObjects once, skipping excluded ones.
+ * This is reused by later calls, until setExclude() or setAllowedTypes() is
+ * called. MetaObjects are expected to not change while a Serializer is used.
+ * 
  */
 class NURIA_CORE_EXPORT Serializer {
 public:
@@ -174,6 +184,26 @@ public:
 		return meta ? reinterpret_cast< T * > (deserialize (data, meta)) : nullptr;
 	}
 	
+	/**
+	 * Like deserialize(), but reads the JSON object from \a reader, writing
+	 * each value into its field as soon as it has been read. If the
+	 * current token of \a reader is not JsonTokenReader::BeginMap, the
+	 * next token is read first. Afterwards, the current token is the end
+	 * of the object.
+	 * 
+	 * Objects, including nested ones, of types without constructors taking
+	 * arguments are created by passing an empty map to the InstanceCreator,
+	 * and are then populated. Otherwise, or if that fails, the JSON object
+	 * is read into a QVariantMap, which is then used like deserialize()
+	 * does.
+	 * 
+	 * If the JSON is invalid, \c nullptr is returned.
+	 */
+	void *deserialize (JsonTokenReader &reader, MetaObject *meta);
+	
+	/** \overload */
+	void *deserialize (JsonTokenReader &reader, const QByteArray &typeName);
+	
 	/**
 	 * Like deserialize, but instead takes a existing \a object and
 	 * populates it with \a data. Returns \c true if no elements
@@ -191,6 +221,16 @@ public:
 		return meta ? populate (object, meta, data) : false;
 	}
 	
+	/**
+	 * Like populate(), but reads the JSON object from \a reader. Returns
+	 * \c true if no field failed and the JSON was valid.
+	 * \sa deserialize(JsonTokenReader&, MetaObject*)
+	 */
+	bool populate (void *object, MetaObject *meta, JsonTokenReader &reader);
+	
+	/** \overload */
+	bool populate (void *object, const QByteArray &typeName, JsonTokenReader &reader);
+	
 	/**
 	 * Reads all fields from \a object and puts them into a QVariantMap.
 	 * Fields can be excluded by using \a exclude.
@@ -210,6 +250,19 @@ public:
 	/** \overload */
 	QVariantMap serialize (void *object, const QByteArray &typeName);
 	
+	/**
+	 * Like serialize(), but writes the fields of \a object as map directly
+	 * into \a writer, instead of building a QVariantMap first. Fields of
+	 * types known to the meta system are written as nested maps. Returns
+	 * \c true if no field failed to serialize.
+	 * 
+	 * \sa failedFields JsonWriter CborWriter
+	 */
+	bool serialize (void *object, MetaObject *meta, StructuredWriter &writer);
+	
+	/** \overload */
+	bool serialize (void *object, const QByteArray &typeName, StructuredWriter &writer);
+	
 	/**
 	 * Default meta object finder. \a typeName is expected to be known to
 	 * the Nuria meta system.
@@ -233,11 +286,21 @@ private:
 	
 	QVariantMap serializeImpl (void *object, MetaObject *meta);
 	bool populateImpl (void *object, MetaObject *meta, const QVariantMap &data);
+	bool populateImpl (void *object, MetaObject *meta, JsonTokenReader &reader);
 	bool variantToField (QVariant &value, const QByteArray &targetType,
 			     int targetId, int sourceId, int pointerId, bool &ignored);
-	bool fieldToVariant (QVariant &value, bool &ignore);
-	bool readField (void *object, Nuria::MetaField &field, QVariantMap &data);
-	bool writeField (void *object, Nuria::MetaField &field, const QVariantMap &data);
+	void serializeImpl (void *object, MetaObject *meta, StructuredWriter &writer);
+	MetaObject *valueMetaObject (QVariant &value, const SerializerField &field, void *&dataPtr);
+	bool fieldToVariant (QVariant &value, const SerializerField &field, bool &ignore);
+	bool readField (void *object, MetaObject *meta, const SerializerField &field, QVariantMap &data);
+	bool writeField (void *object, MetaObject *meta, const SerializerField &field,
+			 const QVariantMap &data);
+	bool writeField (void *object, MetaObject *meta, const SerializerField &field,
+			 JsonTokenReader &reader);
+	bool writeValue (void *object, MetaObject *meta, const SerializerField &field, QVariant &value);
+	bool streamField (void *object, MetaObject *meta, const SerializerField &field,
+			  StructuredWriter &writer);
+	const SerializerPlan *plan (MetaObject *meta);
 };
 
 }
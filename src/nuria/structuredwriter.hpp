@@ -0,0 +1,217 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NURIA_STRUCTUREDWRITER_HPP
+#define NURIA_STRUCTUREDWRITER_HPP
+
+#include "essentials.hpp"
+#include <QByteArray>
+#include <QVariant>
+
+class QIODevice;
+
+namespace Nuria {
+
+class StructuredWriterPrivate;
+
+/**
+ * \brief Base class for writers of structured data, like JSON.
+ * 
+ * A StructuredWriter writes a tree of maps, lists and plain values into a
+ * QIODevice or a QByteArray, without building the tree in memory first.
+ * Maps and lists are opened with beginMap() and beginList() and closed with
+ * endMap() and endList(). Inside a map, each value is preceded by a call to
+ * writeKey().
+ * 
+ * \code
+ * JsonWriter writer (&socket);
+ * writer.beginMap ();
+ * writer.writeKey ("answer");
+ * writer.writeInt (42);
+ * writer.endMap ();
+ * \endcode
+ * 
+ * \par Buffering
+ * When writing into a QIODevice, data is collected in a small internal
+ * buffer first, which is written to the device whenever it's full. Call
+ * flush() to write the rest of it. The destructor does this automatically.
+ * When writing into a QByteArray, data is appended to it directly.
+ * 
+ * \note The writer does not check if the calls make up a valid document.
+ * 
+ * \sa JsonWriter CborWriter Serializer
+ */
+class NURIA_CORE_EXPORT StructuredWriter {
+public:
+	
+	enum {
+		/** Size of the internal buffer when writing into a device. */
+		BufferSize = 4096
+	};
+	
+	/** Constructs a writer writing into \a device. */
+	explicit StructuredWriter (QIODevice *device);
+	
+	/** Constructs a writer appending to \a buffer. */
+	explicit StructuredWriter (QByteArray *buffer);
+	
+	/** Destructor. Calls flush(). */
+	virtual ~StructuredWriter ();
+	
+	/**
+	 * Writes buffered data into the device. Returns \c false if the device
+	 * failed to accept it.
+	 */
+	bool flush ();
+	
+	/** Returns \c true if writing into the device failed. */
+	bool hasError () const;
+	
+	/** Begins a new map. */
+	virtual void beginMap () = 0;
+	
+	/** Ends the current map. */
+	virtual void endMap () = 0;
+	
+	/** Begins a new list. */
+	virtual void beginList () = 0;
+	
+	/** Ends the current list. */
+	virtual void endList () = 0;
+	
+	/** Writes the \a key of the next value of the current map. */
+	virtual void writeKey (const QString &key) = 0;
+	
+	/** Writes a null value. */
+	virtual void writeNull () = 0;
+	
+	/** Writes a boolean value. */
+	virtual void writeBool (bool value) = 0;
+	
+	/** Writes a signed integer. */
+	virtual void writeInt (qint64 value) = 0;
+	
+	/** Writes an unsigned integer. */
+	virtual void writeUInt (quint64 value) = 0;
+	
+	/** Writes a floating-point number. */
+	virtual void writeDouble (double value) = 0;
+	
+	/** Writes a string. */
+	virtual void writeString (const QString &value) = 0;
+	
+	/** Writes a byte array. */
+	virtual void writeBytes (const QByteArray &value) = 0;
+	
+	/**
+	 * Writes \a value using the methods above. QVariantMaps, QVariantHashes,
+	 * QVariantLists and QStringLists are written recursively. Types which
+	 * are not known are converted to a QString if possible, or written as
+	 * null otherwise.
+	 */
+	void writeVariant (const QVariant &value);
+	
+protected:
+	
+	/** Writes \a length bytes of \a data. */
+	void write (const char *data, int length);
+	
+	/** Writes \a byte. */
+	void write (char byte);
+	
+private:
+	Q_DISABLE_COPY(StructuredWriter)
+	
+	StructuredWriterPrivate *d_ptr;
+	
+};
+
+/**
+ * \brief Writes compact JSON.
+ * 
+ * Non-finite numbers are written as \c null, byte arrays are written as
+ * strings interpreting them as UTF-8. The output is the same as of
+ * QJsonDocument::toJson() with QJsonDocument::Compact, apart from the
+ * formatting of floating-point numbers.
+ */
+class NURIA_CORE_EXPORT JsonWriter : public StructuredWriter {
+public:
+	
+	/** Constructs a writer writing into \a device. */
+	explicit JsonWriter (QIODevice *device);
+	
+	/** Constructs a writer appending to \a buffer. */
+	explicit JsonWriter (QByteArray *buffer);
+	
+	void beginMap () override;
+	void endMap () override;
+	void beginList () override;
+	void endList () override;
+	void writeKey (const QString &key) override;
+	void writeNull () override;
+	void writeBool (bool value) override;
+	void writeInt (qint64 value) override;
+	void writeUInt (quint64 value) override;
+	void writeDouble (double value) override;
+	void writeString (const QString &value) override;
+	void writeBytes (const QByteArray &value) override;
+	
+private:
+	void beginValue ();
+	void writeQuoted (const QString &string);
+	
+	bool m_needComma = false;
+	
+};
+
+/**
+ * \brief Writes CBOR as defined by RFC 7049.
+ * 
+ * Maps and lists are written with indefinite length, so their size doesn't
+ * need to be known up-front. Integers use the shortest encoding, floating
+ * point numbers are always written in double precision.
+ */
+class NURIA_CORE_EXPORT CborWriter : public StructuredWriter {
+public:
+	
+	/** Constructs a writer writing into \a device. */
+	explicit CborWriter (QIODevice *device);
+	
+	/** Constructs a writer appending to \a buffer. */
+	explicit CborWriter (QByteArray *buffer);
+	
+	void beginMap () override;
+	void endMap () override;
+	void beginList () override;
+	void endList () override;
+	void writeKey (const QString &key) override;
+	void writeNull () override;
+	void writeBool (bool value) override;
+	void writeInt (qint64 value) override;
+	void writeUInt (quint64 value) override;
+	void writeDouble (double value) override;
+	void writeString (const QString &value) override;
+	void writeBytes (const QByteArray &value) override;
+	
+private:
+	void writeHead (int majorType, quint64 value);
+	
+};
+
+} // namespace Nuria
+
+#endif // NURIA_STRUCTUREDWRITER_HPP
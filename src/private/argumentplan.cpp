@@ -0,0 +1,195 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "argumentplan.hpp"
+
+#include <QVariant>
+#include <cstring>
+
+Nuria::Internal::ArgumentPlanCache::~ArgumentPlanCache () {
+	clear ();
+}
+
+const Nuria::Internal::ArgumentPlan *Nuria::Internal::ArgumentPlanCache::find (const int *key, int count) const {
+	for (ArgumentPlan *cur = this->m_head.loadAcquire (); cur; cur = cur->next) {
+		if (cur->key.size () == count &&
+		    (count == 0 || !::memcmp (cur->key.constData (), key, count * sizeof(int)))) {
+			return cur;
+		}
+		
+	}
+	
+	return nullptr;
+}
+
+bool Nuria::Internal::ArgumentPlanCache::insert (ArgumentPlan *plan) const {
+	if (this->m_count.fetchAndAddOrdered (1) >= MaxPlans) {
+		this->m_count.fetchAndAddOrdered (-1);
+		return false;
+	}
+	
+	ArgumentPlan *head;
+	do {
+		head = this->m_head.loadAcquire ();
+		plan->next = head;
+	} while (!this->m_head.testAndSetOrdered (head, plan));
+	
+	return true;
+}
+
+void Nuria::Internal::ArgumentPlanCache::clear () {
+	ArgumentPlan *cur = this->m_head.fetchAndStoreOrdered (nullptr);
+	while (cur) {
+		ArgumentPlan *next = cur->next;
+		delete cur;
+		cur = next;
+	}
+	
+	this->m_count.storeRelease (0);
+}
+
+/**
+ * Helper function. Returns a default constructed instance of \a type.
+ */
+static void *createDefault (int type) {
+	void *inst = QMetaType::create (type, 0);
+	
+	if (inst && type < QMetaType::Double) {
+		*(int *)inst = 0;
+	} else if (type == QMetaType::Double) {
+		*(double *)inst = 0.0f;
+	}
+	
+	return inst;
+}
+
+/**
+ * Helper function. Converts \a value of \a fromType to a new instance of
+ * \a toType. If it can't be converted, a default constructed value will be
+ * returned.
+ */
+static void *convertValue (const void *value, int fromType, int toType) {
+	QVariant v (fromType, value);
+	if (!v.convert (toType)) {
+		return createDefault (toType);
+	}
+	
+	return QMetaType::create (toType, v.constData ());
+}
+
+void Nuria::Internal::buildPlanKey (int *key, int count, void **args, const int *types) {
+	for (int i = 0; i < count; i++) {
+		key[i] = (types[i] == QMetaType::QVariant)
+		         ? -1 - reinterpret_cast< QVariant * > (args[i])->userType ()
+		         : types[i];
+	}
+	
+}
+
+Nuria::Internal::ArgumentStep Nuria::Internal::planArgument (const int *key, int count, int source, int toType) {
+	ArgumentStep step { DefaultConstruct, source, 0, toType, false, nullptr };
+	if (source < 0 || source >= count) {
+		return step;
+	}
+	
+	// Do we have the value in a QVariant?
+	int fromType = key[source];
+	if (fromType < 0) {
+		if (toType == QMetaType::QVariant) {
+			step.op = PassThrough;
+			return step;
+		}
+		
+		step.unwrap = true;
+		fromType = -1 - fromType;
+	} else if (toType == QMetaType::QVariant) {
+		step.op = WrapVariant;
+		step.fromType = fromType;
+		return step;
+	}
+	
+	// Check value
+	step.fromType = fromType;
+	if (fromType == toType) {
+		step.op = (step.unwrap) ? UnwrapVariant : PassThrough;
+	} else if (fromType == QMetaType::UnknownType) {
+		step.op = DefaultConstruct; // Invalid QVariant, nothing to unwrap
+		step.unwrap = false;
+	} else if (QMetaType::hasRegisteredConverterFunction (fromType, toType)) {
+		step.op = ConvertFunction;
+	} else {
+		step.op = ConvertVariant;
+	}
+	
+	return step;
+}
+
+Nuria::Internal::ArgumentPlan *Nuria::Internal::buildSimplePlan (const int *key, int count,
+                                                                 const int *targetTypes, int targetCount) {
+	ArgumentPlan *plan = new ArgumentPlan;
+	plan->next = nullptr;
+	plan->key.append (key, count);
+	
+	for (int i = 0; i < targetCount; i++) {
+		plan->steps.append (planArgument (key, count, i, targetTypes[i]));
+	}
+	
+	return plan;
+}
+
+void Nuria::Internal::applyPlan (const ArgumentPlan *plan, void **args, void **rawArgs, bool *removeMe) {
+	for (int i = 0; i < plan->steps.size (); i++) {
+		const ArgumentStep &step = plan->steps.at (i);
+		void *value = (step.op == ConstantArgument || step.op == DefaultConstruct)
+		              ? nullptr : args[step.source];
+		
+		if (step.unwrap && value) {
+			value = const_cast< void * > (reinterpret_cast< QVariant * > (value)->constData ());
+		}
+		
+		//
+		switch (step.op) {
+		case PassThrough:
+		case UnwrapVariant:
+			rawArgs[i + 1] = value;
+			removeMe[i] = false;
+			break;
+		case WrapVariant:
+			rawArgs[i + 1] = new QVariant (step.fromType, value);
+			removeMe[i] = true;
+			break;
+		case ConvertFunction:
+			rawArgs[i + 1] = createDefault (step.toType);
+			QMetaType::convert (value, step.fromType, rawArgs[i + 1], step.toType);
+			removeMe[i] = true;
+			break;
+		case ConvertVariant:
+			rawArgs[i + 1] = convertValue (value, step.fromType, step.toType);
+			removeMe[i] = true;
+			break;
+		case DefaultConstruct:
+			rawArgs[i + 1] = createDefault (step.toType);
+			removeMe[i] = true;
+			break;
+		case ConstantArgument:
+			rawArgs[i + 1] = step.constant;
+			removeMe[i] = false;
+			break;
+		}
+		
+	}
+	
+}
@@ -0,0 +1,139 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NURIA_INTERNAL_ARGUMENTPLAN_HPP
+#define NURIA_INTERNAL_ARGUMENTPLAN_HPP
+
+#include <QVarLengthArray>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QMetaType>
+
+namespace Nuria {
+namespace Internal {
+
+// Operations used by argument conversion plans.
+enum ArgumentOp {
+	PassThrough, // Pass the incoming pointer on
+	UnwrapVariant, // Pass the data of the incoming QVariant on
+	WrapVariant, // Copy the incoming value into a new QVariant
+	ConvertFunction, // Use the converter registered with QMetaType
+	ConvertVariant, // Use QVariant::convert()
+	DefaultConstruct, // Pass a default constructed instance
+	ConstantArgument // Pass 'constant', e.g. a bound value
+};
+
+// One step of a conversion plan, producing one target argument.
+struct ArgumentStep {
+	ArgumentOp op;
+	int source; // Index of the incoming argument
+	int fromType;
+	int toType;
+	bool unwrap; // Source is a QVariant holding 'fromType'
+	void *constant;
+};
+
+// Conversion plan for one vector of incoming argument types. Plans are
+// immutable once built.
+struct ArgumentPlan {
+	ArgumentPlan *next;
+	QVarLengthArray< int, 8 > key;
+	QVarLengthArray< ArgumentStep, 8 > steps;
+};
+
+/**
+ * \internal
+ * Lock-free cache of ArgumentPlans. Lookups and insertions may happen
+ * concurrently, clear() must not.
+ */
+class ArgumentPlanCache {
+public:
+	
+	// Maximum count of cached plans.
+	enum { MaxPlans = 8 };
+	
+	~ArgumentPlanCache ();
+	
+	const ArgumentPlan *find (const int *key, int count) const;
+	
+	// Takes ownership of 'plan' and returns true if it was stored.
+	bool insert (ArgumentPlan *plan) const;
+	
+	void clear ();
+	
+private:
+	mutable QAtomicPointer< ArgumentPlan > m_head;
+	mutable QAtomicInt m_count;
+	
+};
+
+/**
+ * \internal
+ * Destroys all elements of \a values (Laid out like in qt_metacall()) which
+ * are marked in \a remove.
+ */
+class ArgumentCleanup {
+public:
+	
+	ArgumentCleanup (void **values, const int *types, int count, bool *remove)
+		: m_values (values), m_types (types), m_count (count), m_remove (remove) {}
+	
+	~ArgumentCleanup () {
+		for (int i = 0; i < m_count; i++) {
+			if (m_remove[i]) {
+				QMetaType::destroy (m_types[i], m_values[i + 1]);
+			}
+			
+		}
+		
+	}
+	
+private:
+	void **m_values;
+	const int *m_types;
+	int m_count;
+	bool *m_remove;
+	
+};
+
+/**
+ * Writes the plan key of the incoming \a args of \a types to \a key. A QVariant
+ * holding type \c T is stored as \c {-1 - T}.
+ */
+void buildPlanKey (int *key, int count, void **args, const int *types);
+
+/**
+ * Decides how the incoming argument at \a source is turned into an argument of
+ * \a toType. Out-of-range sources result in a default constructed value.
+ */
+ArgumentStep planArgument (const int *key, int count, int source, int toType);
+
+/**
+ * Builds a plan passing the incoming arguments to \a targetCount arguments of
+ * \a targetTypes in order.
+ */
+ArgumentPlan *buildSimplePlan (const int *key, int count, const int *targetTypes, int targetCount);
+
+/**
+ * Runs \a plan on the incoming \a args, writing to \a rawArgs starting at
+ * index 1. Created values are marked in \a removeMe.
+ */
+void applyPlan (const ArgumentPlan *plan, void **args, void **rawArgs, bool *removeMe);
+
+} // namespace Internal
+} // namespace Nuria
+
+#endif // NURIA_INTERNAL_ARGUMENTPLAN_HPP
@@ -0,0 +1,175 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "enumtable.hpp"
+
+#include <algorithm>
+#include <QHash>
+
+// Returns the smallest power of two which is at least 'count'.
+static int tableSize (int count) {
+	int size = 1;
+	while (size < count) {
+		size <<= 1;
+	}
+	
+	return size;
+}
+
+static uint hashValue (int value) {
+	return uint (value) * 2654435761U;
+}
+
+Nuria::Internal::EnumTable::EnumTable (const QVector< QByteArray > &keys, const QVector< int > &values)
+	: m_keys (keys), m_values (values), m_dense (false), m_minimum (0), m_seed (0)
+{
+	
+	buildValueTable ();
+	buildKeyTable ();
+	
+}
+
+void Nuria::Internal::EnumTable::buildValueTable () {
+	int count = this->m_values.size ();
+	if (count < 1) {
+		return;
+	}
+	
+	// Use a plain array if the values are mostly contiguous
+	auto bounds = std::minmax_element (this->m_values.constBegin (), this->m_values.constEnd ());
+	qint64 range = qint64 (*bounds.second) - qint64 (*bounds.first) + 1;
+	
+	if (range <= 2 * qint64 (count) + 16) {
+		this->m_dense = true;
+		this->m_minimum = *bounds.first;
+		this->m_byValue.fill (-1, int (range));
+		
+		// Keep the first element of each value
+		for (int i = count - 1; i >= 0; i--) {
+			this->m_byValue[this->m_values.at (i) - this->m_minimum] = i;
+		}
+		
+		return;
+	}
+	
+	// Open addressing with linear probing
+	int size = tableSize (count * 2);
+	uint mask = size - 1;
+	this->m_byValue.fill (-1, size);
+	
+	for (int i = 0; i < count; i++) {
+		uint slot = hashValue (this->m_values.at (i)) & mask;
+		while (this->m_byValue.at (slot) != -1 &&
+		       this->m_values.at (this->m_byValue.at (slot)) != this->m_values.at (i)) {
+			slot = (slot + 1) & mask;
+		}
+		
+		if (this->m_byValue.at (slot) == -1) {
+			this->m_byValue[slot] = i;
+		}
+		
+	}
+	
+}
+
+bool Nuria::Internal::EnumTable::tryKeySeed (uint seed, int size) {
+	uint mask = size - 1;
+	this->m_byKey.fill (-1, size);
+	
+	for (int i = 0; i < this->m_keys.size (); i++) {
+		uint slot = qHash (this->m_keys.at (i), seed) & mask;
+		int other = this->m_byKey.at (slot);
+		if (other != -1 && this->m_keys.at (other) != this->m_keys.at (i)) {
+			return false;
+		}
+		
+		// Keep the first element of each key
+		if (other != -1) {
+			continue;
+		}
+		
+		this->m_byKey[slot] = i;
+	}
+	
+	this->m_seed = seed;
+	return true;
+}
+
+void Nuria::Internal::EnumTable::buildKeyTable () {
+	int count = this->m_keys.size ();
+	if (count < 1) {
+		return;
+	}
+	
+	// Grow the table up to 8 times the element count until a seed works
+	for (int size = tableSize (count * 2); size <= tableSize (count * 8); size <<= 1) {
+		for (uint seed = 0; seed < MaxSeeds; seed++) {
+			if (tryKeySeed (seed, size)) {
+				return;
+			}
+			
+		}
+		
+	}
+	
+	// Fall back to binary search. Keys are in element order, so sort them.
+	this->m_byKey.clear ();
+	this->m_sorted.resize (count);
+	for (int i = 0; i < count; i++) {
+		this->m_sorted[i] = i;
+	}
+	
+	std::stable_sort (this->m_sorted.begin (), this->m_sorted.end (), [this](int lhs, int rhs) {
+		return this->m_keys.at (lhs) < this->m_keys.at (rhs);
+	});
+	
+}
+
+int Nuria::Internal::EnumTable::indexOfValue (int value) const {
+	if (this->m_byValue.isEmpty ()) {
+		return -1;
+	}
+	
+	if (this->m_dense) {
+		qint64 offset = qint64 (value) - this->m_minimum;
+		return (offset >= 0 && offset < this->m_byValue.size ()) ? this->m_byValue.at (int (offset)) : -1;
+	}
+	
+	uint mask = this->m_byValue.size () - 1;
+	uint slot = hashValue (value) & mask;
+	for (int index = this->m_byValue.at (slot); index != -1; index = this->m_byValue.at (slot)) {
+		if (this->m_values.at (index) == value) {
+			return index;
+		}
+		
+		slot = (slot + 1) & mask;
+	}
+	
+	return -1;
+}
+
+int Nuria::Internal::EnumTable::indexOfKey (const QByteArray &key) const {
+	if (!this->m_byKey.isEmpty ()) {
+		uint slot = qHash (key, this->m_seed) & (this->m_byKey.size () - 1);
+		int index = this->m_byKey.at (slot);
+		return (index != -1 && this->m_keys.at (index) == key) ? index : -1;
+	}
+	
+	auto it = std::lower_bound (this->m_sorted.constBegin (), this->m_sorted.constEnd (), key,
+				    [this](int index, const QByteArray &name) { return this->m_keys.at (index) < name; });
+	return (it != this->m_sorted.constEnd () && this->m_keys.at (*it) == key) ? *it : -1;
+}
@@ -0,0 +1,86 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NURIA_INTERNAL_ENUMTABLE_HPP
+#define NURIA_INTERNAL_ENUMTABLE_HPP
+
+#include <QByteArray>
+#include <QVector>
+
+namespace Nuria {
+namespace Internal {
+
+/**
+ * \internal
+ * Conversion tables of a MetaEnum. Values are mapped to elements using a
+ * direct-indexed array if they're mostly contiguous, and a open-addressing
+ * hash table otherwise. Keys are mapped using a perfect hash table, falling
+ * back to binary search if no perfect hash was found. If a value or key is
+ * used by multiple elements, the first one is found. Immutable once built.
+ * 
+ * Tables are built by MetaEnum on first use and stored in the lookup index of
+ * the MetaObject, not by RuntimeMetaObject::finalize(): This way they work
+ * for all back-ends, and lazy ones like QtMetaObjectWrapper, which finalize
+ * while holding their lock, aren't called into while populating.
+ */
+class EnumTable {
+public:
+	
+	// Maximum count of seeds tried per table size for the key hash.
+	enum { MaxSeeds = 32 };
+	
+	// 'keys' and 'values' are in element order. Keys may repeat.
+	EnumTable (const QVector< QByteArray > &keys, const QVector< int > &values);
+	
+	// Returns the first element with 'value', or -1.
+	int indexOfValue (int value) const;
+	
+	// Returns the element with 'key', or -1.
+	int indexOfKey (const QByteArray &key) const;
+	
+	const QByteArray &key (int index) const
+	{ return this->m_keys.at (index); }
+	
+	int value (int index) const
+	{ return this->m_values.at (index); }
+	
+private:
+	void buildValueTable ();
+	void buildKeyTable ();
+	bool tryKeySeed (uint seed, int size);
+	
+	QVector< QByteArray > m_keys;
+	QVector< int > m_values;
+	
+	// Value -> Element. Dense: Indexed by 'value - m_minimum'.
+	bool m_dense;
+	int m_minimum;
+	QVector< int > m_byValue;
+	
+	// Key -> Element. Empty if there's no perfect hash.
+	uint m_seed;
+	QVector< int > m_byKey;
+	
+	// Elements sorted by key, for the binary search fall back.
+	QVector< int > m_sorted;
+	
+};
+
+} // namespace Internal
+} // namespace Nuria
+
+#endif // NURIA_INTERNAL_ENUMTABLE_HPP
@@ -0,0 +1,260 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "metaobjectindex.hpp"
+
+#include <cstring>
+
+#include "enumtable.hpp"
+#include "../nuria/metaobject.hpp"
+
+Nuria::Internal::MetaObjectIndex::MetaObjectIndex (MetaObject *object)
+	: m_invokers (nullptr), m_fieldAccessors (nullptr), m_enumTables (nullptr)
+{
+	Interned interned;
+	
+	// Object annotations
+	this->m_annotations[0].append (addAnnotations (interned, *object));
+	
+	// Methods
+	int count = object->methodCount ();
+	this->m_methods.begin = this->m_names.size ();
+	for (int i = 0; i < count; i++) {
+		addName (interned, object->method (i).name ());
+	}
+	
+	this->m_methods.end = this->m_names.size ();
+	this->m_invokers = new QAtomicPointer< MethodInvoker >[count];
+	for (int i = 0; i < count; i++) {
+		MetaMethod method = object->method (i);
+		this->m_annotations[1].append (addAnnotations (interned, method));
+	}
+	
+	// Fields
+	count = object->fieldCount ();
+	this->m_fields.begin = this->m_names.size ();
+	for (int i = 0; i < count; i++) {
+		addName (interned, object->field (i).name ());
+	}
+	
+	this->m_fields.end = this->m_names.size ();
+	this->m_fieldAccessors = new QAtomicPointer< FieldAccessor >[count];
+	for (int i = 0; i < count; i++) {
+		MetaField field = object->field (i);
+		this->m_annotations[2].append (addAnnotations (interned, field));
+	}
+	
+	// Enums
+	count = object->enumCount ();
+	this->m_enums.begin = this->m_names.size ();
+	for (int i = 0; i < count; i++) {
+		addName (interned, object->enumAt (i).name ());
+	}
+	
+	this->m_enums.end = this->m_names.size ();
+	this->m_enumTables = new QAtomicPointer< EnumTable >[count];
+	for (int i = 0; i < count; i++) {
+		MetaEnum metaEnum = object->enumAt (i);
+		this->m_annotations[3].append (addAnnotations (interned, metaEnum));
+	}
+	
+	this->m_pool.squeeze ();
+	this->m_names.squeeze ();
+}
+
+Nuria::Internal::MetaObjectIndex::~MetaObjectIndex () {
+	int count = this->m_methods.end - this->m_methods.begin;
+	for (int i = 0; i < count; i++) {
+		delete this->m_invokers[i].loadAcquire ();
+	}
+	
+	count = this->m_fields.end - this->m_fields.begin;
+	for (int i = 0; i < count; i++) {
+		delete this->m_fieldAccessors[i].loadAcquire ();
+	}
+	
+	count = this->m_enums.end - this->m_enums.begin;
+	for (int i = 0; i < count; i++) {
+		delete this->m_enumTables[i].loadAcquire ();
+	}
+	
+	delete[] this->m_invokers;
+	delete[] this->m_fieldAccessors;
+	delete[] this->m_enumTables;
+	
+	ResolvedPrototype *cur = this->m_prototypes.loadAcquire ();
+	while (cur) {
+		ResolvedPrototype *next = cur->next;
+		delete cur;
+		cur = next;
+	}
+	
+}
+
+int Nuria::Internal::MetaObjectIndex::methodLowerBound (const QByteArray &name) const {
+	return find (this->m_methods, name, false);
+}
+
+int Nuria::Internal::MetaObjectIndex::methodUpperBound (const QByteArray &name) const {
+	return find (this->m_methods, name, true);
+}
+
+int Nuria::Internal::MetaObjectIndex::fieldIndex (const QByteArray &name) const {
+	return find (this->m_fields, name, false);
+}
+
+int Nuria::Internal::MetaObjectIndex::enumIndex (const QByteArray &name) const {
+	return find (this->m_enums, name, false);
+}
+
+int Nuria::Internal::MetaObjectIndex::annotationLowerBound (int category, int index,
+							     const QByteArray &name) const {
+	return find (annotationRange (category, index), name, false);
+}
+
+int Nuria::Internal::MetaObjectIndex::annotationUpperBound (int category, int index,
+							     const QByteArray &name) const {
+	return find (annotationRange (category, index), name, true);
+}
+
+QAtomicPointer< Nuria::Internal::MethodInvoker > *
+Nuria::Internal::MetaObjectIndex::invoker (int index) const {
+	if (index < 0 || index >= this->m_methods.end - this->m_methods.begin) {
+		return nullptr;
+	}
+	
+	return &this->m_invokers[index];
+}
+
+QAtomicPointer< Nuria::Internal::FieldAccessor > *
+Nuria::Internal::MetaObjectIndex::fieldAccessor (int index) const {
+	if (index < 0 || index >= this->m_fields.end - this->m_fields.begin) {
+		return nullptr;
+	}
+	
+	return &this->m_fieldAccessors[index];
+}
+
+QAtomicPointer< Nuria::Internal::EnumTable > *
+Nuria::Internal::MetaObjectIndex::enumTable (int index) const {
+	if (index < 0 || index >= this->m_enums.end - this->m_enums.begin) {
+		return nullptr;
+	}
+	
+	return &this->m_enumTables[index];
+}
+
+int Nuria::Internal::MetaObjectIndex::findPrototype (const QVector< QByteArray > &prototype,
+						     uint hash) const {
+	for (ResolvedPrototype *cur = this->m_prototypes.loadAcquire (); cur; cur = cur->next) {
+		if (cur->hash == hash && cur->prototype == prototype) {
+			return cur->index;
+		}
+		
+	}
+	
+	return -2;
+}
+
+void Nuria::Internal::MetaObjectIndex::insertPrototype (const QVector< QByteArray > &prototype,
+							uint hash, int index) const {
+	if (this->m_prototypeCount.fetchAndAddOrdered (1) >= MaxPrototypes) {
+		this->m_prototypeCount.fetchAndAddOrdered (-1);
+		return;
+	}
+	
+	ResolvedPrototype *entry = new ResolvedPrototype { nullptr, prototype, hash, index };
+	ResolvedPrototype *head;
+	do {
+		head = this->m_prototypes.loadAcquire ();
+		entry->next = head;
+	} while (!this->m_prototypes.testAndSetOrdered (head, entry));
+	
+}
+
+template< typename T >
+Nuria::Internal::MetaObjectIndex::Range Nuria::Internal::MetaObjectIndex::addAnnotations (Interned &interned, T &element) {
+	Range range;
+	range.begin = this->m_names.size ();
+	
+	int count = element.annotationCount ();
+	for (int i = 0; i < count; i++) {
+		addName (interned, element.annotation (i).name ());
+	}
+	
+	range.end = this->m_names.size ();
+	return range;
+}
+
+void Nuria::Internal::MetaObjectIndex::addName (Interned &interned, const QByteArray &name) {
+	auto it = interned.constFind (name);
+	if (it != interned.constEnd ()) {
+		this->m_names.append (this->m_names.at (*it));
+		return;
+	}
+	
+	Name entry { this->m_pool.size (), name.size () };
+	interned.insert (name, this->m_names.size ());
+	this->m_pool.append (name);
+	this->m_names.append (entry);
+}
+
+// Compares like QByteArray::operator<() does.
+static inline int compareName (const char *left, int leftLength, const char *right, int rightLength) {
+	int result = ::memcmp (left, right, qMin (leftLength, rightLength));
+	return (result != 0) ? result : leftLength - rightLength;
+}
+
+int Nuria::Internal::MetaObjectIndex::find (const Range &range, const QByteArray &name, bool last) const {
+	const char *pool = this->m_pool.constData ();
+	const Name *names = this->m_names.constData ();
+	const char *needle = name.constData ();
+	int length = name.size ();
+	
+	// Binary search for the first (or last) matching name
+	int min = range.begin;
+	int max = range.end;
+	while (min < max) {
+		int mid = min + (max - min) / 2;
+		int result = compareName (pool + names[mid].offset, names[mid].length, needle, length);
+		if (result < 0 || (last && result == 0)) {
+			min = mid + 1;
+		} else {
+			max = mid;
+		}
+		
+	}
+	
+	// 'min' is the first element not matching the condition.
+	int found = (last) ? min - 1 : min;
+	if (found < range.begin || found >= range.end ||
+	    compareName (pool + names[found].offset, names[found].length, needle, length) != 0) {
+		return -1;
+	}
+	
+	return found - range.begin;
+}
+
+Nuria::Internal::MetaObjectIndex::Range
+Nuria::Internal::MetaObjectIndex::annotationRange (int category, int index) const {
+	if (category < 0 || category > 3 || index < 0 ||
+	    index >= this->m_annotations[category].size ()) {
+		return Range { 0, 0 };
+	}
+	
+	return this->m_annotations[category].at (index);
+}
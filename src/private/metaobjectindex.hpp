@@ -0,0 +1,145 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NURIA_INTERNAL_METAOBJECTINDEX_HPP
+#define NURIA_INTERNAL_METAOBJECTINDEX_HPP
+
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+#include "../nuria/callback.hpp"
+
+namespace Nuria {
+class MetaObject;
+
+namespace Internal {
+class EnumTable;
+
+// Prepared invoker of a method, see MetaMethod::invoke().
+struct MethodInvoker {
+	Callback callback; // Invalid if the MetaObject doesn't offer one
+	int argumentCount;
+};
+
+// Cached result of MetaObject::methodIndex().
+struct ResolvedPrototype {
+	ResolvedPrototype *next;
+	QVector< QByteArray > prototype;
+	uint hash;
+	int index; // -1 if there's no such method
+};
+
+// Prepared access to a field, see MetaField::readInto().
+struct FieldAccessor {
+	int offset; // -1 if not a plain member
+	int typeId;
+	bool writable;
+};
+
+/**
+ * \internal
+ * Name lookup index of a MetaObject. All names of methods, fields, enums and
+ * annotations are interned into a single string pool, and stored in sorted
+ * arrays referencing it. Lookups thus only compare contiguous memory, without
+ * calling into the MetaObject.
+ * 
+ * The index is immutable once built, except for the method invokers, field
+ * accessors, enum tables and resolved prototypes, which are added on first
+ * use. The categories are the ones used by MetaAnnotation: 0 = Object,
+ * 1 = Method, 2 = Field, 3 = Enum.
+ */
+class MetaObjectIndex {
+public:
+	
+	explicit MetaObjectIndex (MetaObject *object);
+	~MetaObjectIndex ();
+	
+	int methodLowerBound (const QByteArray &name) const;
+	int methodUpperBound (const QByteArray &name) const;
+	int fieldIndex (const QByteArray &name) const;
+	int enumIndex (const QByteArray &name) const;
+	
+	int annotationLowerBound (int category, int index, const QByteArray &name) const;
+	int annotationUpperBound (int category, int index, const QByteArray &name) const;
+	
+	// Returns the storage of the invoker of method 'index', or nullptr.
+	QAtomicPointer< MethodInvoker > *invoker (int index) const;
+	
+	// Returns the storage of the accessor of field 'index', or nullptr.
+	QAtomicPointer< FieldAccessor > *fieldAccessor (int index) const;
+	
+	// Returns the storage of the conversion table of enum 'index', or nullptr.
+	QAtomicPointer< EnumTable > *enumTable (int index) const;
+	
+	// Maximum count of cached prototypes.
+	enum { MaxPrototypes = 64 };
+	
+	// Returns the cached method index of 'prototype', or -2 if not cached.
+	int findPrototype (const QVector< QByteArray > &prototype, uint hash) const;
+	
+	// Caches the method 'index' of 'prototype', if there's still room.
+	void insertPrototype (const QVector< QByteArray > &prototype, uint hash, int index) const;
+	
+	// Next retired index of the same MetaObject, see
+	// MetaObject::invalidateLookupIndex().
+	MetaObjectIndex *nextRetired = nullptr;
+	
+private:
+	Q_DISABLE_COPY(MetaObjectIndex)
+	
+	struct Name {
+		int offset; // In m_pool
+		int length;
+	};
+	
+	// Range in m_names
+	struct Range {
+		int begin;
+		int end;
+	};
+	
+	// Maps a name to its first occurrence in m_names while building
+	typedef QHash< QByteArray, int > Interned;
+	
+	template< typename T >
+	Range addAnnotations (Interned &interned, T &element);
+	
+	void addName (Interned &interned, const QByteArray &name);
+	int find (const Range &range, const QByteArray &name, bool last) const;
+	Range annotationRange (int category, int index) const;
+	
+	QByteArray m_pool;
+	QVector< Name > m_names;
+	Range m_methods;
+	Range m_fields;
+	Range m_enums;
+	QVector< Range > m_annotations[4];
+	QAtomicPointer< MethodInvoker > *m_invokers; // One per method
+	QAtomicPointer< FieldAccessor > *m_fieldAccessors; // One per field
+	QAtomicPointer< EnumTable > *m_enumTables; // One per enum
+	mutable QAtomicPointer< ResolvedPrototype > m_prototypes;
+	mutable QAtomicInt m_prototypeCount;
+	
+};
+
+} // namespace Internal
+} // namespace Nuria
+
+#endif // NURIA_INTERNAL_METAOBJECTINDEX_HPP
@@ -0,0 +1,587 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "metaobjectsnapshot.hpp"
+
+#include <QDataStream>
+#include <QBuffer>
+#include <QHash>
+
+#include <cstring>
+
+enum Categories {
+	ObjectCategory = 0,
+	MethodCategory = 1,
+	FieldCategory = 2,
+	EnumCategory = 3
+};
+
+enum {
+	SnapshotVersion = 1,
+	SnapshotByteOrder = 0x01020304
+};
+
+static const char snapshotMagic[8] = { 'N', 'u', 'r', 'i', 'a', 'M', 'O', 'S' };
+
+// Appends the tables, blobs and records of a snapshot.
+class SnapshotWriter {
+public:
+	
+	SnapshotWriter () {
+		this->header.version = SnapshotVersion;
+		this->header.byteOrder = SnapshotByteOrder;
+		memcpy (this->header.magic, snapshotMagic, sizeof(snapshotMagic));
+	}
+	
+	Nuria::Internal::SnapshotString string (const QByteArray &string);
+	quint32 list (const QVector< QByteArray > &list);
+	Nuria::Internal::SnapshotRange annotations (Nuria::MetaObject *object, int category, int index);
+	void type (Nuria::MetaObject *object);
+	QByteArray finish ();
+	
+	Nuria::Internal::SnapshotHeader header;
+	QByteArray strings;
+	QVector< quint32 > lists;
+	QByteArray values;
+	QVector< Nuria::Internal::SnapshotFile > files;
+	QVector< Nuria::Internal::SnapshotType > types;
+	QVector< Nuria::Internal::SnapshotMethod > methods;
+	QVector< Nuria::Internal::SnapshotField > fields;
+	QVector< Nuria::Internal::SnapshotEnum > enums;
+	QVector< Nuria::Internal::SnapshotElement > elements;
+	QVector< Nuria::Internal::SnapshotAnnotation > annotationRecords;
+	QHash< QByteArray, Nuria::Internal::SnapshotString > stringIndex;
+	
+};
+
+Nuria::Internal::SnapshotString SnapshotWriter::string (const QByteArray &string) {
+	auto it = this->stringIndex.constFind (string);
+	if (it != this->stringIndex.constEnd ()) {
+		return *it;
+	}
+	
+	Nuria::Internal::SnapshotString result = { quint32 (this->strings.size ()), quint32 (string.size ()) };
+	this->strings.append (string);
+	this->strings.append ('\0');
+	this->stringIndex.insert (string, result);
+	return result;
+}
+
+quint32 SnapshotWriter::list (const QVector< QByteArray > &list) {
+	quint32 index = this->lists.size ();
+	this->lists.append (list.size ());
+	
+	for (const QByteArray &cur : list) {
+		Nuria::Internal::SnapshotString ref = string (cur);
+		this->lists.append (ref.offset);
+		this->lists.append (ref.length);
+	}
+	
+	return index;
+}
+
+Nuria::Internal::SnapshotRange SnapshotWriter::annotations (Nuria::MetaObject *object, int category, int index) {
+	Nuria::Internal::SnapshotRange range = { quint32 (this->annotationRecords.size ()), 0 };
+	
+	int count = 0;
+	switch (Categories (category)) {
+	case ObjectCategory: count = object->annotationCount (); break;
+	case MethodCategory: count = object->method (index).annotationCount (); break;
+	case FieldCategory: count = object->field (index).annotationCount (); break;
+	case EnumCategory: count = object->enumAt (index).annotationCount (); break;
+	}
+	
+	for (int i = 0; i < count; i++) {
+		Nuria::MetaAnnotation annotation;
+		switch (Categories (category)) {
+		case ObjectCategory: annotation = object->annotation (i); break;
+		case MethodCategory: annotation = object->method (index).annotation (i); break;
+		case FieldCategory: annotation = object->field (index).annotation (i); break;
+		case EnumCategory: annotation = object->enumAt (index).annotation (i); break;
+		}
+		
+		// Values are stored in a version-independent format
+		QBuffer buffer (&this->values);
+		buffer.open (QIODevice::Append);
+		QDataStream stream (&buffer);
+		stream.setVersion (QDataStream::Qt_5_0);
+		
+		quint32 begin = this->values.size ();
+		stream << annotation.value ();
+		buffer.close ();
+		
+		Nuria::Internal::SnapshotAnnotation record;
+		record.name = string (annotation.name ());
+		record.value.first = begin;
+		record.value.count = this->values.size () - begin;
+		this->annotationRecords.append (record);
+		
+	}
+	
+	range.count = count;
+	return range;
+}
+
+void SnapshotWriter::type (Nuria::MetaObject *object) {
+	Nuria::Internal::SnapshotType type;
+	type.name = string (object->className ());
+	type.bases = list (object->parents ());
+	type.annotations = annotations (object, ObjectCategory, 0);
+	
+	// Methods
+	type.methods.first = this->methods.size ();
+	type.methods.count = object->methodCount ();
+	for (int i = 0; i < object->methodCount (); i++) {
+		Nuria::MetaMethod method = object->method (i);
+		Nuria::Internal::SnapshotMethod record;
+		record.name = string (method.name ());
+		record.returnType = string (method.returnType ());
+		record.type = method.type ();
+		record.argumentNames = list (method.argumentNames ());
+		record.argumentTypes = list (method.argumentTypes ());
+		record.annotations = annotations (object, MethodCategory, i);
+		this->methods.append (record);
+	}
+	
+	// Fields
+	type.fields.first = this->fields.size ();
+	type.fields.count = object->fieldCount ();
+	for (int i = 0; i < object->fieldCount (); i++) {
+		Nuria::MetaField field = object->field (i);
+		Nuria::Internal::SnapshotField record;
+		record.name = string (field.name ());
+		record.type = string (field.typeName ());
+		record.access = field.access ();
+		record.annotations = annotations (object, FieldCategory, i);
+		this->fields.append (record);
+	}
+	
+	// Enums
+	type.enums.first = this->enums.size ();
+	type.enums.count = object->enumCount ();
+	for (int i = 0; i < object->enumCount (); i++) {
+		Nuria::MetaEnum metaEnum = object->enumAt (i);
+		Nuria::Internal::SnapshotEnum record;
+		record.name = string (metaEnum.name ());
+		record.elements.first = this->elements.size ();
+		record.elements.count = metaEnum.elementCount ();
+		record.annotations = annotations (object, EnumCategory, i);
+		
+		for (int j = 0; j < metaEnum.elementCount (); j++) {
+			Nuria::Internal::SnapshotElement element;
+			element.key = string (metaEnum.key (j));
+			element.value = metaEnum.value (j);
+			this->elements.append (element);
+		}
+		
+		this->enums.append (record);
+	}
+	
+	this->types.append (type);
+}
+
+// Appends 'size' bytes at 'data' to 'out', aligned to 4 bytes.
+static Nuria::Internal::SnapshotTable appendTable (QByteArray &out, const void *data, int size, int count) {
+	while (out.size () % 4) {
+		out.append ('\0');
+	}
+	
+	Nuria::Internal::SnapshotTable table = { quint32 (out.size ()), quint32 (count) };
+	out.append (reinterpret_cast< const char * > (data), size);
+	return table;
+}
+
+template< typename T >
+static Nuria::Internal::SnapshotTable appendTable (QByteArray &out, const QVector< T > &vector) {
+	return appendTable (out, vector.constData (), vector.size () * int (sizeof(T)), vector.size ());
+}
+
+QByteArray SnapshotWriter::finish () {
+	QByteArray out (sizeof(Nuria::Internal::SnapshotHeader), '\0');
+	
+	this->header.strings = appendTable (out, this->strings.constData (), this->strings.size (), this->strings.size ());
+	this->header.lists = appendTable (out, this->lists);
+	this->header.values = appendTable (out, this->values.constData (), this->values.size (), this->values.size ());
+	this->header.files = appendTable (out, this->files);
+	this->header.types = appendTable (out, this->types);
+	this->header.methods = appendTable (out, this->methods);
+	this->header.fields = appendTable (out, this->fields);
+	this->header.enums = appendTable (out, this->enums);
+	this->header.elements = appendTable (out, this->elements);
+	this->header.annotations = appendTable (out, this->annotationRecords);
+	
+	memcpy (out.data (), &this->header, sizeof(this->header));
+	return out;
+}
+
+QByteArray Nuria::Internal::writeSnapshot (const QMap< QString, MetaObjectMap > &files) {
+	SnapshotWriter writer;
+	
+	for (auto it = files.constBegin (), end = files.constEnd (); it != end; ++it) {
+		SnapshotFile file;
+		file.name = writer.string (it.key ().toUtf8 ());
+		file.types.first = writer.types.size ();
+		file.types.count = it->size ();
+		
+		for (MetaObject *object : *it) {
+			writer.type (object);
+		}
+		
+		writer.files.append (file);
+	}
+	
+	return writer.finish ();
+}
+
+// Validation of loaded snapshots. Everything referenced by a record is checked
+// once, so that accessors don't have to.
+class SnapshotValidator {
+public:
+	
+	SnapshotValidator (const Nuria::Internal::SnapshotView &view)
+		: view (view), header (*view.header) {}
+		
+	static bool range (const Nuria::Internal::SnapshotRange &range, quint32 count) {
+		return range.first <= count && range.count <= count - range.first;
+	}
+	
+	bool string (const Nuria::Internal::SnapshotString &string) const {
+		return string.offset < this->header.strings.count &&
+				string.length < this->header.strings.count - string.offset &&
+				this->view.strings[string.offset + string.length] == '\0';
+	}
+	
+	bool list (quint32 index) const {
+		if (index >= this->header.lists.count) {
+			return false;
+		}
+		
+		quint32 count = this->view.lists[index];
+		if (count > (this->header.lists.count - index - 1) / 2) {
+			return false;
+		}
+		
+		const Nuria::Internal::SnapshotString *strings =
+				reinterpret_cast< const Nuria::Internal::SnapshotString * > (this->view.lists + index + 1);
+		for (quint32 i = 0; i < count; i++) {
+			if (!string (strings[i])) return false;
+		}
+		
+		return true;
+	}
+	
+	bool annotations (const Nuria::Internal::SnapshotRange &annotations) const {
+		return range (annotations, this->header.annotations.count);
+	}
+	
+	bool validate () const;
+	
+	const Nuria::Internal::SnapshotView &view;
+	const Nuria::Internal::SnapshotHeader &header;
+	
+};
+
+bool SnapshotValidator::validate () const {
+	const Nuria::Internal::SnapshotHeader &h = this->header;
+	
+	for (quint32 i = 0; i < h.annotations.count; i++) {
+		const Nuria::Internal::SnapshotAnnotation &cur = this->view.annotations[i];
+		if (!string (cur.name) || !range (cur.value, h.values.count)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.elements.count; i++) {
+		if (!string (this->view.elements[i].key)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.enums.count; i++) {
+		const Nuria::Internal::SnapshotEnum &cur = this->view.enums[i];
+		if (!string (cur.name) || !range (cur.elements, h.elements.count) ||
+		    !annotations (cur.annotations)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.fields.count; i++) {
+		const Nuria::Internal::SnapshotField &cur = this->view.fields[i];
+		if (!string (cur.name) || !string (cur.type) || !annotations (cur.annotations)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.methods.count; i++) {
+		const Nuria::Internal::SnapshotMethod &cur = this->view.methods[i];
+		if (!string (cur.name) || !string (cur.returnType) || !annotations (cur.annotations) ||
+		    !list (cur.argumentNames) || !list (cur.argumentTypes)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.types.count; i++) {
+		const Nuria::Internal::SnapshotType &cur = this->view.types[i];
+		if (!string (cur.name) || !list (cur.bases) || !annotations (cur.annotations) ||
+		    !range (cur.methods, h.methods.count) || !range (cur.fields, h.fields.count) ||
+		    !range (cur.enums, h.enums.count)) return false;
+	}
+	
+	for (quint32 i = 0; i < h.files.count; i++) {
+		const Nuria::Internal::SnapshotFile &cur = this->view.files[i];
+		if (!string (cur.name) || !range (cur.types, h.types.count)) return false;
+	}
+	
+	return true;
+}
+
+// Checks that 'table' of 'recordSize' sized records lies within 'size' bytes.
+static bool tableInBounds (const Nuria::Internal::SnapshotTable &table, qint64 recordSize, qint64 size) {
+	return (table.offset % 4) == 0 && table.offset <= size &&
+			qint64 (table.count) * recordSize <= size - table.offset;
+}
+
+template< typename T >
+static void setTable (const T *&target, const char *data, const Nuria::Internal::SnapshotTable &table) {
+	target = reinterpret_cast< const T * > (data + table.offset);
+}
+
+bool Nuria::Internal::SnapshotView::load (const char *data, qint64 size) {
+	if (size < qint64 (sizeof(SnapshotHeader)) || (quintptr (data) % 4) != 0) {
+		return false;
+	}
+	
+	const SnapshotHeader *h = reinterpret_cast< const SnapshotHeader * > (data);
+	if (memcmp (h->magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+	    h->version != SnapshotVersion || h->byteOrder != SnapshotByteOrder) {
+		return false;
+	}
+	
+	// Tables
+	if (!tableInBounds (h->strings, 1, size) || !tableInBounds (h->lists, sizeof(quint32), size) ||
+	    !tableInBounds (h->values, 1, size) || !tableInBounds (h->files, sizeof(SnapshotFile), size) ||
+	    !tableInBounds (h->types, sizeof(SnapshotType), size) ||
+	    !tableInBounds (h->methods, sizeof(SnapshotMethod), size) ||
+	    !tableInBounds (h->fields, sizeof(SnapshotField), size) ||
+	    !tableInBounds (h->enums, sizeof(SnapshotEnum), size) ||
+	    !tableInBounds (h->elements, sizeof(SnapshotElement), size) ||
+	    !tableInBounds (h->annotations, sizeof(SnapshotAnnotation), size)) {
+		return false;
+	}
+	
+	this->header = h;
+	setTable (this->strings, data, h->strings);
+	setTable (this->lists, data, h->lists);
+	setTable (this->values, data, h->values);
+	setTable (this->files, data, h->files);
+	setTable (this->types, data, h->types);
+	setTable (this->methods, data, h->methods);
+	setTable (this->fields, data, h->fields);
+	setTable (this->enums, data, h->enums);
+	setTable (this->elements, data, h->elements);
+	setTable (this->annotations, data, h->annotations);
+	
+	// Records
+	if (!SnapshotValidator (*this).validate ()) {
+		this->header = nullptr;
+		return false;
+	}
+	
+	return true;
+}
+
+QByteArray Nuria::Internal::SnapshotView::string (const SnapshotString &string) const {
+	return QByteArray::fromRawData (this->strings + string.offset, string.length);
+}
+
+QVector< QByteArray > Nuria::Internal::SnapshotView::list (quint32 index) const {
+	const quint32 count = this->lists[index];
+	const SnapshotString *strings = reinterpret_cast< const SnapshotString * > (this->lists + index + 1);
+	
+	QVector< QByteArray > result;
+	result.reserve (count);
+	for (quint32 i = 0; i < count; i++) {
+		result.append (string (strings[i]));
+	}
+	
+	return result;
+}
+
+Nuria::Internal::SnapshotMetaObject::SnapshotMetaObject (const SnapshotView &view, const SnapshotType *type)
+	: m_view (view), m_type (type)
+{
+
+}
+
+Nuria::Internal::SnapshotRange Nuria::Internal::SnapshotMetaObject::annotationRange (int category, int index) const {
+	static const SnapshotRange empty = { 0, 0 };
+	
+	switch (Categories (category)) {
+	case ObjectCategory:
+		return this->m_type->annotations;
+	case MethodCategory:
+		if (index < 0 || uint (index) >= this->m_type->methods.count) break;
+		return this->m_view.methods[this->m_type->methods.first + index].annotations;
+	case FieldCategory:
+		if (index < 0 || uint (index) >= this->m_type->fields.count) break;
+		return this->m_view.fields[this->m_type->fields.first + index].annotations;
+	case EnumCategory:
+		if (index < 0 || uint (index) >= this->m_type->enums.count) break;
+		return this->m_view.enums[this->m_type->enums.first + index].annotations;
+	}
+	
+	return empty;
+}
+
+const Nuria::Internal::SnapshotAnnotation *
+Nuria::Internal::SnapshotMetaObject::annotation (int category, int index, int nth) const {
+	SnapshotRange range = annotationRange (category, index);
+	if (nth < 0 || uint (nth) >= range.count) {
+		return nullptr;
+	}
+	
+	return this->m_view.annotations + range.first + nth;
+}
+
+static QVariant readAnnotationValue (const Nuria::Internal::SnapshotView &view,
+				     const Nuria::Internal::SnapshotAnnotation *annotation) {
+	if (!annotation) {
+		return QVariant ();
+	}
+	
+	QByteArray data = QByteArray::fromRawData (view.values + annotation->value.first, annotation->value.count);
+	QDataStream stream (data);
+	stream.setVersion (QDataStream::Qt_5_0);
+	
+	QVariant value;
+	stream >> value;
+	return value;
+}
+
+// Helper macros. Accessors for records of this type with out-of-bounds check.
+#define RESULT(Type) *reinterpret_cast< Type * > (result)
+#define RECORD(Table, Index) \
+	((Index >= 0 && uint (Index) < this->m_type->Table.count) \
+	 ? &this->m_view.Table[this->m_type->Table.first + Index] : nullptr)
+	
+void Nuria::Internal::SnapshotMetaObject::gateCall (GateMethod method, int category, int index, int nth,
+						    void *result, void *additional) {
+	Q_UNUSED(additional)
+	
+	switch (method) {
+	case GateMethod::ClassName:
+		RESULT(QByteArray) = this->m_view.string (this->m_type->name);
+		break;
+	case GateMethod::MetaTypeId:
+	case GateMethod::PointerMetaTypeId:
+		RESULT(int) = 0;
+		break;
+	case GateMethod::BaseClasses:
+		RESULT(QVector< QByteArray >) = this->m_view.list (this->m_type->bases);
+		break;
+	case GateMethod::AnnotationCount:
+		RESULT(int) = annotationRange (category, index).count;
+		break;
+	case GateMethod::MethodCount:
+		RESULT(int) = this->m_type->methods.count;
+		break;
+	case GateMethod::FieldCount:
+		RESULT(int) = this->m_type->fields.count;
+		break;
+	case GateMethod::EnumCount:
+		RESULT(int) = this->m_type->enums.count;
+		break;
+	case GateMethod::AnnotationName:
+		if (const SnapshotAnnotation *cur = annotation (category, index, nth)) {
+			RESULT(QByteArray) = this->m_view.string (cur->name);
+		}
+		break;
+	case GateMethod::AnnotationValue:
+		RESULT(QVariant) = readAnnotationValue (this->m_view, annotation (category, index, nth));
+		break;
+	case GateMethod::MethodName:
+		if (const SnapshotMethod *cur = RECORD(methods, index)) {
+			RESULT(QByteArray) = this->m_view.string (cur->name);
+		}
+		break;
+	case GateMethod::MethodType:
+		if (const SnapshotMethod *cur = RECORD(methods, index)) {
+			RESULT(MetaMethod::Type) = MetaMethod::Type (cur->type);
+		}
+		break;
+	case GateMethod::MethodReturnType:
+		if (const SnapshotMethod *cur = RECORD(methods, index)) {
+			RESULT(QByteArray) = this->m_view.string (cur->returnType);
+		}
+		break;
+	case GateMethod::MethodArgumentNames:
+		if (const SnapshotMethod *cur = RECORD(methods, index)) {
+			RESULT(QVector< QByteArray >) = this->m_view.list (cur->argumentNames);
+		}
+		break;
+	case GateMethod::MethodArgumentTypes:
+		if (const SnapshotMethod *cur = RECORD(methods, index)) {
+			RESULT(QVector< QByteArray >) = this->m_view.list (cur->argumentTypes);
+		}
+		break;
+	case GateMethod::MethodCallback:
+	case GateMethod::MethodUnsafeCallback:
+	case GateMethod::MethodArgumentTest:
+		// Snapshots can't contain code, like the JSON data they're made of.
+		RESULT(Callback) = Callback ();
+		break;
+	case GateMethod::FieldName:
+		if (const SnapshotField *cur = RECORD(fields, index)) {
+			RESULT(QByteArray) = this->m_view.string (cur->name);
+		}
+		break;
+	case GateMethod::FieldType:
+		if (const SnapshotField *cur = RECORD(fields, index)) {
+			RESULT(QByteArray) = this->m_view.string (cur->type);
+		}
+		break;
+	case GateMethod::FieldRead:
+		RESULT(QVariant) = QVariant ();
+		break;
+	case GateMethod::FieldWrite:
+		RESULT(bool) = false;
+		break;
+	case GateMethod::FieldAccess:
+		if (const SnapshotField *cur = RECORD(fields, index)) {
+			RESULT(MetaField::Access) = MetaField::Access (cur->access);
+		}
+		break;
+	case GateMethod::EnumName:
+		if (const SnapshotEnum *cur = RECORD(enums, index)) {
+			RESULT(QByteArray) = this->m_view.string (cur->name);
+		}
+		break;
+	case GateMethod::EnumElementCount:
+		if (const SnapshotEnum *cur = RECORD(enums, index)) {
+			RESULT(int) = cur->elements.count;
+		}
+		break;
+	case GateMethod::EnumElementKey:
+		if (const SnapshotEnum *cur = RECORD(enums, index)) {
+			if (nth >= 0 && uint (nth) < cur->elements.count) {
+				RESULT(QByteArray) = this->m_view.string (this->m_view.elements[cur->elements.first + nth].key);
+			}
+		}
+		break;
+	case GateMethod::EnumElementValue:
+		if (const SnapshotEnum *cur = RECORD(enums, index)) {
+			if (nth >= 0 && uint (nth) < cur->elements.count) {
+				RESULT(int) = this->m_view.elements[cur->elements.first + nth].value;
+			}
+		}
+		break;
+	default:
+		// Nothing to do, e.g. for DestroyInstance.
+		break;
+	}
+	
+}
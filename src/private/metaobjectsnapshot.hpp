@@ -0,0 +1,177 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NURIA_INTERNAL_METAOBJECTSNAPSHOT_HPP
+#define NURIA_INTERNAL_METAOBJECTSNAPSHOT_HPP
+
+#include <QByteArray>
+#include <QVector>
+#include <QMap>
+
+#include "../nuria/metaobject.hpp"
+
+namespace Nuria {
+namespace Internal {
+
+/*
+ * Binary snapshot of MetaObjects. The snapshot is made of a header, followed
+ * by tables of fixed-size records and three blobs: Strings, string lists and
+ * annotation values. All numbers are stored as 32bit integers in the byte
+ * order of the writer, and all tables are aligned to 4 bytes. Thus, a mapped
+ * snapshot can be used in-place.
+ */
+
+// Reference to a string in the strings blob. Strings are NUL-terminated.
+struct SnapshotString {
+	quint32 offset;
+	quint32 length;
+};
+
+// Range of records in a table, or of bytes in a blob.
+struct SnapshotRange {
+	quint32 first;
+	quint32 count;
+};
+
+struct SnapshotFile {
+	SnapshotString name;
+	SnapshotRange types;
+};
+
+struct SnapshotType {
+	SnapshotString name;
+	quint32 bases; // Index in the lists blob
+	SnapshotRange annotations;
+	SnapshotRange methods;
+	SnapshotRange fields;
+	SnapshotRange enums;
+};
+
+struct SnapshotMethod {
+	SnapshotString name;
+	SnapshotString returnType;
+	quint32 type;
+	quint32 argumentNames; // Index in the lists blob
+	quint32 argumentTypes; // Index in the lists blob
+	SnapshotRange annotations;
+};
+
+struct SnapshotField {
+	SnapshotString name;
+	SnapshotString type;
+	quint32 access;
+	SnapshotRange annotations;
+};
+
+struct SnapshotEnum {
+	SnapshotString name;
+	SnapshotRange elements;
+	SnapshotRange annotations;
+};
+
+struct SnapshotElement {
+	SnapshotString key;
+	qint32 value;
+};
+
+struct SnapshotAnnotation {
+	SnapshotString name;
+	SnapshotRange value; // Bytes in the values blob, a QVariant in QDataStream format
+};
+
+// Position of a table or blob in the snapshot. 'count' is the count of
+// records, or of bytes for blobs.
+struct SnapshotTable {
+	quint32 offset;
+	quint32 count;
+};
+
+struct SnapshotHeader {
+	char magic[8];
+	quint32 version;
+	quint32 byteOrder;
+	SnapshotTable strings;
+	SnapshotTable lists; // Count of quint32: { count, SnapshotString ... }
+	SnapshotTable values;
+	SnapshotTable files;
+	SnapshotTable types;
+	SnapshotTable methods;
+	SnapshotTable fields;
+	SnapshotTable enums;
+	SnapshotTable elements;
+	SnapshotTable annotations;
+};
+
+/**
+ * \internal
+ * Access to the tables of a validated snapshot.
+ */
+struct SnapshotView {
+	
+	// Validates the snapshot in 'data' and sets up the view.
+	bool load (const char *data, qint64 size);
+	
+	QByteArray string (const SnapshotString &string) const;
+	QVector< QByteArray > list (quint32 index) const;
+	
+	const SnapshotHeader *header = nullptr;
+	const char *strings = nullptr;
+	const quint32 *lists = nullptr;
+	const char *values = nullptr;
+	const SnapshotFile *files = nullptr;
+	const SnapshotType *types = nullptr;
+	const SnapshotMethod *methods = nullptr;
+	const SnapshotField *fields = nullptr;
+	const SnapshotEnum *enums = nullptr;
+	const SnapshotElement *elements = nullptr;
+	const SnapshotAnnotation *annotations = nullptr;
+};
+
+/**
+ * \internal
+ * MetaObject reading the data of a type straight from a snapshot. Returned
+ * strings point into the snapshot, which must outlive the instance.
+ */
+class SnapshotMetaObject : public MetaObject {
+public:
+	
+	SnapshotMetaObject (const SnapshotView &view, const SnapshotType *type);
+	
+protected:
+	void gateCall (GateMethod method, int category, int index, int nth,
+		       void *result, void *additional) override;
+		
+private:
+	SnapshotRange annotationRange (int category, int index) const;
+	const SnapshotAnnotation *annotation (int category, int index, int nth) const;
+	
+	SnapshotView m_view;
+	const SnapshotType *m_type;
+	
+};
+
+/**
+ * \internal
+ * Writes a snapshot of the MetaObjects in \a files, mapping source files to
+ * their types.
+ */
+QByteArray writeSnapshot (const QMap< QString, MetaObjectMap > &files);
+
+} // namespace Internal
+} // namespace Nuria
+
+#endif // NURIA_INTERNAL_METAOBJECTSNAPSHOT_HPP
@@ -17,30 +17,183 @@
 #include "nuria/qtmetaobjectwrapper.hpp"
 
 #include <QMetaMethod>
+#include <QAtomicInt>
 #include <cstring>
 #include <QVector>
+#include <QMutex>
+#include <QMap>
+#include <QHash>
+
+namespace Nuria {
+class QtMetaObjectWrapperPrivate {
+public:
+	
+	const QMetaObject *meta;
+	
+	// Answered without populating
+	QByteArray className;
+	QVector< QByteArray > bases;
+	
+	// Class annotations. Kept here, so members can be populated while
+	// other threads read these.
+	QVector< QByteArray > annotationNames;
+	QVector< QVariant > annotationValues;
+	
+	// Absolute property index of each field, in field order
+	QVector< int > propertyIndices;
+	
+	QMutex mutex;
+	QAtomicInt annotationsPopulated;
+	QAtomicInt membersPopulated;
+	
+};
+}
+
+// Process-wide wrappers of forMetaObject()
+static QMutex g_wrappersMutex;
+static QHash< const QMetaObject *, Nuria::QtMetaObjectWrapper * > g_wrappers;
 
 Nuria::QtMetaObjectWrapper::QtMetaObjectWrapper (const QMetaObject *metaObject)
-	: RuntimeMetaObject (metaObject->className ())
+	: RuntimeMetaObject (metaObject->className ()), d_ptr (new QtMetaObjectWrapperPrivate)
 {
 	
-	installDeleter ();
-	populateAnnotations (metaObject);
-	populateMethods (metaObject);
-	populateEnums (metaObject);
-	populateFields (metaObject);
+	this->d_ptr->meta = metaObject;
+	this->d_ptr->className = metaObject->className ();
 	
 	const QMetaObject *base = metaObject->superClass ();
 	if (base) {
-		setBaseClasses ({ base->className () });
+		this->d_ptr->bases.append (base->className ());
 	}
 	
-	finalize ();
+	installDeleter ();
 	
 }
 
 Nuria::QtMetaObjectWrapper::~QtMetaObjectWrapper () {
-	// 
+	delete this->d_ptr;
+}
+
+Nuria::QtMetaObjectWrapper *Nuria::QtMetaObjectWrapper::forMetaObject (const QMetaObject *metaObject) {
+	QMutexLocker lock (&g_wrappersMutex);
+	
+	QtMetaObjectWrapper *&wrapper = g_wrappers[metaObject];
+	if (!wrapper) {
+		wrapper = new QtMetaObjectWrapper (metaObject);
+	}
+	
+	return wrapper;
+}
+
+#define RESULT(Type) *reinterpret_cast< Type * > (result)
+void Nuria::QtMetaObjectWrapper::gateCall (GateMethod method, int category, int index, int nth,
+					   void *result, void *additional) {
+	switch (method) {
+	case GateMethod::ClassName:
+		RESULT(QByteArray) = this->d_ptr->className;
+		return;
+	case GateMethod::BaseClasses:
+		RESULT(QVector< QByteArray >) = this->d_ptr->bases;
+		return;
+	case GateMethod::MetaTypeId:
+	case GateMethod::PointerMetaTypeId:
+	case GateMethod::DestroyInstance:
+		// Set up by the constructor. RuntimeMetaObject answers these
+		// without reading the elements populateMembers() writes.
+		RuntimeMetaObject::gateCall (method, category, index, nth, result, additional);
+		return;
+	case GateMethod::AnnotationCount:
+	case GateMethod::AnnotationName:
+	case GateMethod::AnnotationValue:
+		if (category == 0) {
+			populateTypeAnnotations ();
+			
+			const QVector< QByteArray > &names = this->d_ptr->annotationNames;
+			bool valid = (nth >= 0 && nth < names.size ());
+			if (method == GateMethod::AnnotationCount) {
+				RESULT(int) = names.size ();
+			} else if (method == GateMethod::AnnotationName) {
+				RESULT(QByteArray) = valid ? names.at (nth) : QByteArray ();
+			} else {
+				RESULT(QVariant) = valid ? this->d_ptr->annotationValues.at (nth) : QVariant ();
+			}
+			
+			return;
+		}
+		
+		break;
+	case GateMethod::FieldReadInto:
+	case GateMethod::FieldWriteFrom:
+		populateMembers ();
+		RESULT(bool) = accessProperty (method == GateMethod::FieldWriteFrom, index, additional);
+		return;
+	default:
+		break;
+	}
+	
+	populateMembers ();
+	RuntimeMetaObject::gateCall (method, category, index, nth, result, additional);
+	
+}
+
+bool Nuria::QtMetaObjectWrapper::accessProperty (bool write, int index, void *additional) {
+	if (index < 0 || index >= this->d_ptr->propertyIndices.size ()) {
+		return false;
+	}
+	
+	void **argData = reinterpret_cast< void ** > (additional);
+	QObject *object = reinterpret_cast< QObject * > (argData[0]);
+	int typeId = *reinterpret_cast< int * > (argData[2]);
+	
+	// Conversions are left to the QVariant based fall back of MetaField.
+	int propertyIndex = this->d_ptr->propertyIndices.at (index);
+	QMetaProperty property = this->d_ptr->meta->property (propertyIndex);
+	if (property.userType () != typeId || !(write ? property.isWritable () : property.isReadable ())) {
+		return false;
+	}
+	
+	// Same arguments as used by QMetaProperty::read() and write()
+	int status = -1;
+	int flags = 0;
+	void *argv[] = { argData[1], nullptr, &status, &flags };
+	QMetaObject::Call call = (write) ? QMetaObject::WriteProperty : QMetaObject::ReadProperty;
+	
+	QMetaObject::metacall (object, call, propertyIndex, argv);
+	return (status != 0);
+}
+
+void Nuria::QtMetaObjectWrapper::populateTypeAnnotations () {
+	if (this->d_ptr->annotationsPopulated.loadAcquire ()) {
+		return;
+	}
+	
+	QMutexLocker lock (&this->d_ptr->mutex);
+	if (!this->d_ptr->annotationsPopulated.load ()) {
+		populateAnnotations (this->d_ptr->meta);
+		this->d_ptr->annotationsPopulated.storeRelease (1);
+	}
+	
+}
+
+void Nuria::QtMetaObjectWrapper::populateMembers () {
+	if (this->d_ptr->membersPopulated.loadAcquire ()) {
+		return;
+	}
+	
+	QMutexLocker lock (&this->d_ptr->mutex);
+	if (this->d_ptr->membersPopulated.load ()) {
+		return;
+	}
+	
+	// The frozen layout is built as a whole, so all members are read at
+	// once.
+	const QMetaObject *meta = this->d_ptr->meta;
+	populateMethods (meta);
+	populateEnums (meta);
+	populateFields (meta);
+	setBaseClasses (this->d_ptr->bases);
+	finalize ();
+	
+	this->d_ptr->membersPopulated.storeRelease (1);
 }
 
 void Nuria::QtMetaObjectWrapper::installDeleter () {
@@ -61,7 +214,11 @@ void Nuria::QtMetaObjectWrapper::populateAnnotations (const QMetaObject *meta) {
 		map.insert (info.name (), QString (info.value ()));
 	}
 	
-	setAnnotations (map);
+	// Same order as in a frozen RuntimeMetaObject
+	for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it) {
+		this->d_ptr->annotationNames.append (it.key ());
+		this->d_ptr->annotationValues.append (it.value ());
+	}
 	
 }
 
@@ -165,8 +322,13 @@ static void registerProperty (Nuria::RuntimeMetaObject *meta, QMetaProperty p) {
 
 void Nuria::QtMetaObjectWrapper::populateFields (const QMetaObject *meta) {
 	
+	QMap< QByteArray, int > indices;
 	for (int i = meta->propertyOffset (); i < meta->propertyCount (); i++) {
 		registerProperty (this, meta->property (i));
+		indices.insert (meta->property (i).name (), i);
 	}
 	
+	// Fields are sorted by name
+	this->d_ptr->propertyIndices = indices.values ().toVector ();
+	
 }
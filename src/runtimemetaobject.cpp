@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <QMultiMap>
 #include <QVector>
+#include <QHash>
+#include <QSet>
 
 enum Categories {
 	ObjectCategory = 0,
@@ -35,6 +37,7 @@ struct MethodData {
 	QVector< QByteArray > argNames;
 	QVector< QByteArray > argTypes;
 	Nuria::RuntimeMetaObject::InvokeCreator creator;
+	Nuria::Callback invoker;
 	
 	bool operator== (const MethodData &other) {
 		return (this->name == other.name && this->argTypes == other.argTypes);
@@ -53,11 +56,68 @@ struct FieldData {
 	Nuria::RuntimeMetaObject::AnnotationMap annotations;
 	Nuria::RuntimeMetaObject::FieldGetter getter;
 	Nuria::RuntimeMetaObject::FieldSetter setter;
+	int offset = -1; // Of plain members
+};
+
+// Elements added since the last finalize().
+struct BuilderData {
+	QVector< MethodData > methods;
+	QMap< QByteArray, EnumData > enums;
+	QMap< QByteArray, FieldData > fields;
+	Nuria::RuntimeMetaObject::AnnotationMap annotations;
+};
+
+// Range of annotations in FrozenLayout.
+struct AnnotationBlock {
+	int begin;
+	int end;
+};
+
+// Layout of a finalized RuntimeMetaObject. Elements are stored as structure of
+// arrays. Equal strings and argument lists share their data, and equal
+// annotation maps are stored only once. Annotation block 0 is always empty.
+struct FrozenLayout {
+	FrozenLayout () : annotationBlocks (1, AnnotationBlock { 0, 0 }) {}
+	
+	QVector< QByteArray > annotationKeys;
+	QVector< QVariant > annotationValues;
+	QVector< AnnotationBlock > annotationBlocks;
+	int objectAnnotations = 0;
+	
+	QVector< QVector< QByteArray > > argumentLists;
+	
+	QVector< QByteArray > methodNames;
+	QVector< QByteArray > methodReturnTypes;
+	QVector< Nuria::MetaMethod::Type > methodTypes;
+	QVector< int > methodArgumentNames; // Index in argumentLists
+	QVector< int > methodArgumentTypes; // Index in argumentLists
+	QVector< int > methodAnnotations; // Index in annotationBlocks
+	QVector< Nuria::RuntimeMetaObject::InvokeCreator > methodCreators;
+	QVector< Nuria::Callback > methodInvokers;
+	
+	QVector< QByteArray > fieldNames;
+	QVector< QByteArray > fieldTypes;
+	QVector< Nuria::MetaField::Access > fieldAccess;
+	QVector< int > fieldOffsets;
+	QVector< int > fieldAnnotations;
+	QVector< Nuria::RuntimeMetaObject::FieldGetter > fieldGetters;
+	QVector< Nuria::RuntimeMetaObject::FieldSetter > fieldSetters;
+	
+	QVector< QByteArray > enumNames;
+	QVector< int > enumAnnotations;
+	QVector< int > enumElements; // Begin in enumKeys, has one more element
+	QVector< QByteArray > enumKeys;
+	QVector< int > enumValues;
 };
 
 namespace Nuria {
 class RuntimeMetaObjectPrivate {
 public:
+	~RuntimeMetaObjectPrivate () { delete this->builder; }
+	
+	BuilderData *edit ();
+	void freeze ();
+	
 	QByteArray className;
 	int valueTypeId = 0;
 	int poinerTypeId = 0;
@@ -65,13 +125,405 @@ public:
 	QVector< QByteArray > bases;
 	RuntimeMetaObject::InstanceDeleter deleter;
 	
-	QVector< MethodData > methods;
-	QMap< QByteArray, EnumData > enums;
-	QMap< QByteArray, FieldData > fields;
+	// Elements are added to 'builder', which finalize() freezes into 'layout'.
+	// Until then, elements are read from 'builder'.
+	BuilderData *builder = nullptr;
+	FrozenLayout layout;
+	qint64 savedBytes = 0;
+};
+
+}
+
+// Estimates the heap memory used by strings and containers. Data shared by
+// multiple instances is only counted once.
+class HeapCounter {
+public:
+	
+	void add (qint64 bytes) { this->m_total += bytes; }
+	
+	void add (const QByteArray &string) {
+		if (string.capacity () > 0 && isNew (string.constData ())) {
+			add (qint64 (sizeof(QArrayData)) + string.capacity () + 1);
+		}
+		
+	}
+	
+	template< typename T >
+	void add (const QVector< T > &vector) {
+		if (vector.capacity () > 0 && isNew (vector.constData ())) {
+			add (qint64 (sizeof(QArrayData)) + vector.capacity () * qint64 (sizeof(T)));
+		}
+		
+	}
+	
+	void addStrings (const QVector< QByteArray > &vector) {
+		add (vector);
+		for (const QByteArray &cur : vector) {
+			add (cur);
+		}
+		
+	}
+	
+	// Map nodes hold two child pointers and the parent pointer with color.
+	template< typename K, typename V >
+	void addNodes (const QMap< K, V > &map) {
+		add (map.size () * qint64 (3 * sizeof(void *) + sizeof(K) + sizeof(V)));
+	}
+	
+	void add (const Nuria::RuntimeMetaObject::AnnotationMap &map) {
+		if (map.isEmpty () || !isNew (&*map.constBegin ())) {
+			return;
+		}
+		
+		addNodes (map);
+		for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it) {
+			add (it.key ());
+		}
+		
+	}
+	
+	qint64 total () const { return this->m_total; }
+	
+private:
+	bool isNew (const void *data) {
+		if (this->m_seen.contains (data)) {
+			return false;
+		}
+		
+		this->m_seen.insert (data);
+		return true;
+	}
+	
+	QSet< const void * > m_seen;
+	qint64 m_total = 0;
+	
+};
+
+static qint64 builderSize (const BuilderData &builder) {
+	HeapCounter counter;
+	
+	counter.add (builder.annotations);
+	counter.add (builder.methods);
+	for (const MethodData &cur : builder.methods) {
+		counter.add (cur.name);
+		counter.add (cur.returnType);
+		counter.addStrings (cur.argNames);
+		counter.addStrings (cur.argTypes);
+		counter.add (cur.annotations);
+	}
+	
+	counter.addNodes (builder.fields);
+	for (auto it = builder.fields.constBegin (); it != builder.fields.constEnd (); ++it) {
+		counter.add (it.key ());
+		counter.add (it->valueType);
+		counter.add (it->annotations);
+	}
+	
+	counter.addNodes (builder.enums);
+	for (auto it = builder.enums.constBegin (); it != builder.enums.constEnd (); ++it) {
+		counter.add (it.key ());
+		counter.add (it->annotations);
+		counter.addNodes (it->elements);
+		for (auto elem = it->elements.constBegin (); elem != it->elements.constEnd (); ++elem) {
+			counter.add (elem.key ());
+		}
+		
+	}
+	
+	return counter.total ();
+}
+
+static qint64 layoutSize (const FrozenLayout &layout) {
+	HeapCounter counter;
+	
+	counter.addStrings (layout.annotationKeys);
+	counter.add (layout.annotationValues);
+	counter.add (layout.annotationBlocks);
+	
+	counter.add (layout.argumentLists);
+	for (const QVector< QByteArray > &cur : layout.argumentLists) {
+		counter.addStrings (cur);
+	}
+	
+	counter.addStrings (layout.methodNames);
+	counter.addStrings (layout.methodReturnTypes);
+	counter.add (layout.methodTypes);
+	counter.add (layout.methodArgumentNames);
+	counter.add (layout.methodArgumentTypes);
+	counter.add (layout.methodAnnotations);
+	counter.add (layout.methodCreators);
+	counter.add (layout.methodInvokers);
+	
+	counter.addStrings (layout.fieldNames);
+	counter.addStrings (layout.fieldTypes);
+	counter.add (layout.fieldAccess);
+	counter.add (layout.fieldOffsets);
+	counter.add (layout.fieldAnnotations);
+	counter.add (layout.fieldGetters);
+	counter.add (layout.fieldSetters);
+	
+	counter.addStrings (layout.enumNames);
+	counter.add (layout.enumAnnotations);
+	counter.add (layout.enumElements);
+	counter.addStrings (layout.enumKeys);
+	counter.add (layout.enumValues);
+	
+	return counter.total ();
+}
+
+// Builds a FrozenLayout, sharing equal strings, argument lists and annotations.
+class LayoutFreezer {
+public:
+	
+	LayoutFreezer (FrozenLayout &layout)
+		: m_layout (layout)
+	{}
+	
+	QByteArray string (const QByteArray &string) {
+		if (string.isEmpty ()) {
+			return QByteArray ();
+		}
+		
+		auto it = this->m_strings.constFind (string);
+		if (it != this->m_strings.constEnd ()) {
+			return *it;
+		}
+		
+		QByteArray copy (string);
+		copy.squeeze ();
+		this->m_strings.insert (copy);
+		return copy;
+	}
+	
+	int argumentList (const QVector< QByteArray > &list) {
+		QByteArray signature = QByteArray::number (list.size ());
+		for (const QByteArray &cur : list) {
+			signature.append ('\0');
+			signature.append (cur);
+		}
+		
+		auto it = this->m_argumentLists.constFind (signature);
+		if (it != this->m_argumentLists.constEnd ()) {
+			return *it;
+		}
+		
+		QVector< QByteArray > interned;
+		interned.reserve (list.size ());
+		for (const QByteArray &cur : list) {
+			interned.append (string (cur));
+		}
+		
+		int index = this->m_layout.argumentLists.size ();
+		this->m_layout.argumentLists.append (interned);
+		this->m_argumentLists.insert (signature, index);
+		return index;
+	}
+	
+	int annotations (const Nuria::RuntimeMetaObject::AnnotationMap &map) {
+		if (map.isEmpty ()) {
+			return 0;
+		}
+		
+		// Blocks with the same keys are candidates
+		QByteArray signature = QByteArray::number (map.size ());
+		for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it) {
+			signature.append ('\0');
+			signature.append (it.key ());
+		}
+		
+		QVector< int > &candidates = this->m_annotations[signature];
+		for (int block : candidates) {
+			if (sameValues (block, map)) {
+				return block;
+			}
+			
+		}
+		
+		// Add a new block
+		AnnotationBlock block { this->m_layout.annotationKeys.size (), 0 };
+		for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it) {
+			this->m_layout.annotationKeys.append (string (it.key ()));
+			this->m_layout.annotationValues.append (it.value ());
+		}
+		
+		block.end = this->m_layout.annotationKeys.size ();
+		candidates.append (this->m_layout.annotationBlocks.size ());
+		this->m_layout.annotationBlocks.append (block);
+		return candidates.last ();
+	}
+	
+private:
+	
+	bool sameValues (int index, const Nuria::RuntimeMetaObject::AnnotationMap &map) {
+		const AnnotationBlock &block = this->m_layout.annotationBlocks.at (index);
+		int i = block.begin;
+		
+		// QVariant::operator==() converts, so check the types too
+		for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it, i++) {
+			const QVariant &value = this->m_layout.annotationValues.at (i);
+			if (value.userType () != it->userType () || value != *it) {
+				return false;
+			}
+			
+		}
+		
+		return true;
+	}
+	
+	FrozenLayout &m_layout;
+	QSet< QByteArray > m_strings;
+	QHash< QByteArray, int > m_argumentLists;
+	QHash< QByteArray, QVector< int > > m_annotations;
 	
-	RuntimeMetaObject::AnnotationMap annotations;
 };
 
+void Nuria::RuntimeMetaObjectPrivate::freeze () {
+	if (!this->builder) {
+		return;
+	}
+	
+	FrozenLayout frozen;
+	LayoutFreezer freezer (frozen);
+	qint64 before = builderSize (*this->builder);
+	
+	frozen.objectAnnotations = freezer.annotations (this->builder->annotations);
+	
+	// Methods
+	int count = this->builder->methods.size ();
+	frozen.methodNames.reserve (count);
+	frozen.methodReturnTypes.reserve (count);
+	frozen.methodTypes.reserve (count);
+	frozen.methodArgumentNames.reserve (count);
+	frozen.methodArgumentTypes.reserve (count);
+	frozen.methodAnnotations.reserve (count);
+	frozen.methodCreators.reserve (count);
+	frozen.methodInvokers.reserve (count);
+	
+	for (const MethodData &cur : this->builder->methods) {
+		frozen.methodNames.append (freezer.string (cur.name));
+		frozen.methodReturnTypes.append (freezer.string (cur.returnType));
+		frozen.methodTypes.append (cur.type);
+		frozen.methodArgumentNames.append (freezer.argumentList (cur.argNames));
+		frozen.methodArgumentTypes.append (freezer.argumentList (cur.argTypes));
+		frozen.methodAnnotations.append (freezer.annotations (cur.annotations));
+		frozen.methodCreators.append (cur.creator);
+		frozen.methodInvokers.append (cur.invoker);
+	}
+	
+	// Fields
+	count = this->builder->fields.size ();
+	frozen.fieldNames.reserve (count);
+	frozen.fieldTypes.reserve (count);
+	frozen.fieldAccess.reserve (count);
+	frozen.fieldOffsets.reserve (count);
+	frozen.fieldAnnotations.reserve (count);
+	frozen.fieldGetters.reserve (count);
+	frozen.fieldSetters.reserve (count);
+	
+	for (auto it = this->builder->fields.constBegin (); it != this->builder->fields.constEnd (); ++it) {
+		frozen.fieldNames.append (freezer.string (it.key ()));
+		frozen.fieldTypes.append (freezer.string (it->valueType));
+		frozen.fieldAccess.append (it->access);
+		frozen.fieldOffsets.append (it->offset);
+		frozen.fieldAnnotations.append (freezer.annotations (it->annotations));
+		frozen.fieldGetters.append (it->getter);
+		frozen.fieldSetters.append (it->setter);
+	}
+	
+	// Enums
+	count = this->builder->enums.size ();
+	frozen.enumNames.reserve (count);
+	frozen.enumAnnotations.reserve (count);
+	frozen.enumElements.reserve (count + 1);
+	
+	for (auto it = this->builder->enums.constBegin (); it != this->builder->enums.constEnd (); ++it) {
+		frozen.enumNames.append (freezer.string (it.key ()));
+		frozen.enumAnnotations.append (freezer.annotations (it->annotations));
+		frozen.enumElements.append (frozen.enumKeys.size ());
+		
+		for (auto elem = it->elements.constBegin (); elem != it->elements.constEnd (); ++elem) {
+			frozen.enumKeys.append (freezer.string (elem.key ()));
+			frozen.enumValues.append (*elem);
+		}
+		
+	}
+	
+	frozen.enumElements.append (frozen.enumKeys.size ());
+	frozen.annotationKeys.squeeze ();
+	frozen.annotationValues.squeeze ();
+	frozen.annotationBlocks.squeeze ();
+	frozen.argumentLists.squeeze ();
+	frozen.enumKeys.squeeze ();
+	frozen.enumValues.squeeze ();
+	
+	// Done
+	this->layout = frozen;
+	this->savedBytes = before - layoutSize (this->layout);
+	
+	delete this->builder;
+	this->builder = nullptr;
+	
+}
+
+// Copies the annotations of 'block' into a AnnotationMap.
+static Nuria::RuntimeMetaObject::AnnotationMap thawAnnotations (const FrozenLayout &layout, int index) {
+	Nuria::RuntimeMetaObject::AnnotationMap map;
+	const AnnotationBlock &block = layout.annotationBlocks.at (index);
+	
+	// Insert backwards, as QMultiMap puts the latest value first.
+	for (int i = block.end - 1; i >= block.begin; i--) {
+		map.insert (layout.annotationKeys.at (i), layout.annotationValues.at (i));
+	}
+	
+	return map;
+}
+
+BuilderData *Nuria::RuntimeMetaObjectPrivate::edit () {
+	if (this->builder) {
+		return this->builder;
+	}
+	
+	// Thaw the layout again
+	const FrozenLayout &frozen = this->layout;
+	this->builder = new BuilderData;
+	this->builder->annotations = thawAnnotations (frozen, frozen.objectAnnotations);
+	
+	for (int i = 0; i < frozen.methodNames.size (); i++) {
+		MethodData data;
+		data.type = frozen.methodTypes.at (i);
+		data.annotations = thawAnnotations (frozen, frozen.methodAnnotations.at (i));
+		data.name = frozen.methodNames.at (i);
+		data.returnType = frozen.methodReturnTypes.at (i);
+		data.argNames = frozen.argumentLists.at (frozen.methodArgumentNames.at (i));
+		data.argTypes = frozen.argumentLists.at (frozen.methodArgumentTypes.at (i));
+		data.creator = frozen.methodCreators.at (i);
+		data.invoker = frozen.methodInvokers.at (i);
+		this->builder->methods.append (data);
+	}
+	
+	for (int i = 0; i < frozen.fieldNames.size (); i++) {
+		FieldData data;
+		data.access = frozen.fieldAccess.at (i);
+		data.valueType = frozen.fieldTypes.at (i);
+		data.annotations = thawAnnotations (frozen, frozen.fieldAnnotations.at (i));
+		data.getter = frozen.fieldGetters.at (i);
+		data.setter = frozen.fieldSetters.at (i);
+		data.offset = frozen.fieldOffsets.at (i);
+		this->builder->fields.insert (frozen.fieldNames.at (i), data);
+	}
+	
+	for (int i = 0; i < frozen.enumNames.size (); i++) {
+		EnumData data;
+		data.annotations = thawAnnotations (frozen, frozen.enumAnnotations.at (i));
+		
+		for (int j = frozen.enumElements.at (i); j < frozen.enumElements.at (i + 1); j++) {
+			data.elements.insert (frozen.enumKeys.at (j), frozen.enumValues.at (j));
+		}
+		
+		this->builder->enums.insert (frozen.enumNames.at (i), data);
+	}
+	
+	return this->builder;
 }
 
 static void defaultInstanceDeleter (void *) {}
@@ -90,6 +542,17 @@ Nuria::RuntimeMetaObject::~RuntimeMetaObject () {
 	delete this->d;
 }
 
+void Nuria::RuntimeMetaObject::beginEdit () {
+	// Frozen elements may be read by other threads, which may still use the
+	// lookup index. Before finalize(), no other thread may read at all.
+	if (this->d->builder) {
+		discardLookupIndex ();
+	} else {
+		invalidateLookupIndex ();
+	}
+	
+}
+
 void Nuria::RuntimeMetaObject::setQtMetaTypeId (int valueTypeId) {
 	this->d->valueTypeId = valueTypeId;
 }
@@ -99,7 +562,8 @@ void Nuria::RuntimeMetaObject::setQtMetaTypePointerId (int pointerTypeId) {
 }
 
 void Nuria::RuntimeMetaObject::setAnnotations (const AnnotationMap &annotations) {
-	this->d->annotations = annotations;
+	beginEdit ();
+	this->d->edit ()->annotations = annotations;
 }
 
 void Nuria::RuntimeMetaObject::setBaseClasses (const QVector< QByteArray > &bases) {
@@ -114,6 +578,15 @@ void Nuria::RuntimeMetaObject::addMethod (Nuria::MetaMethod::Type type, const QB
 					  const QByteArray &returnType, const QVector< QByteArray > &argumentNames,
 					  const QVector< QByteArray > &argumentTypes, const AnnotationMap &annotations,
 					  Nuria::RuntimeMetaObject::InvokeCreator invokeCreator) {
+	addMethod (type, name, returnType, argumentNames, argumentTypes, annotations,
+		   invokeCreator, Callback ());
+}
+
+void Nuria::RuntimeMetaObject::addMethod (Nuria::MetaMethod::Type type, const QByteArray &name,
+					  const QByteArray &returnType, const QVector< QByteArray > &argumentNames,
+					  const QVector< QByteArray > &argumentTypes, const AnnotationMap &annotations,
+					  Nuria::RuntimeMetaObject::InvokeCreator invokeCreator,
+					  const Callback &invoker) {
 	MethodData data;
 	data.type = type;
 	data.annotations = annotations;
@@ -122,13 +595,16 @@ void Nuria::RuntimeMetaObject::addMethod (Nuria::MetaMethod::Type type, const QB
 	data.argNames = argumentNames;
 	data.argTypes = argumentTypes;
 	data.creator = invokeCreator;
+	data.invoker = invoker;
 	
 	// Replace or append
-	int idx = this->d->methods.indexOf (data);
+	beginEdit ();
+	QVector< MethodData > &methods = this->d->edit ()->methods;
+	int idx = methods.indexOf (data);
 	if (idx != -1) {
-		this->d->methods.replace (idx, data);
+		methods.replace (idx, data);
 	} else {
-		this->d->methods.append (data);
+		methods.append (data);
 	}
 	
 }
@@ -139,7 +615,8 @@ void Nuria::RuntimeMetaObject::addEnum (const QByteArray &name, const Annotation
 	data.annotations = annotations;
 	data.elements = keyValueMap;
 	
-	this->d->enums.insert (name, data);
+	beginEdit ();
+	this->d->edit ()->enums.insert (name, data);
 	
 }
 
@@ -153,7 +630,8 @@ void Nuria::RuntimeMetaObject::addField (const QByteArray &name, const QByteArra
 	data.getter = getter;
 	data.setter = setter;
 	
-	this->d->fields.insert (name, data);
+	beginEdit ();
+	this->d->edit ()->fields.insert (name, data);
 	
 }
 
@@ -167,7 +645,43 @@ void Nuria::RuntimeMetaObject::addField (const QByteArray &name, const QByteArra
         data.getter = getter;
         data.setter = defaultFieldSetter;
         
-        this->d->fields.insert (name, data);
+        beginEdit ();
+        this->d->edit ()->fields.insert (name, data);
+	
+}
+
+void Nuria::RuntimeMetaObject::addPlainField (const QByteArray &name, const QByteArray &valueType,
+					      const AnnotationMap &annotations, int offset,
+					      MetaField::Access access) {
+	int typeId = QMetaType::type (valueType.constData ());
+	
+	FieldData data;
+	data.access = access;
+	data.valueType = valueType;
+	data.annotations = annotations;
+	data.offset = offset;
+	data.setter = defaultFieldSetter;
+	
+	data.getter = [offset, typeId](void *instance) {
+		return QVariant (typeId, static_cast< char * > (instance) + offset);
+	};
+	
+	if (access & MetaField::WriteOnly) {
+		data.setter = [offset, typeId](void *instance, const QVariant &value) {
+			QVariant converted (value);
+			if (converted.userType () != typeId && !converted.convert (typeId)) {
+				return false;
+			}
+			
+			void *target = static_cast< char * > (instance) + offset;
+			QMetaType::destruct (typeId, target);
+			return (QMetaType::construct (typeId, target, converted.constData ()) != nullptr);
+		};
+		
+	}
+	
+	beginEdit ();
+	this->d->edit ()->fields.insert (name, data);
 	
 }
 
@@ -181,49 +695,228 @@ static bool methodLess (const MethodData &lhs, const MethodData &rhs) {
 
 void Nuria::RuntimeMetaObject::finalize () {
 	
-	// Sort methods (See MetaObject for details)
-	std::sort (this->d->methods.begin (), this->d->methods.end (), methodLess);
+	// Sort methods (See MetaObject for details) and freeze the elements
+	if (this->d->builder) {
+		QVector< MethodData > &methods = this->d->builder->methods;
+		std::sort (methods.begin (), methods.end (), methodLess);
+		this->d->freeze ();
+	}
 	
 	// Sort bases
 	std::sort (this->d->bases.begin (), this->d->bases.end ());
 	
+	// Elements may have changed since the last lookup
+	invalidateLookupIndex ();
+	
+}
+
+qint64 Nuria::RuntimeMetaObject::savedBytes () const {
+	return this->d->savedBytes;
+}
+
+// Helper macros. Accessors for the frozen layout with out-of-bounds check.
+#define BOUNDS_CHECK(Container, Index) (Index >= 0 && Index < Container.size ())
+#define LAYOUT_ACCESS(Vector, Index, OnFail) \
+	return BOUNDS_CHECK(this->d->layout.Vector, Index) ? this->d->layout.Vector.at (Index) : OnFail
+
+// Returns the annotations of the element 'index' in 'category' of 'builder'.
+static const Nuria::RuntimeMetaObject::AnnotationMap *builderAnnotations (const BuilderData &builder,
+									 int category, int index) {
+	switch (Categories (category)) {
+	case ObjectCategory:
+		return &builder.annotations;
+	case MethodCategory:
+		return BOUNDS_CHECK(builder.methods, index) ? &builder.methods.at (index).annotations : nullptr;
+	case FieldCategory:
+		return BOUNDS_CHECK(builder.fields, index) ? &(builder.fields.constBegin () + index)->annotations : nullptr;
+	case EnumCategory:
+		return BOUNDS_CHECK(builder.enums, index) ? &(builder.enums.constBegin () + index)->annotations : nullptr;
+	}
+	
+	return nullptr;
 }
 
 // This macro makes gateCall() a whole lot easier to read.
 #define RESULT(Type) *reinterpret_cast< Type * > (result)
+#define BUILDER_ACCESS(Container, Index, OnFail, OnSuccess) \
+	(BOUNDS_CHECK(builder.Container, Index) ? (builder.Container.constBegin () + Index)->OnSuccess : OnFail)
+
+// Answers 'method' for elements added since the last finalize(), without
+// freezing them first. Returns \c false if 'method' doesn't read elements.
+static bool builderGateCall (const BuilderData &builder, Nuria::MetaObject::GateMethod method,
+			     int category, int index, int nth, void *result, void *additional) {
+	using namespace Nuria;
+	
+	switch (method) {
+	case MetaObject::GateMethod::AnnotationCount: {
+		const RuntimeMetaObject::AnnotationMap *map = builderAnnotations (builder, category, index);
+		RESULT(int) = map ? map->size () : 0;
+	} break;
+		
+	case MetaObject::GateMethod::AnnotationName: {
+		const RuntimeMetaObject::AnnotationMap *map = builderAnnotations (builder, category, index);
+		RESULT(QByteArray) = (map && BOUNDS_CHECK((*map), nth)) ? (map->constBegin () + nth).key () : QByteArray ();
+	} break;
+		
+	case MetaObject::GateMethod::AnnotationValue: {
+		const RuntimeMetaObject::AnnotationMap *map = builderAnnotations (builder, category, index);
+		RESULT(QVariant) = (map && BOUNDS_CHECK((*map), nth)) ? *(map->constBegin () + nth) : QVariant ();
+	} break;
+		
+	case MetaObject::GateMethod::MethodCount:
+		RESULT(int) = builder.methods.size ();
+		break;
+		
+	case MetaObject::GateMethod::FieldCount:
+		RESULT(int) = builder.fields.size ();
+		break;
+		
+	case MetaObject::GateMethod::EnumCount:
+		RESULT(int) = builder.enums.size ();
+		break;
+		
+	case MetaObject::GateMethod::MethodName:
+		RESULT(QByteArray) = BUILDER_ACCESS(methods, index, QByteArray (), name);
+		break;
+		
+	case MetaObject::GateMethod::MethodType:
+		RESULT(MetaMethod::Type) = BUILDER_ACCESS(methods, index, MetaMethod::Method, type);
+		break;
+		
+	case MetaObject::GateMethod::MethodReturnType:
+		RESULT(QByteArray) = BUILDER_ACCESS(methods, index, QByteArray (), returnType);
+		break;
+		
+	case MetaObject::GateMethod::MethodArgumentNames:
+		RESULT(QVector< QByteArray >) = BUILDER_ACCESS(methods, index, QVector< QByteArray > (), argNames);
+		break;
+		
+	case MetaObject::GateMethod::MethodArgumentTypes:
+		RESULT(QVector< QByteArray >) = BUILDER_ACCESS(methods, index, QVector< QByteArray > (), argTypes);
+		break;
+		
+	case MetaObject::GateMethod::MethodCallback:
+		RESULT(Callback) = BUILDER_ACCESS(methods, index, Callback (), creator (additional, RuntimeMetaObject::InvokeAction::Invoke));
+		break;
+		
+	case MetaObject::GateMethod::MethodUnsafeCallback:
+		RESULT(Callback) = BUILDER_ACCESS(methods, index, Callback (), creator (additional, RuntimeMetaObject::InvokeAction::UnsafeInvoke));
+		break;
+		
+	case MetaObject::GateMethod::MethodArgumentTest:
+		RESULT(Callback) = BUILDER_ACCESS(methods, index, Callback (), creator (additional, RuntimeMetaObject::InvokeAction::ArgumentTest));
+		break;
+		
+	case MetaObject::GateMethod::MethodInvoker:
+		RESULT(Callback) = BUILDER_ACCESS(methods, index, Callback (), invoker);
+		break;
+		
+	case MetaObject::GateMethod::FieldName:
+		RESULT(QByteArray) = BOUNDS_CHECK(builder.fields, index) ? (builder.fields.constBegin () + index).key () : QByteArray ();
+		break;
+		
+	case MetaObject::GateMethod::FieldType:
+		RESULT(QByteArray) = BUILDER_ACCESS(fields, index, QByteArray (), valueType);
+		break;
+		
+	case MetaObject::GateMethod::FieldRead:
+		RESULT(QVariant) = BUILDER_ACCESS(fields, index, QVariant (), getter (additional));
+		break;
+		
+	case MetaObject::GateMethod::FieldWrite: {
+		void **argData = reinterpret_cast< void ** > (additional);
+		const QVariant &value = *reinterpret_cast< QVariant * > (argData[1]);
+		RESULT(bool) = BUILDER_ACCESS(fields, index, false, setter (argData[0], value));
+	} break;
+		
+	case MetaObject::GateMethod::FieldAccess:
+		RESULT(MetaField::Access) = BUILDER_ACCESS(fields, index, MetaField::NoAccess, access);
+		break;
+		
+	case MetaObject::GateMethod::FieldOffset:
+		RESULT(int) = BUILDER_ACCESS(fields, index, -1, offset);
+		break;
+		
+	case MetaObject::GateMethod::FieldReadInto:
+	case MetaObject::GateMethod::FieldWriteFrom:
+		RESULT(bool) = false; // MetaField falls back to read() and write()
+		break;
+		
+	case MetaObject::GateMethod::EnumName:
+		RESULT(QByteArray) = BOUNDS_CHECK(builder.enums, index) ? (builder.enums.constBegin () + index).key () : QByteArray ();
+		break;
+		
+	case MetaObject::GateMethod::EnumElementCount:
+		RESULT(int) = BUILDER_ACCESS(enums, index, 0, elements.size ());
+		break;
+		
+	case MetaObject::GateMethod::EnumElementKey: {
+		const QMap< QByteArray, int > &elements = BUILDER_ACCESS(enums, index, QMap< QByteArray, int > (), elements);
+		RESULT(QByteArray) = BOUNDS_CHECK(elements, nth) ? (elements.constBegin () + nth).key () : QByteArray ();
+	} break;
+		
+	case MetaObject::GateMethod::EnumElementValue: {
+		const QMap< QByteArray, int > &elements = BUILDER_ACCESS(enums, index, QMap< QByteArray, int > (), elements);
+		RESULT(int) = BOUNDS_CHECK(elements, nth) ? *(elements.constBegin () + nth) : 0;
+	} break;
+		
+	default:
+		return false;
+	}
+	
+	return true;
+}
+
 void Nuria::RuntimeMetaObject::gateCall (GateMethod method, int category, int index, int nth,
 					 void *result, void *additional) {
+	
+	// The type itself is set up front. Answer these without touching the
+	// elements, which may be populated concurrently (See QtMetaObjectWrapper).
 	switch (method) {
 	case Nuria::MetaObject::GateMethod::ClassName:
 		RESULT(QByteArray) = this->d->className;
-		break;
+		return;
 		
 	case Nuria::MetaObject::GateMethod::MetaTypeId:
 		RESULT(int) = this->d->valueTypeId;
-		break;
+		return;
 		
 	case Nuria::MetaObject::GateMethod::PointerMetaTypeId:
 		RESULT(int) = this->d->poinerTypeId;
-		break;
+		return;
 		
 	case Nuria::MetaObject::GateMethod::BaseClasses:
 		RESULT(QVector< QByteArray >) = this->d->bases;
-		break;
+		return;
+		
+	case Nuria::MetaObject::GateMethod::DestroyInstance:
+		this->d->deleter (additional);
+		return;
 		
+	default:
+		break;
+	}
+	
+	if (this->d->builder &&
+	    builderGateCall (*this->d->builder, method, category, index, nth, result, additional)) {
+		return;
+	}
+	
+	switch (method) {
 	case Nuria::MetaObject::GateMethod::AnnotationCount:
 		RESULT(int) = runtimeAnnotationCount (category, index);
 		break;
 		
 	case Nuria::MetaObject::GateMethod::MethodCount:
-		RESULT(int) = this->d->methods.size ();
+		RESULT(int) = this->d->layout.methodNames.size ();
 		break;
 		
 	case Nuria::MetaObject::GateMethod::FieldCount:
-		RESULT(int) = this->d->fields.size ();
+		RESULT(int) = this->d->layout.fieldNames.size ();
 		break;
 		
 	case Nuria::MetaObject::GateMethod::EnumCount:
-		RESULT(int) = this->d->enums.size ();
+		RESULT(int) = this->d->layout.enumNames.size ();
 		break;
 		
 	case Nuria::MetaObject::GateMethod::AnnotationName:
@@ -266,6 +959,10 @@ void Nuria::RuntimeMetaObject::gateCall (GateMethod method, int category, int in
 		RESULT(Nuria::Callback) = runtimeMethodArgumentTest (additional, index);
 		break;
 		
+	case Nuria::MetaObject::GateMethod::MethodInvoker:
+		RESULT(Nuria::Callback) = runtimeMethodInvoker (index);
+		break;
+		
 	case Nuria::MetaObject::GateMethod::FieldName:
 		RESULT(QByteArray) = runtimeFieldName (index);
 		break;
@@ -288,6 +985,22 @@ void Nuria::RuntimeMetaObject::gateCall (GateMethod method, int category, int in
 		RESULT(Nuria::MetaField::Access) = runtimeFieldAccess (index);
 		break;
 		
+	case Nuria::MetaObject::GateMethod::FieldReadInto: {
+		void **argData = reinterpret_cast< void ** > (additional);
+		int typeId = *reinterpret_cast< int * > (argData[2]);
+		RESULT(bool) = runtimeFieldReadInto (index, argData[0], argData[1], typeId);
+	} break;
+		
+	case Nuria::MetaObject::GateMethod::FieldWriteFrom: {
+		void **argData = reinterpret_cast< void ** > (additional);
+		int typeId = *reinterpret_cast< int * > (argData[2]);
+		RESULT(bool) = runtimeFieldWriteFrom (index, argData[0], argData[1], typeId);
+	} break;
+		
+	case Nuria::MetaObject::GateMethod::FieldOffset:
+		RESULT(int) = runtimeFieldOffset (index);
+		break;
+		
 	case Nuria::MetaObject::GateMethod::EnumName:
 		RESULT(QByteArray) = runtimeEnumName (index);
 		break;
@@ -304,202 +1017,200 @@ void Nuria::RuntimeMetaObject::gateCall (GateMethod method, int category, int in
 		RESULT(int) = runtimeEnumElementValue (index, nth);
 		break;
 		
-	case Nuria::MetaObject::GateMethod::DestroyInstance:
-		this->d->deleter (additional);
+	default:
 		break;
-		
 	}
 	
 }
 
-// Helper macros. Accessors for methods, fields and enums with out-of-bounds
-// check.
-#define BOUNDS_CHECK(Container, Index) (Index >= 0 && Index < Container.size ())
-#define METHOD_ACCESS(Index, OnFail, OnSuccess) \
-	if (Index < 0 || index >= this->d->methods.size ()) { \
-	return OnFail; \
-	} \
-	return this->d->methods.at (Index).OnSuccess
-
-#define GENERIC_ACCESS(Map, Index, OnFail, OnSuccess) \
-	if (Index < 0 || index >= this->d->Map.size ()) { \
-		return OnFail; \
-	} \
-	return (this->d->Map.constBegin () + Index)->OnSuccess
-
-int Nuria::RuntimeMetaObject::runtimeAnnotationCount (int category, int index) {
+// Returns the annotation block of the element 'index' in 'category'.
+static const AnnotationBlock &annotationBlock (const FrozenLayout &layout, int category, int index) {
+	int block = 0;
 	switch (Categories (category)) {
 	case ObjectCategory:
-		return this->d->annotations.size ();
+		block = layout.objectAnnotations;
+		break;
 	case MethodCategory:
-		METHOD_ACCESS(index, 0, annotations.size ());
+		block = BOUNDS_CHECK(layout.methodAnnotations, index) ? layout.methodAnnotations.at (index) : 0;
+		break;
 	case FieldCategory:
-		GENERIC_ACCESS(fields, index, 0, annotations.size ());
+		block = BOUNDS_CHECK(layout.fieldAnnotations, index) ? layout.fieldAnnotations.at (index) : 0;
+		break;
 	case EnumCategory:
-		GENERIC_ACCESS(enums, index, 0, annotations.size ());
+		block = BOUNDS_CHECK(layout.enumAnnotations, index) ? layout.enumAnnotations.at (index) : 0;
+		break;
 	}
 	
-	return 0;
+	return layout.annotationBlocks.at (block);
+}
+
+int Nuria::RuntimeMetaObject::runtimeAnnotationCount (int category, int index) {
+	const AnnotationBlock &block = annotationBlock (this->d->layout, category, index);
+	return block.end - block.begin;
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeAnnotationName (int category, int index, int nth) {
-	switch (Categories (category)) {
-	case ObjectCategory:
-		return BOUNDS_CHECK(this->d->annotations, nth)
-				? (this->d->annotations.constBegin () + nth).key ()
-				: QByteArray ();
-	case MethodCategory:
-		if (BOUNDS_CHECK(this->d->methods, index)) {
-			const MethodData &cur = this->d->methods.at (index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return (cur.annotations.constBegin () + nth).key ();
-			}
-			
-		}
-		break;
-	case FieldCategory:
-		if (BOUNDS_CHECK(this->d->fields, index)) {
-			const FieldData &cur = *(this->d->fields.constBegin () + index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return (cur.annotations.constBegin () + nth).key ();
-			}
-			
-		}
-		break;
-	case EnumCategory:
-		if (BOUNDS_CHECK(this->d->enums, index)) {
-			const EnumData &cur = *(this->d->enums.constBegin () + index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return (cur.annotations.constBegin () + nth).key ();
-			}
-			
-		}
-		break;
+	const AnnotationBlock &block = annotationBlock (this->d->layout, category, index);
+	if (nth < 0 || nth >= block.end - block.begin) {
+		return QByteArray ();
 	}
 	
-	return QByteArray ();
+	return this->d->layout.annotationKeys.at (block.begin + nth);
 }
 
 QVariant Nuria::RuntimeMetaObject::runtimeAnnotationValue (int category, int index, int nth) {
-	switch (Categories (category)) {
-	case ObjectCategory:
-		return BOUNDS_CHECK(this->d->annotations, nth)
-				? *(this->d->annotations.constBegin () + nth)
-				: QVariant ();
-	case MethodCategory:
-		if (BOUNDS_CHECK(this->d->methods, index)) {
-			const MethodData &cur = this->d->methods.at (index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return *(cur.annotations.constBegin () + nth);
-			}
-			
-		}
-		break;
-	case FieldCategory:
-		if (BOUNDS_CHECK(this->d->fields, index)) {
-			const FieldData &cur = *(this->d->fields.constBegin () + index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return *(cur.annotations.constBegin () + nth);
-			}
-			
-		}
-		break;
-	case EnumCategory:
-		if (BOUNDS_CHECK(this->d->enums, index)) {
-			const EnumData &cur = *(this->d->enums.constBegin () + index);
-			if (BOUNDS_CHECK(cur.annotations, nth)) {
-				return *(cur.annotations.constBegin () + nth);
-			}
-			
-		}
-		break;
+	const AnnotationBlock &block = annotationBlock (this->d->layout, category, index);
+	if (nth < 0 || nth >= block.end - block.begin) {
+		return QVariant ();
 	}
 	
-	return QVariant ();
+	return this->d->layout.annotationValues.at (block.begin + nth);
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeMethodName (int index) {
-	METHOD_ACCESS(index, QByteArray (), name);
+	LAYOUT_ACCESS(methodNames, index, QByteArray ());
 }
 
 Nuria::MetaMethod::Type Nuria::RuntimeMetaObject::runtimeMethodType (int index) {
-	METHOD_ACCESS(index, MetaMethod::Method, type);
+	LAYOUT_ACCESS(methodTypes, index, MetaMethod::Method);
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeMethodReturnType (int index) {
-	METHOD_ACCESS(index, QByteArray (), returnType);
+	LAYOUT_ACCESS(methodReturnTypes, index, QByteArray ());
 }
 
 QVector< QByteArray > Nuria::RuntimeMetaObject::runtimeMethodArgumentNames (int index) {
-	METHOD_ACCESS(index, QVector< QByteArray > (), argNames);
+	if (!BOUNDS_CHECK(this->d->layout.methodArgumentNames, index)) {
+		return QVector< QByteArray > ();
+	}
+	
+	return this->d->layout.argumentLists.at (this->d->layout.methodArgumentNames.at (index));
 }
 
 QVector< QByteArray > Nuria::RuntimeMetaObject::runtimeMethodArgumentTypes (int index) {
-	METHOD_ACCESS(index, QVector< QByteArray > (), argTypes);
+	if (!BOUNDS_CHECK(this->d->layout.methodArgumentTypes, index)) {
+		return QVector< QByteArray > ();
+	}
+	
+	return this->d->layout.argumentLists.at (this->d->layout.methodArgumentTypes.at (index));
+}
+
+Nuria::Callback Nuria::RuntimeMetaObject::createCallback (void *instance, int index, InvokeAction action) {
+	if (!BOUNDS_CHECK(this->d->layout.methodCreators, index)) {
+		return Callback ();
+	}
+	
+	return this->d->layout.methodCreators.at (index) (instance, action);
 }
 
 Nuria::Callback Nuria::RuntimeMetaObject::runtimeMethodCallback (void *instance, int index) {
-	METHOD_ACCESS(index, Callback (), creator (instance, InvokeAction::Invoke));
+	return createCallback (instance, index, InvokeAction::Invoke);
 }
 
 Nuria::Callback Nuria::RuntimeMetaObject::runtimeMethodUnsafeCallback (void *instance, int index) {
-	METHOD_ACCESS(index, Callback (), creator (instance, InvokeAction::UnsafeInvoke));
+	return createCallback (instance, index, InvokeAction::UnsafeInvoke);
 }
 
 Nuria::Callback Nuria::RuntimeMetaObject::runtimeMethodArgumentTest (void *instance, int index) {
-	METHOD_ACCESS(index, Callback (), creator (instance, InvokeAction::ArgumentTest));
+	return createCallback (instance, index, InvokeAction::ArgumentTest);
+}
+
+Nuria::Callback Nuria::RuntimeMetaObject::runtimeMethodInvoker (int index) {
+	LAYOUT_ACCESS(methodInvokers, index, Callback ());
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeFieldName (int index) {
-	return BOUNDS_CHECK(this->d->fields, index)
-			? (this->d->fields.constBegin () + index).key ()
-			: QByteArray ();
+	LAYOUT_ACCESS(fieldNames, index, QByteArray ());
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeFieldType (int index) {
-	GENERIC_ACCESS(fields, index, QByteArray (), valueType);
+	LAYOUT_ACCESS(fieldTypes, index, QByteArray ());
 }
 
 QVariant Nuria::RuntimeMetaObject::runtimeFieldRead (int index, void *instance) {
-	GENERIC_ACCESS(fields, index, QVariant (), getter (instance));
+	if (!BOUNDS_CHECK(this->d->layout.fieldGetters, index)) {
+		return QVariant ();
+	}
+	
+	return this->d->layout.fieldGetters.at (index) (instance);
 }
 
 bool Nuria::RuntimeMetaObject::runtimeFieldWrite (int index, void *instance, const QVariant &value) {
-	GENERIC_ACCESS(fields, index, false, setter (instance, value));
+	if (!BOUNDS_CHECK(this->d->layout.fieldSetters, index)) {
+		return false;
+	}
+	
+	return this->d->layout.fieldSetters.at (index) (instance, value);
 }
 
 Nuria::MetaField::Access Nuria::RuntimeMetaObject::runtimeFieldAccess (int index) {
-	GENERIC_ACCESS(fields, index, MetaField::NoAccess, access);
+	LAYOUT_ACCESS(fieldAccess, index, MetaField::NoAccess);
+}
+
+int Nuria::RuntimeMetaObject::runtimeFieldOffset (int index) {
+	LAYOUT_ACCESS(fieldOffsets, index, -1);
+}
+
+// Copies 'from' into the already constructed 'to'. If the types differ, only
+// registered converters are used - Everything else is left to the QVariant
+// based fall back of MetaField.
+static bool convertPlainField (int fromType, const void *from, int toType, void *to) {
+	if (fromType == toType) {
+		QMetaType::destruct (toType, to);
+		return (QMetaType::construct (toType, to, from) != nullptr);
+	}
+	
+	if (fromType == QMetaType::UnknownType || !QMetaType::hasRegisteredConverterFunction (fromType, toType)) {
+		return false;
+	}
+	
+	return QMetaType::convert (from, fromType, to, toType);
+}
+
+bool Nuria::RuntimeMetaObject::runtimeFieldReadInto (int index, void *instance, void *out, int typeId) {
+	int offset = runtimeFieldOffset (index);
+	if (offset < 0 || !(runtimeFieldAccess (index) & MetaField::ReadOnly)) {
+		return false;
+	}
+	
+	int fieldType = QMetaType::type (runtimeFieldType (index).constData ());
+	return convertPlainField (fieldType, static_cast< char * > (instance) + offset, typeId, out);
+}
+
+bool Nuria::RuntimeMetaObject::runtimeFieldWriteFrom (int index, void *instance, const void *value, int typeId) {
+	int offset = runtimeFieldOffset (index);
+	if (offset < 0 || !(runtimeFieldAccess (index) & MetaField::WriteOnly)) {
+		return false;
+	}
+	
+	int fieldType = QMetaType::type (runtimeFieldType (index).constData ());
+	return convertPlainField (typeId, value, fieldType, static_cast< char * > (instance) + offset);
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeEnumName (int index) {
-	return BOUNDS_CHECK(this->d->enums, index)
-			? (this->d->enums.constBegin () + index).key ()
-			: QByteArray ();
+	LAYOUT_ACCESS(enumNames, index, QByteArray ());
 }
 
 int Nuria::RuntimeMetaObject::runtimeEnumElementCount (int index) {
-	GENERIC_ACCESS(enums, index, 0, elements.size ());
+	if (!BOUNDS_CHECK(this->d->layout.enumNames, index)) {
+		return 0;
+	}
+	
+	return this->d->layout.enumElements.at (index + 1) - this->d->layout.enumElements.at (index);
 }
 
 QByteArray Nuria::RuntimeMetaObject::runtimeEnumElementKey (int index, int nth) {
-	if (!BOUNDS_CHECK(this->d->enums, index)) {
+	if (nth < 0 || nth >= runtimeEnumElementCount (index)) {
 		return QByteArray ();
 	}
 	
-	const EnumData &cur = *(this->d->enums.constBegin () + index);
-	return BOUNDS_CHECK(cur.elements, nth)
-			? (cur.elements.constBegin () + nth).key ()
-			: QByteArray ();
+	return this->d->layout.enumKeys.at (this->d->layout.enumElements.at (index) + nth);
 }
 
 int Nuria::RuntimeMetaObject::runtimeEnumElementValue (int index, int nth) {
-	if (!BOUNDS_CHECK(this->d->enums, index)) {
+	if (nth < 0 || nth >= runtimeEnumElementCount (index)) {
 		return 0;
 	}
 	
-	const EnumData &cur = *(this->d->enums.constBegin () + index);
-	return BOUNDS_CHECK(cur.elements, nth)
-			? *(cur.elements.constBegin () + nth)
-			: 0;
+	return this->d->layout.enumValues.at (this->d->layout.enumElements.at (index) + nth);
 }
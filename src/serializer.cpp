@@ -15,13 +15,47 @@
  */
 
 #include "nuria/serializer.hpp"
+#include "nuria/structuredwriter.hpp"
+#include "nuria/jsontokenreader.hpp"
 #include "nuria/variant.hpp"
 #include <QVector>
+#include <QHash>
 
 namespace Nuria {
+
+// Field of a SerializerPlan, with everything (de-)serialization needs to know
+// about it resolved up-front.
+struct SerializerField {
+	int index; // In the MetaObject
+	QByteArray name;
+	QString key; // In the QVariantMap
+	QByteArray typeName; // Without trailing '*'
+	int typeId; // Of 'typeName'
+	int pointerId; // Of 'typeName*' if the field is a pointer, else 0
+	bool isPointer;
+	bool allowed; // Serialized as-is
+	MetaObject *meta; // Of the field type, or nullptr
+};
+
+// The fields of a MetaObject which are not excluded.
+struct SerializerPlan {
+	QVector< SerializerField > fields;
+	QHash< QString, int > keys; // Index into 'fields'
+	bool needsData; // Has constructors taking arguments
+};
+
 class SerializerPrivate {
 public:
 	
+	~SerializerPrivate () {
+		clearPlans ();
+	}
+	
+	void clearPlans () {
+		qDeleteAll (plans);
+		plans.clear ();
+	}
+	
 	Serializer::InstanceCreator factory;
 	Serializer::MetaObjectFinder finder;
 	Serializer::ValueConverter converter;
@@ -33,6 +67,9 @@ public:
 	
 	int curDepth = 0;
 	
+	// Plans per MetaObject for the current configuration
+	QHash< MetaObject *, SerializerPlan * > plans;
+	
 };
 
 }
@@ -59,6 +96,7 @@ QVector< QByteArray > Nuria::Serializer::exclude () const {
 void Nuria::Serializer::setExclude (const QVector< QByteArray > &list) {
 	this->d->excluded = list;
 	std::sort (this->d->excluded.begin (), this->d->excluded.end ());
+	this->d->clearPlans ();
 }
 
 QVector< QByteArray > Nuria::Serializer::allowedTypes () const {
@@ -67,6 +105,7 @@ QVector< QByteArray > Nuria::Serializer::allowedTypes () const {
 
 void Nuria::Serializer::setAllowedTypes (const QVector< QByteArray > &list) const {
 	this->d->additionalTypes = list;
+	this->d->clearPlans ();
 }
 
 QStringList Nuria::Serializer::failedFields () const {
@@ -106,6 +145,44 @@ void *Nuria::Serializer::deserialize (const QVariantMap &data, const QByteArray
 	return deserialize (data, meta);
 }
 
+void *Nuria::Serializer::deserialize (JsonTokenReader &reader, Nuria::MetaObject *meta) {
+	if (reader.token () != JsonTokenReader::BeginMap && reader.next () != JsonTokenReader::BeginMap) {
+		return nullptr;
+	}
+	
+	// Fall back to reading the whole map if the instance can't be created
+	// without knowing the data.
+	QVariantMap fields;
+	void *instance = nullptr;
+	if (!plan (meta)->needsData) {
+		instance = this->d->factory (meta, fields);
+	}
+	
+	if (!instance) {
+		fields = reader.readValue ().toMap ();
+		return (reader.hasError ()) ? nullptr : deserialize (fields, meta);
+	}
+	
+	// 
+	populate (instance, meta, reader);
+	if (reader.hasError ()) {
+		meta->destroyInstance (instance);
+		return nullptr;
+	}
+	
+	return instance;
+}
+
+void *Nuria::Serializer::deserialize (JsonTokenReader &reader, const QByteArray &typeName) {
+	MetaObject *meta = this->d->finder (typeName);
+	
+	if (!meta) {
+		return nullptr;
+	}
+	
+	return deserialize (reader, meta);
+}
+
 static bool isAllowedType (int id) {
 	switch (id) {
 	case QMetaType::Bool:
@@ -212,17 +289,34 @@ bool Nuria::Serializer::variantToField (QVariant &value, const QByteArray &targe
 	return this->d->converter (value, targetId);
 }
 
-bool Nuria::Serializer::fieldToVariant (QVariant &value, bool &ignore) {
+Nuria::MetaObject *Nuria::Serializer::valueMetaObject (QVariant &value, const SerializerField &field,
+							void *&dataPtr) {
 	QByteArray typeName = QByteArray (value.typeName ());
-	MetaObject *meta = this->d->finder (typeName);
+	
+	// Use the MetaObject found by the plan if the value is of the field type
+	int valueTypeId = (field.isPointer) ? field.pointerId : field.typeId;
+	MetaObject *meta = field.meta;
+	if (!meta || value.userType () != valueTypeId) {
+		meta = this->d->finder (typeName);
+	}
 	
 	if (meta) {
-		void *dataPtr = value.data ();
+		dataPtr = value.data ();
 		
 		if (typeName.endsWith ('*')) {
 			dataPtr = *reinterpret_cast< void ** > (dataPtr);
 		}
 		
+	}
+	
+	return meta;
+}
+
+bool Nuria::Serializer::fieldToVariant (QVariant &value, const SerializerField &field, bool &ignore) {
+	void *dataPtr = nullptr;
+	MetaObject *meta = valueMetaObject (value, field, dataPtr);
+	
+	if (meta) {
 		if (this->d->curDepth == 1) {
 			ignore = true;
 			return false;
@@ -236,55 +330,95 @@ bool Nuria::Serializer::fieldToVariant (QVariant &value, bool &ignore) {
 	return this->d->converter (value, QMetaType::QString);
 }
 
-bool Nuria::Serializer::readField (void *object, Nuria::MetaField &field, QVariantMap &data) {
-	QVariant value = field.read (object);
-	QString name = QString::fromLatin1 (field.name ());
+bool Nuria::Serializer::readField (void *object, MetaObject *meta, const SerializerField &field,
+				   QVariantMap &data) {
+	QVariant value = meta->field (field.index).read (object);
 	
-	if (isAllowedType (value.userType ()) ||
-	    this->d->additionalTypes.contains (field.typeName ())) {
-		data.insert (name, value);
+	if (field.allowed || isAllowedType (value.userType ())) {
+		data.insert (field.key, value);
 		return true;
 	}
 	
 	bool ignore = false;
-	if (!fieldToVariant (value, ignore)) {
+	if (!fieldToVariant (value, field, ignore)) {
 		return ignore;
 	}
 	
-	data.insert (name, value);
+	data.insert (field.key, value);
 	return true;
 }
 
-bool Nuria::Serializer::writeField (void *object, Nuria::MetaField &field, const QVariantMap &data) {
-	QVariant value = data.value (QString::fromLatin1 (field.name ()));
-	QByteArray typeName = field.typeName ();
-	bool isPointer = typeName.endsWith ('*');
+bool Nuria::Serializer::writeField (void *object, MetaObject *meta, const SerializerField &field,
+				    const QVariantMap &data) {
+	QVariant value = data.value (field.key);
+	return writeValue (object, meta, field, value);
+}
+
+bool Nuria::Serializer::writeField (void *object, MetaObject *meta, const SerializerField &field,
+				    JsonTokenReader &reader) {
+	JsonTokenReader::Token token = reader.token ();
+	
+	// Populate objects in-place if possible
+	if (token == JsonTokenReader::BeginMap && field.typeId != QMetaType::QVariantMap &&
+	    field.typeId != QMetaType::QVariant) {
+		if (this->d->curDepth == 1) {
+			reader.skipValue ();
+			return true;
+		}
+		
+		// The instance can only be stored if its type is known to Qt.
+		MetaObject *fieldMeta = (field.meta) ? field.meta : this->d->finder (field.typeName);
+		bool storable = (field.typeId != QMetaType::UnknownType && (!field.isPointer || field.pointerId));
+		void *instance = nullptr;
+		
+		if (storable && fieldMeta && !plan (fieldMeta)->needsData) {
+			QVariantMap empty;
+			instance = this->d->factory (fieldMeta, empty);
+		}
+		
+		if (instance) {
+			if (!populateImpl (instance, fieldMeta, reader)) {
+				fieldMeta->destroyInstance (instance);
+				return false;
+			}
+			
+			QVariant value;
+			putObjectIntoVariant (value, instance, field.typeId, field.pointerId);
+			return meta->field (field.index).write (object, value);
+		}
+		
+	}
+	
+	// Read plain values, lists and maps which can't be populated in-place
+	QVariant value = reader.readValue ();
+	if (reader.hasError ()) {
+		return false;
+	}
+	
+	return writeValue (object, meta, field, value);
+}
+
+bool Nuria::Serializer::writeValue (void *object, MetaObject *meta, const SerializerField &field,
+				    QVariant &value) {
 	int sourceId = value.userType ();
 	bool ignored = false;
-	int pointerId = 0;
 	
 	if (!value.isValid ()) {
 		return true;
 	}
 	
-	if (isPointer) {
-		pointerId = QMetaType::type (typeName.constData ());
-		typeName.chop (1);
-		
-		// Ignore the field if it's a pointer type and the value is 'invalid'.
-		if (!value.isValid () || sourceId == pointerId) {
-			return field.write (object, value);
-		}
-		
+	MetaField metaField = meta->field (field.index);
+	if (field.isPointer && sourceId == field.pointerId) {
+		return metaField.write (object, value);
 	}
 	
-	int targetId = QMetaType::type (typeName.constData ());
+	int targetId = field.typeId;
 	if (sourceId == QMetaType::UnknownType || targetId == QMetaType::UnknownType) {
 		return false;
 	}
 	
 	if (sourceId != targetId && targetId != QMetaType::QVariant) {
-		if (!variantToField (value, typeName, targetId, sourceId, pointerId, ignored)) {
+		if (!variantToField (value, field.typeName, targetId, sourceId, field.pointerId, ignored)) {
 			return ignored;
 		}
 		
@@ -292,8 +426,8 @@ bool Nuria::Serializer::writeField (void *object, Nuria::MetaField &field, const
 		sourceId = targetId;
 	}
 	
-	if ((isPointer && value.isValid ()) || sourceId == targetId || targetId == QMetaType::QVariant) {
-		return field.write (object, value);
+	if ((field.isPointer && value.isValid ()) || sourceId == targetId || targetId == QMetaType::QVariant) {
+		return metaField.write (object, value);
 	}
 	
 	// 
@@ -301,6 +435,48 @@ bool Nuria::Serializer::writeField (void *object, Nuria::MetaField &field, const
 	
 }
 
+const Nuria::SerializerPlan *Nuria::Serializer::plan (MetaObject *meta) {
+	SerializerPlan *&plan = this->d->plans[meta];
+	if (plan) {
+		return plan;
+	}
+	
+	// Constructors are sorted by argument count
+	int lastCtor = meta->methodUpperBound (QByteArray ());
+	plan = new SerializerPlan;
+	plan->needsData = (lastCtor != -1 && !meta->method (lastCtor).argumentNames ().isEmpty ());
+	
+	// Resolve all fields which aren't excluded
+	int count = meta->fieldCount ();
+	plan->fields.reserve (count);
+	
+	for (int i = 0; i < count; i++) {
+		MetaField metaField = meta->field (i);
+		SerializerField field;
+		field.index = i;
+		field.name = metaField.name ();
+		
+		if (std::binary_search (this->d->excluded.constBegin (),
+					this->d->excluded.constEnd (), field.name)) {
+			continue;
+		}
+		
+		QByteArray typeName = metaField.typeName ();
+		field.key = QString::fromLatin1 (field.name);
+		field.isPointer = typeName.endsWith ('*');
+		field.pointerId = (field.isPointer) ? QMetaType::type (typeName.constData ()) : 0;
+		field.typeName = (field.isPointer) ? typeName.left (typeName.length () - 1) : typeName;
+		field.typeId = QMetaType::type (field.typeName.constData ());
+		field.allowed = isAllowedType (field.isPointer ? field.pointerId : field.typeId) ||
+		                this->d->additionalTypes.contains (typeName);
+		field.meta = (field.allowed) ? nullptr : this->d->finder (typeName);
+		plan->keys.insert (field.key, plan->fields.length ());
+		plan->fields.append (field);
+	}
+	
+	return plan;
+}
+
 bool Nuria::Serializer::populate (void *object, Nuria::MetaObject *meta, const QVariantMap &data) {
 	this->d->failed.clear ();
 	this->d->curDepth = this->d->maxDepth + 2;
@@ -318,22 +494,69 @@ bool Nuria::Serializer::populateImpl (void *object, Nuria::MetaObject *meta, con
 	}
 	
 	// 
-	int fields = meta->fieldCount ();
-	for (int i = 0; i < fields; i++) {
-		MetaField field = meta->field (i);
+	const SerializerPlan *fields = plan (meta);
+	for (const SerializerField &field : fields->fields) {
+		if (!writeField (object, meta, field, data)) {
+			this->d->failed.append (field.name);
+		}
+		
+	}
+	
+	this->d->curDepth++;
+	return (this->d->failed.length () == failedCount);
+}
+
+bool Nuria::Serializer::populate (void *object, Nuria::MetaObject *meta, JsonTokenReader &reader) {
+	this->d->failed.clear ();
+	this->d->curDepth = this->d->maxDepth + 2;
+	
+	if (reader.token () != JsonTokenReader::BeginMap && reader.next () != JsonTokenReader::BeginMap) {
+		return false;
+	}
+	
+	return populateImpl (object, meta, reader);
+}
+
+bool Nuria::Serializer::populate (void *object, const QByteArray &typeName, JsonTokenReader &reader) {
+	MetaObject *meta = this->d->finder (typeName);
+	
+	if (!meta) {
+		return false;
+	}
+	
+	return populate (object, meta, reader);
+}
+
+bool Nuria::Serializer::populateImpl (void *object, Nuria::MetaObject *meta, JsonTokenReader &reader) {
+	this->d->curDepth--;
+	int failedCount = this->d->failed.length ();
+	
+	if (!this->d->curDepth) {
+		this->d->curDepth++;
+		reader.skipValue ();
+		return false;
+	}
+	
+	// Write each value into its field as it is read
+	const SerializerPlan *fields = plan (meta);
+	while (reader.next () == JsonTokenReader::Key) {
+		auto it = fields->keys.constFind (reader.string ());
+		reader.next ();
 		
-		bool ignore = std::binary_search (this->d->excluded.constBegin (),
-						  this->d->excluded.constEnd (),
-						  field.name ());
+		if (it == fields->keys.constEnd ()) {
+			reader.skipValue ();
+			continue;
+		}
 		
-		if (!ignore && !writeField (object, field, data)) {
-			this->d->failed.append (field.name ());
+		const SerializerField &field = fields->fields.at (*it);
+		if (!writeField (object, meta, field, reader)) {
+			this->d->failed.append (field.name);
 		}
 		
 	}
 	
 	this->d->curDepth++;
-	return (this->d->failed.length () == failedCount);
+	return (reader.token () == JsonTokenReader::EndMap && this->d->failed.length () == failedCount);
 }
 
 bool Nuria::Serializer::populate (void *object, const QByteArray &typeName, const QVariantMap &data) {
@@ -363,16 +586,10 @@ QVariantMap Nuria::Serializer::serializeImpl (void *object, Nuria::MetaObject *m
 	}
 	
 	// 
-	int fields = meta->fieldCount ();
-	for (int i = 0; i < fields; i++) {
-		MetaField field = meta->field (i);
-		
-		bool ignore = std::binary_search (this->d->excluded.constBegin (),
-						  this->d->excluded.constEnd (),
-						  field.name ());
-		
-		if (!ignore && !readField (object, field, map)) {
-			this->d->failed.append (field.name ());
+	const SerializerPlan *fields = plan (meta);
+	for (const SerializerField &field : fields->fields) {
+		if (!readField (object, meta, field, map)) {
+			this->d->failed.append (field.name);
 		}
 		
 	}
@@ -392,6 +609,76 @@ QVariantMap Nuria::Serializer::serialize (void *object, const QByteArray &typeNa
 	return serialize (object, meta);
 }
 
+bool Nuria::Serializer::serialize (void *object, Nuria::MetaObject *meta, StructuredWriter &writer) {
+	this->d->failed.clear ();
+	this->d->curDepth = this->d->maxDepth + 2;
+	
+	serializeImpl (object, meta, writer);
+	return this->d->failed.isEmpty ();
+}
+
+bool Nuria::Serializer::serialize (void *object, const QByteArray &typeName, StructuredWriter &writer) {
+	MetaObject *meta = this->d->finder (typeName);
+	
+	if (!meta) {
+		return false;
+	}
+	
+	return serialize (object, meta, writer);
+}
+
+void Nuria::Serializer::serializeImpl (void *object, Nuria::MetaObject *meta, StructuredWriter &writer) {
+	writer.beginMap ();
+	this->d->curDepth--;
+	
+	if (this->d->curDepth) {
+		const SerializerPlan *fields = plan (meta);
+		for (const SerializerField &field : fields->fields) {
+			if (!streamField (object, meta, field, writer)) {
+				this->d->failed.append (field.name);
+			}
+			
+		}
+		
+	}
+	
+	this->d->curDepth++;
+	writer.endMap ();
+}
+
+bool Nuria::Serializer::streamField (void *object, MetaObject *meta, const SerializerField &field,
+				     StructuredWriter &writer) {
+	QVariant value = meta->field (field.index).read (object);
+	
+	if (field.allowed || isAllowedType (value.userType ())) {
+		writer.writeKey (field.key);
+		writer.writeVariant (value);
+		return true;
+	}
+	
+	// Recurse into known types
+	void *dataPtr = nullptr;
+	MetaObject *valueMeta = valueMetaObject (value, field, dataPtr);
+	if (valueMeta) {
+		if (this->d->curDepth == 1) {
+			return true;
+		}
+		
+		writer.writeKey (field.key);
+		serializeImpl (dataPtr, valueMeta, writer);
+		return true;
+	}
+	
+	// Convert using the user converter
+	if (!this->d->converter (value, QMetaType::QString)) {
+		return false;
+	}
+	
+	writer.writeKey (field.key);
+	writer.writeVariant (value);
+	return true;
+}
+
 Nuria::MetaObject *Nuria::Serializer::defaultMetaObjectFinder (const QByteArray &typeName) {
 	MetaObject *meta = MetaObject::byName (typeName);
 	
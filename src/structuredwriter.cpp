@@ -0,0 +1,520 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nuria/structuredwriter.hpp"
+
+#include <QStringList>
+#include <QIODevice>
+#include <QtEndian>
+#include <QtNumeric>
+#include <QLocale>
+#include <cstring>
+
+namespace Nuria {
+class StructuredWriterPrivate {
+public:
+	
+	QIODevice *device = nullptr;
+	QByteArray *target = nullptr;
+	QByteArray buffer;
+	bool error = false;
+	
+};
+
+}
+
+// Calls 'func' for each code point in 'string'. Unpaired surrogates are
+// replaced with U+FFFD.
+template< typename Func >
+static void forEachCodePoint (const QString &string, Func func) {
+	const ushort *it = string.utf16 ();
+	const ushort *end = it + string.length ();
+	
+	while (it < end) {
+		uint c = *it++;
+		if (QChar::isHighSurrogate (c) && it < end && QChar::isLowSurrogate (*it)) {
+			c = QChar::surrogateToUcs4 (c, *it++);
+		} else if (QChar::isSurrogate (c)) {
+			c = 0xFFFD;
+		}
+		
+		func (c);
+	}
+	
+}
+
+// Encodes 'c' as UTF-8 into 'out', returning the count of bytes.
+static int encodeUtf8 (uint c, char *out) {
+	if (c < 0x80) {
+		out[0] = char (c);
+		return 1;
+	} else if (c < 0x800) {
+		out[0] = char (0xC0 | (c >> 6));
+		out[1] = char (0x80 | (c & 0x3F));
+		return 2;
+	} else if (c < 0x10000) {
+		out[0] = char (0xE0 | (c >> 12));
+		out[1] = char (0x80 | ((c >> 6) & 0x3F));
+		out[2] = char (0x80 | (c & 0x3F));
+		return 3;
+	}
+	
+	out[0] = char (0xF0 | (c >> 18));
+	out[1] = char (0x80 | ((c >> 12) & 0x3F));
+	out[2] = char (0x80 | ((c >> 6) & 0x3F));
+	out[3] = char (0x80 | (c & 0x3F));
+	return 4;
+}
+
+// Returns the length of 'string' encoded as UTF-8.
+static quint64 utf8Length (const QString &string) {
+	quint64 length = 0;
+	forEachCodePoint (string, [&length](uint c) {
+		length += (c < 0x80) ? 1 : (c < 0x800) ? 2 : (c < 0x10000) ? 3 : 4;
+	});
+	
+	return length;
+}
+
+// Writes 'value' in decimal right-aligned into 'buffer' of 'size' bytes.
+// Returns the index of the first digit.
+static int formatUInt (quint64 value, char *buffer, int size) {
+	int i = size;
+	do {
+		buffer[--i] = char ('0' + value % 10);
+		value /= 10;
+	} while (value);
+	
+	return i;
+}
+
+Nuria::StructuredWriter::StructuredWriter (QIODevice *device)
+	: d_ptr (new StructuredWriterPrivate)
+{
+	
+	this->d_ptr->device = device;
+	this->d_ptr->buffer.reserve (BufferSize);
+	
+}
+
+Nuria::StructuredWriter::StructuredWriter (QByteArray *buffer)
+	: d_ptr (new StructuredWriterPrivate)
+{
+	
+	this->d_ptr->target = buffer;
+	
+}
+
+Nuria::StructuredWriter::~StructuredWriter () {
+	flush ();
+	delete this->d_ptr;
+}
+
+bool Nuria::StructuredWriter::flush () {
+	if (!this->d_ptr->device || this->d_ptr->buffer.isEmpty ()) {
+		return !this->d_ptr->error;
+	}
+	
+	qint64 written = this->d_ptr->device->write (this->d_ptr->buffer);
+	if (written != this->d_ptr->buffer.length ()) {
+		this->d_ptr->error = true;
+	}
+	
+	this->d_ptr->buffer.resize (0);
+	return !this->d_ptr->error;
+}
+
+bool Nuria::StructuredWriter::hasError () const {
+	return this->d_ptr->error;
+}
+
+void Nuria::StructuredWriter::writeVariant (const QVariant &value) {
+	switch (value.userType ()) {
+	case QMetaType::UnknownType:
+		writeNull ();
+		break;
+	case QMetaType::Bool:
+		writeBool (value.toBool ());
+		break;
+	case QMetaType::Char:
+	case QMetaType::SChar:
+	case QMetaType::Short:
+	case QMetaType::Int:
+	case QMetaType::Long:
+	case QMetaType::LongLong:
+		writeInt (value.toLongLong ());
+		break;
+	case QMetaType::UChar:
+	case QMetaType::UShort:
+	case QMetaType::UInt:
+	case QMetaType::ULong:
+	case QMetaType::ULongLong:
+		writeUInt (value.toULongLong ());
+		break;
+	case QMetaType::Float:
+	case QMetaType::Double:
+		writeDouble (value.toDouble ());
+		break;
+	case QMetaType::QString:
+		writeString (value.toString ());
+		break;
+	case QMetaType::QByteArray:
+		writeBytes (value.toByteArray ());
+		break;
+	case QMetaType::QStringList: {
+		const QStringList list = value.toStringList ();
+		beginList ();
+		for (const QString &cur : list) {
+			writeString (cur);
+		}
+		
+		endList ();
+	} break;
+	case QMetaType::QVariantList: {
+		const QVariantList list = value.toList ();
+		beginList ();
+		for (const QVariant &cur : list) {
+			writeVariant (cur);
+		}
+		
+		endList ();
+	} break;
+	case QMetaType::QVariantMap: {
+		const QVariantMap map = value.toMap ();
+		beginMap ();
+		for (auto it = map.constBegin (), end = map.constEnd (); it != end; ++it) {
+			writeKey (it.key ());
+			writeVariant (*it);
+		}
+		
+		endMap ();
+	} break;
+	case QMetaType::QVariantHash: {
+		const QVariantHash hash = value.toHash ();
+		beginMap ();
+		for (auto it = hash.constBegin (), end = hash.constEnd (); it != end; ++it) {
+			writeKey (it.key ());
+			writeVariant (*it);
+		}
+		
+		endMap ();
+	} break;
+	default:
+		if (value.canConvert< QString > ()) {
+			writeString (value.toString ());
+		} else {
+			writeNull ();
+		}
+		
+	}
+	
+}
+
+void Nuria::StructuredWriter::write (const char *data, int length) {
+	if (this->d_ptr->target) {
+		this->d_ptr->target->append (data, length);
+		return;
+	}
+	
+	// Write big chunks directly
+	if (this->d_ptr->buffer.length () + length > BufferSize) {
+		flush ();
+		
+		if (length >= BufferSize) {
+			if (this->d_ptr->device->write (data, length) != length) {
+				this->d_ptr->error = true;
+			}
+			
+			return;
+		}
+		
+	}
+	
+	this->d_ptr->buffer.append (data, length);
+}
+
+void Nuria::StructuredWriter::write (char byte) {
+	if (this->d_ptr->target) {
+		this->d_ptr->target->append (byte);
+		return;
+	}
+	
+	if (this->d_ptr->buffer.length () >= BufferSize) {
+		flush ();
+	}
+	
+	this->d_ptr->buffer.append (byte);
+}
+
+Nuria::JsonWriter::JsonWriter (QIODevice *device)
+	: StructuredWriter (device)
+{
+
+}
+
+Nuria::JsonWriter::JsonWriter (QByteArray *buffer)
+	: StructuredWriter (buffer)
+{
+
+}
+
+void Nuria::JsonWriter::beginMap () {
+	beginValue ();
+	write ('{');
+	this->m_needComma = false;
+}
+
+void Nuria::JsonWriter::endMap () {
+	write ('}');
+	this->m_needComma = true;
+}
+
+void Nuria::JsonWriter::beginList () {
+	beginValue ();
+	write ('[');
+	this->m_needComma = false;
+}
+
+void Nuria::JsonWriter::endList () {
+	write (']');
+	this->m_needComma = true;
+}
+
+void Nuria::JsonWriter::writeKey (const QString &key) {
+	beginValue ();
+	writeQuoted (key);
+	write (':');
+	this->m_needComma = false;
+}
+
+void Nuria::JsonWriter::writeNull () {
+	beginValue ();
+	write ("null", 4);
+}
+
+void Nuria::JsonWriter::writeBool (bool value) {
+	beginValue ();
+	
+	if (value) {
+		write ("true", 4);
+	} else {
+		write ("false", 5);
+	}
+	
+}
+
+void Nuria::JsonWriter::writeInt (qint64 value) {
+	char buffer[24];
+	quint64 absolute = (value < 0) ? 0 - quint64 (value) : quint64 (value);
+	int begin = formatUInt (absolute, buffer, sizeof(buffer));
+	
+	if (value < 0) {
+		buffer[--begin] = '-';
+	}
+	
+	beginValue ();
+	write (buffer + begin, int (sizeof(buffer)) - begin);
+}
+
+void Nuria::JsonWriter::writeUInt (quint64 value) {
+	char buffer[24];
+	int begin = formatUInt (value, buffer, sizeof(buffer));
+	
+	beginValue ();
+	write (buffer + begin, int (sizeof(buffer)) - begin);
+}
+
+void Nuria::JsonWriter::writeDouble (double value) {
+	if (!qIsFinite (value)) {
+		writeNull ();
+		return;
+	}
+	
+	// Integral values are written without exponent
+	if (qAbs (value) < 9007199254740992.0 && value == qint64 (value)) {
+		writeInt (qint64 (value));
+		return;
+	}
+	
+#if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
+	QByteArray number = QByteArray::number (value, 'g', QLocale::FloatingPointShortest);
+#else
+	QByteArray number = QByteArray::number (value, 'g', 17);
+#endif
+	
+	beginValue ();
+	write (number.constData (), number.length ());
+}
+
+void Nuria::JsonWriter::writeString (const QString &value) {
+	beginValue ();
+	writeQuoted (value);
+}
+
+void Nuria::JsonWriter::writeBytes (const QByteArray &value) {
+	beginValue ();
+	writeQuoted (QString::fromUtf8 (value));
+}
+
+void Nuria::JsonWriter::beginValue () {
+	if (this->m_needComma) {
+		write (',');
+	}
+	
+	this->m_needComma = true;
+}
+
+void Nuria::JsonWriter::writeQuoted (const QString &string) {
+	static const char hex[] = "0123456789abcdef";
+	
+	write ('"');
+	forEachCodePoint (string, [this](uint c) {
+		char buffer[6];
+		
+		switch (c) {
+		case '"': write ("\\\"", 2); return;
+		case '\\': write ("\\\\", 2); return;
+		case '\b': write ("\\b", 2); return;
+		case '\f': write ("\\f", 2); return;
+		case '\n': write ("\\n", 2); return;
+		case '\r': write ("\\r", 2); return;
+		case '\t': write ("\\t", 2); return;
+		}
+		
+		if (c < 0x20) {
+			buffer[0] = '\\';
+			buffer[1] = 'u';
+			buffer[2] = '0';
+			buffer[3] = '0';
+			buffer[4] = hex[c >> 4];
+			buffer[5] = hex[c & 0xF];
+			write (buffer, 6);
+		} else if (c < 0x80) {
+			write (char (c));
+		} else {
+			write (buffer, encodeUtf8 (c, buffer));
+		}
+		
+	});
+	
+	write ('"');
+}
+
+Nuria::CborWriter::CborWriter (QIODevice *device)
+	: StructuredWriter (device)
+{
+
+}
+
+Nuria::CborWriter::CborWriter (QByteArray *buffer)
+	: StructuredWriter (buffer)
+{
+
+}
+
+void Nuria::CborWriter::beginMap () {
+	write (char (0xBF));
+}
+
+void Nuria::CborWriter::endMap () {
+	write (char (0xFF));
+}
+
+void Nuria::CborWriter::beginList () {
+	write (char (0x9F));
+}
+
+void Nuria::CborWriter::endList () {
+	write (char (0xFF));
+}
+
+void Nuria::CborWriter::writeKey (const QString &key) {
+	writeString (key);
+}
+
+void Nuria::CborWriter::writeNull () {
+	write (char (0xF6));
+}
+
+void Nuria::CborWriter::writeBool (bool value) {
+	write (char (value ? 0xF5 : 0xF4));
+}
+
+void Nuria::CborWriter::writeInt (qint64 value) {
+	if (value < 0) {
+		writeHead (1, quint64 (-1 - value));
+	} else {
+		writeHead (0, quint64 (value));
+	}
+	
+}
+
+void Nuria::CborWriter::writeUInt (quint64 value) {
+	writeHead (0, value);
+}
+
+void Nuria::CborWriter::writeDouble (double value) {
+	uchar buffer[9];
+	quint64 bits;
+	
+	memcpy (&bits, &value, sizeof(bits));
+	buffer[0] = 0xFB;
+	qToBigEndian (bits, buffer + 1);
+	write (reinterpret_cast< char * > (buffer), 9);
+}
+
+void Nuria::CborWriter::writeString (const QString &value) {
+	writeHead (3, utf8Length (value));
+	forEachCodePoint (value, [this](uint c) {
+		char buffer[4];
+		write (buffer, encodeUtf8 (c, buffer));
+	});
+	
+}
+
+void Nuria::CborWriter::writeBytes (const QByteArray &value) {
+	writeHead (2, quint64 (value.length ()));
+	write (value.constData (), value.length ());
+}
+
+void Nuria::CborWriter::writeHead (int majorType, quint64 value) {
+	uchar buffer[9];
+	uchar type = uchar (majorType << 5);
+	int length = 1;
+	
+	if (value < 24) {
+		buffer[0] = uchar (type | value);
+	} else if (value <= 0xFF) {
+		buffer[0] = type | 24;
+		buffer[1] = uchar (value);
+		length = 2;
+	} else if (value <= 0xFFFF) {
+		buffer[0] = type | 25;
+		qToBigEndian (quint16 (value), buffer + 1);
+		length = 3;
+	} else if (value <= 0xFFFFFFFFULL) {
+		buffer[0] = type | 26;
+		qToBigEndian (quint32 (value), buffer + 1);
+		length = 5;
+	} else {
+		buffer[0] = type | 27;
+		qToBigEndian (value, buffer + 1);
+		length = 9;
+	}
+	
+	write (reinterpret_cast< char * > (buffer), length);
+}
@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <memory>
 
+#include "nuria/callbacklist.hpp"
 #include "nuria/logger.hpp"
 
 // Global for easy access from signal handler
@@ -35,8 +36,12 @@ class UnixSignalHandlerPrivate {
 public:
 	QSocketNotifier *notifier = nullptr;
 	
+	~UnixSignalHandlerPrivate () {
+		qDeleteAll (signalCallbacks);
+	}
+	
 	QMap< int, struct sigaction * > actionHandlers;
-	QMultiMap< int, Callback > signalCallbacks;
+	QMap< int, CallbackList * > signalCallbacks;
 	
 };
 
@@ -88,10 +93,9 @@ bool Nuria::UnixSignalHandler::tryReadUnixSignal () {
 
 void Nuria::UnixSignalHandler::invokeSignalHandlers (int signalId) {
 	
-	auto it = this->d_ptr->signalCallbacks.lowerBound (signalId);
-	auto end = this->d_ptr->signalCallbacks.upperBound (signalId);
-	for (; it != end; ++it) {
-		(*it)(signalId); // Invoke
+	CallbackList *callbacks = this->d_ptr->signalCallbacks.value (signalId);
+	if (callbacks) {
+		(*callbacks)(signalId); // Invoke
 	}
 	
 	// 
@@ -168,7 +172,12 @@ bool Nuria::UnixSignalHandler::isListeningTo (int signalId) {
 
 void Nuria::UnixSignalHandler::invokeOnSignal (int signalId, const Nuria::Callback &callback) {
 	if (listenToUnixSignal (signalId)) {
-		this->d_ptr->signalCallbacks.insert (signalId, callback);
+		CallbackList *&callbacks = this->d_ptr->signalCallbacks[signalId];
+		if (!callbacks) {
+			callbacks = new CallbackList;
+		}
+		
+		callbacks->add (callback);
 	}
 	
 }
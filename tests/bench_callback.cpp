@@ -0,0 +1,95 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nuria/callbacklist.hpp>
+#include <nuria/callback.hpp>
+#include <QObject>
+
+#include "benchmark.hpp"
+
+using namespace Nuria;
+
+static int add (int a, int b) { return a + b; }
+
+class Target : public QObject {
+	Q_OBJECT
+public:
+	int add (int a, int b) { return a + b; }
+	
+public slots:
+	int addSlot (int a, int b) { return a + b; }
+	
+};
+
+int main (int argc, char **argv) {
+	Benchmark bench (argc, argv, "callback");
+	Target target;
+	int a = 1, b = 2;
+	
+	// Baseline
+	int (* volatile func) (int, int) = add;
+	bench.run ("direct", [&] { Benchmark::keep (func (a, b)); });
+	
+	// Callback types
+	Callback staticCb (add);
+	Callback memberCb (&target, &Target::add);
+	Callback lambdaCb = Callback::fromLambda ([](int a, int b) { return a + b; });
+	Callback slotCb (&target, SLOT(addSlot(int,int)));
+	
+	bench.run ("static", [&] { Benchmark::keep (staticCb (a, b)); });
+	bench.run ("member", [&] { Benchmark::keep (memberCb (a, b)); });
+	bench.run ("lambda", [&] { Benchmark::keep (lambdaCb (a, b)); });
+	bench.run ("slot", [&] { Benchmark::keep (slotCb (a, b)); });
+	
+	// Typed calls
+	bench.run ("static.call", [&] { Benchmark::keep (staticCb.call< int > (a, b)); });
+	bench.run ("lambda.call", [&] { Benchmark::keep (lambdaCb.call< int > (a, b)); });
+	
+	// Conversion
+	QString str ("2");
+	QVariantList list { 1, 2 };
+	bench.run ("static.convert", [&] { Benchmark::keep (staticCb (a, str)); });
+	bench.run ("static.list", [&] { Benchmark::keep (staticCb.invoke (list)); });
+	
+	// Bound arguments
+	Callback boundCb = Callback (add).bind (1);
+	Callback placeholderCb = Callback (add).bind (Callback::_2, Callback::_1);
+	
+	bench.run ("bound", [&] { Benchmark::keep (boundCb (b)); });
+	bench.run ("bound.call", [&] { Benchmark::keep (boundCb.call< int > (b)); });
+	bench.run ("placeholder", [&] { Benchmark::keep (placeholderCb (a, b)); });
+	bench.run ("placeholder.call", [&] { Benchmark::keep (placeholderCb.call< int > (a, b)); });
+	
+	// Variadic
+	Callback variadicCb = Callback::fromLambda ([](const QVariantList &args) { return args.length (); }, true);
+	Callback viewCb = Callback::fromLambda ([](const ArgumentView &args) { return args.count (); }, true);
+	
+	bench.run ("variadic", [&] { Benchmark::keep (variadicCb (a, b)); });
+	bench.run ("variadic.list", [&] { Benchmark::keep (variadicCb.invoke (list)); });
+	bench.run ("variadic.view", [&] { Benchmark::keep (viewCb (a, b)); });
+	
+	// Multicast
+	CallbackList callbacks;
+	for (int i = 0; i < 8; i++) {
+		callbacks.add (Callback::fromLambda ([](int a, int b) { return a + b; }));
+	}
+	
+	bench.run ("list.8", [&] { callbacks (a, str); });
+	
+	return bench.finish ();
+}
+
+#include "bench_callback.moc"
@@ -0,0 +1,85 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nuria/runtimemetaobject.hpp>
+
+#include "benchmark.hpp"
+
+using namespace Nuria;
+
+struct BenchType { int value = 0; };
+Q_DECLARE_METATYPE(BenchType)
+Q_DECLARE_METATYPE(BenchType*)
+
+enum { TypeCount = 200, MemberCount = 16 };
+
+static Callback noopCreator (void *, RuntimeMetaObject::InvokeAction) {
+	return Callback ();
+}
+
+static RuntimeMetaObject *createType (const QByteArray &name) {
+	RuntimeMetaObject *meta = new RuntimeMetaObject (name);
+	
+	for (int i = 0; i < MemberCount; i++) {
+		QByteArray member = "member" + QByteArray::number (i);
+		meta->addField (member, "int", { }, [](void *) { return QVariant (0); },
+		                [](void *, const QVariant &) { return true; });
+		meta->addMethod (MetaMethod::Method, member, "int", { "a", "b" }, { "int", "QString" },
+		                 { }, noopCreator);
+	}
+	
+	return meta;
+}
+
+int main (int argc, char **argv) {
+	Benchmark bench (argc, argv, "metaobject");
+	
+	// Populate the registry
+	for (int i = 0; i < TypeCount; i++) {
+		RuntimeMetaObject *meta = createType ("BenchType" + QByteArray::number (i));
+		meta->finalize ();
+		MetaObject::registerMetaObject (meta);
+	}
+	
+	RuntimeMetaObject *typed = createType ("BenchType");
+	typed->setQtMetaTypeId (qMetaTypeId< BenchType > ());
+	typed->setQtMetaTypePointerId (qMetaTypeId< BenchType * > ());
+	typed->finalize ();
+	MetaObject::registerMetaObject (typed);
+	
+	// Registry
+	QByteArray name ("BenchType150");
+	QByteArray unknown ("Unknown");
+	int valueId = qMetaTypeId< BenchType > ();
+	int pointerId = qMetaTypeId< BenchType * > ();
+	
+	bench.run ("byName", [&] { Benchmark::keep (MetaObject::byName (name)); });
+	bench.run ("byName.unknown", [&] { Benchmark::keep (MetaObject::byName (unknown)); });
+	bench.run ("byTypeId.value", [&] { Benchmark::keep (MetaObject::byTypeId (valueId)); });
+	bench.run ("byTypeId.pointer", [&] { Benchmark::keep (MetaObject::byTypeId (pointerId)); });
+	bench.run ("of", [&] { Benchmark::keep (MetaObject::of< BenchType > ()); });
+	
+	// Members
+	MetaObject *meta = MetaObject::byName (name);
+	QByteArray field ("member11");
+	QVector< QByteArray > prototype { "member11", "int", "QString" };
+	
+	bench.run ("fieldByName", [&] { Benchmark::keep (meta->fieldByName (field)); });
+	bench.run ("methodLowerBound", [&] { Benchmark::keep (meta->methodLowerBound (field)); });
+	bench.run ("method.prototype", [&] { Benchmark::keep (meta->method (prototype)); });
+	
+	return bench.finish ();
+}
@@ -0,0 +1,126 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nuria/runtimemetaobject.hpp>
+#include <nuria/structuredwriter.hpp>
+#include <nuria/jsontokenreader.hpp>
+#include <nuria/serializer.hpp>
+#include <QJsonDocument>
+
+#include "benchmark.hpp"
+
+using namespace Nuria;
+
+struct BenchInner {
+	int digit = 0;
+	QString string;
+	double number = 0.0;
+	bool boolean = false;
+};
+
+struct BenchOuter {
+	BenchInner inner;
+	QString name;
+	int id = 0;
+	QStringList tags;
+};
+
+Q_DECLARE_METATYPE(BenchInner)
+Q_DECLARE_METATYPE(BenchInner*)
+Q_DECLARE_METATYPE(BenchOuter)
+Q_DECLARE_METATYPE(BenchOuter*)
+
+#define BENCH_FIELD(Type, Name, FieldType) \
+	meta->addField (#Name, #FieldType, { }, \
+	                [](void *p) { return QVariant::fromValue (static_cast< Type * > (p)->Name); }, \
+	                [](void *p, const QVariant &v) { \
+	                        static_cast< Type * > (p)->Name = v.value< FieldType > (); return true; })
+	
+static void registerTypes () {
+	RuntimeMetaObject *meta = new RuntimeMetaObject ("BenchInner");
+	meta->setQtMetaTypeId (qMetaTypeId< BenchInner > ());
+	meta->setQtMetaTypePointerId (qMetaTypeId< BenchInner * > ());
+	meta->setInstanceDeleter ([](void *p) { delete static_cast< BenchInner * > (p); });
+	BENCH_FIELD(BenchInner, digit, int);
+	BENCH_FIELD(BenchInner, string, QString);
+	BENCH_FIELD(BenchInner, number, double);
+	BENCH_FIELD(BenchInner, boolean, bool);
+	meta->finalize ();
+	MetaObject::registerMetaObject (meta);
+	
+	meta = new RuntimeMetaObject ("BenchOuter");
+	meta->setQtMetaTypeId (qMetaTypeId< BenchOuter > ());
+	meta->setQtMetaTypePointerId (qMetaTypeId< BenchOuter * > ());
+	meta->setInstanceDeleter ([](void *p) { delete static_cast< BenchOuter * > (p); });
+	BENCH_FIELD(BenchOuter, inner, BenchInner);
+	BENCH_FIELD(BenchOuter, name, QString);
+	BENCH_FIELD(BenchOuter, id, int);
+	BENCH_FIELD(BenchOuter, tags, QStringList);
+	meta->finalize ();
+	MetaObject::registerMetaObject (meta);
+}
+
+static void *createInstance (MetaObject *meta, QVariantMap &) {
+	if (meta->className () == "BenchInner") {
+		return new BenchInner;
+	} else if (meta->className () == "BenchOuter") {
+		return new BenchOuter;
+	}
+	
+	return nullptr;
+}
+
+int main (int argc, char **argv) {
+	Benchmark bench (argc, argv, "serializer");
+	registerTypes ();
+	
+	BenchOuter outer;
+	outer.inner.digit = 123;
+	outer.inner.string = "Hello";
+	outer.inner.number = 12.34;
+	outer.inner.boolean = true;
+	outer.name = "Outer";
+	outer.id = 42;
+	outer.tags = QStringList { "a", "b", "c" };
+	
+	Serializer serializer (Serializer::defaultMetaObjectFinder, createInstance);
+	MetaObject *meta = MetaObject::byName ("BenchOuter");
+	QVariantMap data = serializer.serialize (&outer, meta);
+	QByteArray json = QJsonDocument::fromVariant (data).toJson (QJsonDocument::Compact);
+	
+	bench.run ("serialize", [&] { Benchmark::keep (serializer.serialize (&outer, meta)); });
+	bench.run ("serialize.byName", [&] { Benchmark::keep (serializer.serialize (&outer, "BenchOuter")); });
+	bench.run ("serialize.json", [&] {
+		Benchmark::keep (QJsonDocument::fromVariant (serializer.serialize (&outer, meta)).toJson ());
+	});
+	bench.run ("serialize.jsonWriter", [&] {
+		QByteArray json;
+		JsonWriter writer (&json);
+		serializer.serialize (&outer, meta, writer);
+		Benchmark::keep (json);
+	});
+	bench.run ("deserialize", [&] { delete static_cast< BenchOuter * > (serializer.deserialize (data, meta)); });
+	bench.run ("deserialize.json", [&] {
+		QVariantMap map = QJsonDocument::fromJson (json).toVariant ().toMap ();
+		delete static_cast< BenchOuter * > (serializer.deserialize (map, meta));
+	});
+	bench.run ("deserialize.tokenReader", [&] {
+		JsonTokenReader reader (json);
+		delete static_cast< BenchOuter * > (serializer.deserialize (reader, meta));
+	});
+	
+	return bench.finish ();
+}
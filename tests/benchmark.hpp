@@ -0,0 +1,128 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QFile>
+#include <algorithm>
+
+/**
+ * Minimal benchmark harness. Each benchmark is run in batches, whose size is
+ * doubled until a batch takes at least 50ms. The median time per iteration of
+ * five such batches is reported.
+ * 
+ * The results are written as JSON to the file passed as first command-line
+ * argument, or to stdout if none is given:
+ * \code
+ * { "suite": "callback", "qt": "5.4.0",
+ *   "results": [ { "name": "static", "iterations": 1048576, "nsPerIteration": 3.2 } ] }
+ * \endcode
+ */
+class Benchmark {
+public:
+	
+	Benchmark (int &argc, char **argv, const char *suite)
+		: m_app (argc, argv), m_suite (suite)
+	{
+		if (argc > 1) {
+			m_outputFile = QString::fromLocal8Bit (argv[1]);
+		}
+		
+	}
+	
+	/** Keeps the compiler from optimizing \a value away. */
+	template< typename T >
+	static inline void keep (const T &value) {
+		asm volatile ("" : : "g" (&value) : "memory");
+	}
+	
+	/** Measures \a func, which runs one iteration. */
+	template< typename Func >
+	void run (const char *name, Func func) {
+		enum { MinBatchTime = 50 * 1000 * 1000, Samples = 5 };
+		
+		// Find batch size
+		qint64 iterations = 1;
+		while (runBatch (func, iterations) < MinBatchTime && iterations < (Q_INT64_C(1) << 40)) {
+			iterations *= 2;
+		}
+		
+		// Measure
+		double samples[Samples];
+		for (int i = 0; i < Samples; i++) {
+			samples[i] = double (runBatch (func, iterations)) / double (iterations);
+		}
+		
+		std::sort (samples, samples + Samples);
+		
+		QJsonObject result;
+		result.insert ("name", QString::fromLatin1 (name));
+		result.insert ("iterations", double (iterations));
+		result.insert ("nsPerIteration", samples[Samples / 2]);
+		m_results.append (result);
+	}
+	
+	/** Writes the results. Returns the exit code of the benchmark. */
+	int finish () {
+		QJsonObject root;
+		root.insert ("suite", QString::fromLatin1 (m_suite));
+		root.insert ("qt", QString::fromLatin1 (qVersion ()));
+		root.insert ("results", m_results);
+		
+		QByteArray json = QJsonDocument (root).toJson ();
+		if (m_outputFile.isEmpty ()) {
+			QTextStream (stdout) << json;
+			return 0;
+		}
+		
+		QFile file (m_outputFile);
+		if (!file.open (QIODevice::WriteOnly) || file.write (json) != json.length ()) {
+			QTextStream (stderr) << "Failed to write " << m_outputFile << "\n";
+			return 1;
+		}
+		
+		return 0;
+	}
+	
+private:
+	
+	template< typename Func >
+	qint64 runBatch (Func &func, qint64 iterations) {
+		QElapsedTimer timer;
+		timer.start ();
+		
+		for (qint64 i = 0; i < iterations; i++) {
+			func ();
+		}
+		
+		return timer.nsecsElapsed ();
+	}
+	
+	QCoreApplication m_app;
+	const char *m_suite;
+	QString m_outputFile;
+	QJsonArray m_results;
+	
+};
+
+#endif // BENCHMARK_HPP
@@ -16,6 +16,7 @@
 
 #include <QString>
 #include <QtTest>
+#include <QSemaphore>
 #include <QDate>
 
 #define NURIA_NO_VARIANT_COMPARISON
@@ -66,6 +67,32 @@ private slots:
 	void mixBoundWithReordering ();
 	void bindImplicitConversion ();
 	
+	void typedCallMatchingSignature ();
+	void typedCallVoid ();
+	void typedCallConvertsArguments ();
+	void typedCallOnSlot ();
+	void typedCallWithBoundArguments ();
+	
+	void callingLambdaWithLargeCapture ();
+	void bindManyArguments ();
+	void rebindArguments ();
+	
+	void repeatedInvokeWithChangingTypes ();
+	void invokeWithManySignatures ();
+	
+	void callingSlotWithManyArguments ();
+	
+	void invokeAsyncInOtherThread ();
+	void invokeAsyncCanceledIfNeverRun ();
+	void invokeAsyncAfterThreadRestart ();
+	void invokeAsyncInFinishedThread ();
+	
+	void typedCallWithPlaceholders ();
+	void bindFailedConversionUsesDefault ();
+	
+	void callingVariadicWithArgumentView ();
+	void callingVariadicWithArgumentViewFromList ();
+	
 };
 
 
@@ -132,6 +159,11 @@ public slots:
 		return a + b;
 	}
 	
+	int intWithManyArgs (int a, int b, int c, int d, int e, int f,
+	                     int g, int h, int i, int j, int k, int l) {
+		return a + b + c + d + e + f + g + h + i + j + k + l;
+	}
+	
 };
 
 void CallbackTest::callingVoidMemberNoArguments () {
@@ -315,6 +347,245 @@ void CallbackTest::bindImplicitConversion () {
 	QCOMPARE(cb ().toInt (), 2 * 3 + 4);
 }
 
-QTEST_APPLESS_MAIN(CallbackTest)
+void CallbackTest::typedCallMatchingSignature () {
+	Callback cb (staticIntWithArgs);
+	QCOMPARE(cb.call< int > (3, 4), 7);
+}
+
+void CallbackTest::typedCallVoid () {
+	g_result = 0;
+	Callback cb (staticVoidWithArgs);
+	cb.call< void > (3, 4);
+	QCOMPARE(g_result, 7);
+}
+
+void CallbackTest::typedCallConvertsArguments () {
+	Callback cb (staticIntWithArgs);
+	QCOMPARE(cb.call< int > (QString ("3"), 4), 7);
+	QCOMPARE(cb.call< QString > (3, 4), QString ("7"));
+}
+
+void CallbackTest::typedCallOnSlot () {
+	Members m;
+	Callback cb (&m, SLOT(intWithArgs(int,int)));
+	QCOMPARE(cb.call< int > (4, 5), 9);
+}
+
+void CallbackTest::typedCallWithBoundArguments () {
+	Callback cb = Callback (bindMe).bind (2, 3);
+	
+	QTest::ignoreMessage (QtDebugMsg, "2 3 4");
+	QCOMPARE(cb.call< int > (4), 2 * 3 + 4);
+}
+
+void CallbackTest::callingLambdaWithLargeCapture () {
+	QString a ("a"), b ("b"), c ("c"), d ("d"), e ("e"), f ("f"), g ("g"), h ("h");
+	auto l = [=](const QString &x) { return a + b + c + d + e + f + g + h + x; };
+	
+	// Doesn't fit into the in-place storage.
+	Callback cb = Callback::fromLambda (l);
+	QCOMPARE(cb (QString ("i")).toString (), QString ("abcdefghi"));
+}
+
+static QString joinStrings (const QString &a, const QString &b, const QString &c,
+                            const QString &d, const QString &e, const QString &f) {
+	return a + b + c + d + e + f;
+}
+
+void CallbackTest::bindManyArguments () {
+	Callback cb (joinStrings);
+	cb.bind (QString ("a"), QString ("b"), QString ("c"), QString ("d"), QString ("e"));
+	
+	QCOMPARE(cb (QString ("f")).toString (), QString ("abcdef"));
+	QCOMPARE(cb.call< QString > (QString ("g")), QString ("abcdeg"));
+}
+
+void CallbackTest::rebindArguments () {
+	Callback cb (bindMe);
+	cb.bind (1, 2, 3);
+	cb.bind (2, 3);
+	
+	QTest::ignoreMessage (QtDebugMsg, "2 3 4");
+	QCOMPARE(cb (4).toInt (), 2 * 3 + 4);
+}
+
+void CallbackTest::repeatedInvokeWithChangingTypes () {
+	Callback cb (staticIntWithArgs);
+	
+	for (int i = 0; i < 3; i++) {
+		QCOMPARE(cb (1, 2).toInt (), 3);
+		QCOMPARE(cb (QString ("1"), 2).toInt (), 3);
+		QCOMPARE(cb (QVariant (1), QVariant (QString ("2"))).toInt (), 3);
+		QCOMPARE(cb.invoke ({ QString ("1"), 2.0 }).toInt (), 3);
+		QCOMPARE(cb (QVariant (), 2).toInt (), 2);
+	}
+	
+}
+
+void CallbackTest::invokeWithManySignatures () {
+	Callback cb (staticIntWithArgs);
+	QVariantList values { 1, 1u, 1ll, 1ull, 1.0, 1.0f, QString ("1"), QByteArray ("1") };
+	
+	// More signatures than plans are cached per callback.
+	for (int i = 0; i < 2; i++) {
+		for (const QVariant &a : values) {
+			for (const QVariant &b : values) {
+				QCOMPARE(cb.invoke ({ a, b }).toInt (), 2);
+			}
+			
+		}
+		
+	}
+	
+}
+
+void CallbackTest::callingSlotWithManyArguments () {
+	Members m;
+	Callback cb (&m, SLOT(intWithManyArgs(int,int,int,int,int,int,int,int,int,int,int,int)));
+	
+	QVariantList args { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+	QCOMPARE(cb.invoke (args).toInt (), 78);
+}
+
+void CallbackTest::invokeAsyncInOtherThread () {
+	QThread thread;
+	thread.start ();
+	
+	QAtomicPointer< QThread > calledIn;
+	Callback cb = Callback::fromLambda ([&calledIn](int a, int b) {
+		calledIn.storeRelease (QThread::currentThread ());
+		return a + b;
+	});
+	
+	QFuture< QVariant > future = cb.invokeAsync (&thread, 3, 4);
+	future.waitForFinished ();
+	
+	thread.quit ();
+	thread.wait ();
+	
+	QCOMPARE(future.result ().toInt (), 7);
+	QCOMPARE(calledIn.loadAcquire (), &thread);
+}
+
+// Thread without an event loop, thus never running posted events.
+class NoEventLoopThread : public QThread {
+public:
+	QSemaphore semaphore;
+	
+protected:
+	void run () override {
+		semaphore.acquire ();
+	}
+	
+};
+
+void CallbackTest::invokeAsyncCanceledIfNeverRun () {
+	NoEventLoopThread thread;
+	thread.start ();
+	
+	bool called = false;
+	Callback cb = Callback::fromLambda ([&called](int a) {
+		called = true;
+		return a;
+	});
+	
+	QFuture< QVariant > future = cb.invokeAsync (&thread, 1);
+	thread.semaphore.release ();
+	QVERIFY(thread.wait (5000));
+	
+	QVERIFY(future.isFinished ());
+	QVERIFY(future.isCanceled ());
+	QVERIFY(!called);
+}
+
+void CallbackTest::invokeAsyncAfterThreadRestart () {
+	QThread thread;
+	Callback cb = Callback::fromLambda ([](int a, int b) { return a * b; });
+	
+	for (int i = 1; i <= 3; i++) {
+		thread.start ();
+		QFuture< QVariant > future = cb.invokeAsync (&thread, i, 2);
+		future.waitForFinished ();
+		
+		thread.quit ();
+		QVERIFY(thread.wait (5000));
+		QCOMPARE(future.result ().toInt (), i * 2);
+	}
+	
+}
+
+void CallbackTest::invokeAsyncInFinishedThread () {
+	QThread thread;
+	thread.start ();
+	thread.quit ();
+	QVERIFY(thread.wait (5000));
+	
+	bool called = false;
+	Callback cb = Callback::fromLambda ([&called](int a) {
+		called = true;
+		return a;
+	});
+	
+	QFuture< QVariant > future = cb.invokeAsync (&thread, 1);
+	QVERIFY(future.isFinished ());
+	QVERIFY(future.isCanceled ());
+	QVERIFY(!called);
+}
+
+void CallbackTest::typedCallWithPlaceholders () {
+	Callback cb = Callback (bindMe).bind (Callback::_2, 3, Callback::_1);
+	
+	QTest::ignoreMessage (QtDebugMsg, "2 3 4");
+	QCOMPARE(cb.call< int > (4, 2), 2 * 3 + 4);
+	
+	// Needs conversion
+	QTest::ignoreMessage (QtDebugMsg, "2 3 4");
+	QCOMPARE(cb.call< int > (QString ("4"), 2), 2 * 3 + 4);
+	
+	// Missing argument is default constructed
+	QTest::ignoreMessage (QtDebugMsg, "0 3 4");
+	QCOMPARE(cb.call< int > (4), 4);
+}
+
+void CallbackTest::bindFailedConversionUsesDefault () {
+	Callback cb = Callback (bindMe).bind (QDate (2010, 1, 2), 3);
+	
+	QTest::ignoreMessage (QtDebugMsg, "0 3 4");
+	QCOMPARE(cb.call< int > (4), 4);
+}
+
+void CallbackTest::callingVariadicWithArgumentView () {
+	QVariantList result;
+	int first = 0;
+	
+	auto l = [&](const ArgumentView &args) { first = args.value< int > (0); result = args.toList (); };
+	Callback cb = Callback::fromLambda (l, true);
+	
+	cb (123, QVariant (true), QString ("Hello"));
+	QCOMPARE(first, 123);
+	QCOMPARE(result, QVariantList ({ 123, true, QString ("Hello") }));
+}
+
+void CallbackTest::callingVariadicWithArgumentViewFromList () {
+	int count = 0;
+	int type = 0;
+	QString last;
+	
+	auto l = [&](int num, const ArgumentView &args) {
+		count = num + args.count ();
+		type = args.type (0);
+		last = args.at (args.count () - 1).toString ();
+	};
+	
+	Callback cb = Callback::fromLambda (l, true);
+	cb.bind (10, Callback::_1);
+	
+	cb.invoke ({ 1.5, QString ("Hello") });
+	QCOMPARE(count, 12);
+	QCOMPARE(type, int (QMetaType::Double));
+	QCOMPARE(last, QString ("Hello"));
+}
+
+QTEST_GUILESS_MAIN(CallbackTest)
 
 #include "tst_callback.moc"
@@ -0,0 +1,164 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nuria/callbacklist.hpp>
+
+#include <QtTest/QtTest>
+
+using namespace Nuria;
+
+class CallbackListTest : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void invokeEmptyList ();
+	void invokeAllCallbacks ();
+	void argumentsAreConvertedPerSignature ();
+	void invokeInInsertionOrder ();
+	void invokeBoundAndVariadicCallbacks ();
+	void removeCallback ();
+	void addWhileInvoking ();
+	void changeRepeatedlyWhileInvoking ();
+	
+};
+
+void CallbackListTest::invokeEmptyList () {
+	CallbackList list;
+	QVERIFY(list.isEmpty ());
+	
+	list (1, 2);
+	list ();
+}
+
+void CallbackListTest::invokeAllCallbacks () {
+	QStringList calls;
+	CallbackList list;
+	
+	list.add (Callback::fromLambda ([&calls](int a, int b) { calls.append (QString ("a%1").arg (a + b)); }));
+	list.add (Callback::fromLambda ([&calls](int a, int b) { calls.append (QString ("b%1").arg (a * b)); }));
+	list.add (Callback::fromLambda ([&calls](int a, int b) { calls.append (QString ("c%1").arg (a - b)); return a; }));
+	QCOMPARE(list.size (), 3);
+	
+	list (3, 2);
+	QCOMPARE(calls, QStringList ({ "a5", "b6", "c1" }));
+}
+
+void CallbackListTest::argumentsAreConvertedPerSignature () {
+	QVariantList values;
+	CallbackList list;
+	
+	list.add (Callback::fromLambda ([&values](int a) { values.append (a); }));
+	list.add (Callback::fromLambda ([&values](const QString &a) { values.append (a); }));
+	list.add (Callback::fromLambda ([&values](const QVariant &a) { values.append (a); }));
+	list.add (Callback::fromLambda ([&values](int a) { values.append (a + 1); }));
+	
+	list (QString ("5"));
+	QCOMPARE(values, QVariantList ({ 5, QString ("5"), QString ("5"), 6 }));
+	
+	values.clear ();
+	list.invoke ({ 7 });
+	QCOMPARE(values, QVariantList ({ 7, QString ("7"), 7, 8 }));
+}
+
+void CallbackListTest::invokeInInsertionOrder () {
+	QStringList calls;
+	CallbackList list;
+	
+	list.add (Callback::fromLambda ([&calls](int) { calls.append ("a"); }));
+	list.add (Callback::fromLambda ([&calls](const QString &) { calls.append ("b"); }));
+	list.add (Callback::fromLambda ([&calls](int) { calls.append ("c"); }));
+	list.add (Callback::fromLambda ([&calls](int) { calls.append ("d"); }));
+	list.add (Callback::boundLambda ([&calls](int, int) { calls.append ("e"); }, 1));
+	list.add (Callback::fromLambda ([&calls](int) { calls.append ("f"); }));
+	
+	list (1);
+	QCOMPARE(calls, QStringList ({ "a", "b", "c", "d", "e", "f" }));
+}
+
+void CallbackListTest::invokeBoundAndVariadicCallbacks () {
+	QVariantList values;
+	CallbackList list;
+	
+	auto add = [&values](int a, int b) { values.append (a + b); };
+	list.add (Callback::boundLambda (add, 10));
+	
+	Callback variadic = Callback::fromLambda ([&values](const QVariantList &args) { values.append (args.length ()); });
+	variadic.setVariadic (true);
+	list.add (variadic);
+	
+	list (1);
+	QCOMPARE(values, QVariantList ({ 11, 1 }));
+}
+
+void CallbackListTest::removeCallback () {
+	int calls = 0;
+	CallbackList list;
+	
+	int first = list.add (Callback::fromLambda ([&calls]() { calls += 1; }));
+	int second = list.add (Callback::fromLambda ([&calls]() { calls += 10; }));
+	QVERIFY(first != 0);
+	QVERIFY(first != second);
+	
+	QVERIFY(list.remove (first));
+	QVERIFY(!list.remove (first));
+	list ();
+	QCOMPARE(calls, 10);
+	
+	list.clear ();
+	list ();
+	QCOMPARE(calls, 10);
+	QVERIFY(list.isEmpty ());
+}
+
+void CallbackListTest::addWhileInvoking () {
+	int calls = 0;
+	CallbackList list;
+	
+	Callback counter = Callback::fromLambda ([&calls]() { calls++; });
+	list.add (Callback::fromLambda ([&list, &counter]() { list.add (counter); }));
+	
+	// Callbacks added while invoking are invoked from the next time on
+	list ();
+	QCOMPARE(calls, 0);
+	
+	list ();
+	QCOMPARE(calls, 1);
+	QCOMPARE(list.size (), 3);
+}
+
+void CallbackListTest::changeRepeatedlyWhileInvoking () {
+	QStringList calls;
+	CallbackList list;
+	
+	// Each change replaces the list the running invocation is using
+	Callback counter = Callback::fromLambda ([&calls]() { calls.append ("counter"); });
+	list.add (Callback::fromLambda ([&list, &counter]() {
+		for (int i = 0; i < 5; i++) {
+			list.remove (list.add (counter));
+		}
+		
+	}));
+	
+	list.add (Callback::fromLambda ([&calls]() { calls.append ("last"); }));
+	
+	list ();
+	list ();
+	QCOMPARE(calls, QStringList ({ "last", "last" }));
+	QCOMPARE(list.size (), 2);
+}
+
+QTEST_MAIN(CallbackListTest)
+#include "tst_callbacklist.moc"
@@ -18,6 +18,8 @@
 
 #include <QtTest/QtTest>
 #include <QMetaType>
+#include <QTemporaryFile>
+#include <memory>
 #include <QObject>
 #include <QDir>
 
@@ -34,6 +36,13 @@ private slots:
 	void testRun ();
 	
 	void verifyResultOfNoErrorTest ();
+	void lazyParse ();
+	void parseFiles ();
+	void parseFilesReportsFirstError ();
+	void lazyParseDefersMemberErrors ();
+	void loadSnapshotFromData ();
+	void loadSnapshotFromFile ();
+	void loadInvalidSnapshot ();
 	
 };
 
@@ -83,16 +92,11 @@ void JsonMetaObjectReaderTest::testRun () {
 	
 }
 
-void JsonMetaObjectReaderTest::verifyResultOfNoErrorTest () {
+// Verifies the types read from "NoError.json".
+static void verifyNoErrorTypes (Nuria::JsonMetaObjectReader &reader) {
 	static QString headerFile ("foo.h");
 	static QByteArray typeName ("Foo");
 	
-	QByteArray testCaseData = readResourceFile ("NoError.json");
-	Nuria::JsonMetaObjectReader reader;
-	
-	QVERIFY(!testCaseData.isEmpty ());
-	QCOMPARE(Nuria::JsonMetaObjectReader::NoError, reader.parse (testCaseData));
-	
 	// Check file object
 	QStringList files = reader.sourceFiles ();
 	QCOMPARE(1, files.length ());
@@ -188,5 +192,126 @@ void JsonMetaObjectReaderTest::verifyResultOfNoErrorTest () {
 	
 }
 
+void JsonMetaObjectReaderTest::verifyResultOfNoErrorTest () {
+	QByteArray testCaseData = readResourceFile ("NoError.json");
+	Nuria::JsonMetaObjectReader reader;
+	
+	QVERIFY(!testCaseData.isEmpty ());
+	QCOMPARE(Nuria::JsonMetaObjectReader::NoError, reader.parse (testCaseData));
+	verifyNoErrorTypes (reader);
+	
+}
+
+void JsonMetaObjectReaderTest::lazyParse () {
+	Nuria::JsonMetaObjectReader reader;
+	reader.setLazy (true);
+	
+	QVERIFY(reader.isLazy ());
+	QCOMPARE(Nuria::JsonMetaObjectReader::NoError, reader.parse (readResourceFile ("NoError.json")));
+	verifyNoErrorTypes (reader);
+	
+}
+
+void JsonMetaObjectReaderTest::lazyParseDefersMemberErrors () {
+	Nuria::JsonMetaObjectReader reader;
+	reader.setLazy (true);
+	
+	// Type-level errors are still found
+	QCOMPARE(reader.parse (readResourceFile ("BasesContainsNonString.json")),
+		 Nuria::JsonMetaObjectReader::BasesContainsNonString);
+	
+	// Methods are only read on first use
+	QCOMPARE(reader.parse (readResourceFile ("MethodNameIsNotAString.json")),
+		 Nuria::JsonMetaObjectReader::NoError);
+	
+}
+
+// Writes 'data' into a new temporary file.
+static QTemporaryFile *writeTemporaryFile (const QByteArray &data) {
+	QTemporaryFile *file = new QTemporaryFile;
+	file->open ();
+	file->write (data);
+	file->close ();
+	return file;
+}
+
+void JsonMetaObjectReaderTest::parseFiles () {
+	QByteArray other = "{ \"bar.h\": { \"Bar\": { \"annotations\": [], \"bases\": [ \"Foo\" ], "
+			   "\"memberMethods\": [], \"staticMethods\": [], \"constructors\": [], "
+			   "\"enums\": {}, \"fields\": {} } } }";
+	
+	std::unique_ptr< QTemporaryFile > first (writeTemporaryFile (readResourceFile ("NoError.json")));
+	std::unique_ptr< QTemporaryFile > second (writeTemporaryFile (other));
+	
+	Nuria::JsonMetaObjectReader reader;
+	QCOMPARE(reader.parseFiles ({ first->fileName (), second->fileName () }), Nuria::JsonMetaObjectReader::NoError);
+	QCOMPARE(reader.sourceFiles (), QStringList ({ "bar.h", "foo.h" }));
+	QCOMPARE(reader.metaObjects ("bar.h").value ("Bar")->parents (), QVector< QByteArray > { "Foo" });
+	
+	// Register all at once
+	reader.registerMetaObjects ();
+	QCOMPARE(Nuria::MetaObject::byName ("Bar"), reader.metaObjects ("bar.h").value ("Bar"));
+	QCOMPARE(Nuria::MetaObject::typesInheriting ("Foo").keys (), QList< QByteArray > { "Bar" });
+	
+	Nuria::MetaObject *foo = reader.metaObjects ("foo.h").value ("Foo");
+	QCOMPARE(Nuria::MetaObject::byName ("Foo"), foo);
+	
+}
+
+void JsonMetaObjectReaderTest::parseFilesReportsFirstError () {
+	std::unique_ptr< QTemporaryFile > valid (writeTemporaryFile (readResourceFile ("NoError.json")));
+	std::unique_ptr< QTemporaryFile > invalid (writeTemporaryFile (readResourceFile ("FieldIsNotAnObject.json")));
+	
+	Nuria::JsonMetaObjectReader reader;
+	QCOMPARE(reader.parseFiles ({ valid->fileName (), "/does/not/exist", invalid->fileName () }),
+		 Nuria::JsonMetaObjectReader::FileNotReadable);
+	QCOMPARE(reader.parseFiles ({ valid->fileName (), invalid->fileName () }),
+		 Nuria::JsonMetaObjectReader::FieldIsNotAnObject);
+	QVERIFY(reader.sourceFiles ().isEmpty ());
+	
+}
+
+static QByteArray noErrorSnapshot () {
+	Nuria::JsonMetaObjectReader reader;
+	reader.parse (readResourceFile ("NoError.json"));
+	return reader.snapshot ();
+}
+
+void JsonMetaObjectReaderTest::loadSnapshotFromData () {
+	Nuria::JsonMetaObjectReader reader;
+	QCOMPARE(Nuria::JsonMetaObjectReader::NoError, reader.loadSnapshot (noErrorSnapshot ()));
+	verifyNoErrorTypes (reader);
+	
+}
+
+void JsonMetaObjectReaderTest::loadSnapshotFromFile () {
+	QTemporaryFile file;
+	QVERIFY(file.open ());
+	file.write (noErrorSnapshot ());
+	file.close ();
+	
+	Nuria::JsonMetaObjectReader reader;
+	QCOMPARE(Nuria::JsonMetaObjectReader::NoError, reader.loadSnapshot (file.fileName ()));
+	verifyNoErrorTypes (reader);
+	
+	// Snapshots of loaded snapshots are the same
+	QCOMPARE(reader.snapshot (), noErrorSnapshot ());
+	
+}
+
+void JsonMetaObjectReaderTest::loadInvalidSnapshot () {
+	QByteArray snapshot = noErrorSnapshot ();
+	QByteArray truncated = snapshot.left (snapshot.size () - 4);
+	QByteArray wrongMagic = snapshot;
+	wrongMagic[0] = 'X';
+	
+	Nuria::JsonMetaObjectReader reader;
+	QCOMPARE(reader.loadSnapshot (truncated), Nuria::JsonMetaObjectReader::SnapshotIsInvalid);
+	QCOMPARE(reader.loadSnapshot (wrongMagic), Nuria::JsonMetaObjectReader::SnapshotIsInvalid);
+	QCOMPARE(reader.loadSnapshot (QString ("/does/not/exist")), Nuria::JsonMetaObjectReader::SnapshotFileError);
+	QVERIFY(reader.sourceFiles ().isEmpty ());
+	
+}
+
 QTEST_MAIN(JsonMetaObjectReaderTest)
 #include "tst_jsonmetaobjectreader.moc"
@@ -28,6 +28,7 @@ private slots:
 	void verifyOneElement ();
 	void verifyTwoElements ();
 	void verifyPartialTransmission ();
+	void verifyElementData ();
 	
 	void clearStreamBufferDoesNotDiscardElements ();
 	void discardReinitializesReader ();
@@ -122,6 +123,18 @@ void JsonStreamReaderTest::verifyPartialTransmission () {
 	
 }
 
+void JsonStreamReaderTest::verifyElementData () {
+	JsonStreamReader reader;
+	
+	reader.write ("{\"a\":[1]}");
+	QVERIFY(reader.hasPendingElement ());
+	
+	QCOMPARE(reader.nextPendingElementData (), QByteArray ("{\"a\":[1]}"));
+	QVERIFY(!reader.hasPendingElement ());
+	QCOMPARE(reader.nextPendingElementData (), QByteArray ());
+	
+}
+
 void JsonStreamReaderTest::clearStreamBufferDoesNotDiscardElements () {
 	JsonStreamReader reader;
 	QSignalSpy error (&reader, SIGNAL(error()));
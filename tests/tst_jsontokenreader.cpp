@@ -0,0 +1,171 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <nuria/jsontokenreader.hpp>
+
+#include <QtTest/QtTest>
+#include <QJsonDocument>
+#include <QObject>
+
+using namespace Nuria;
+
+class JsonTokenReaderTest : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void readTokens ();
+	void readPlainValues ();
+	void readNumbers ();
+	void readEscapedStrings ();
+	void readValueMatchesQJsonDocument ();
+	void skipValue ();
+	void invalidJson_data ();
+	void invalidJson ();
+	
+};
+
+void JsonTokenReaderTest::readTokens () {
+	JsonTokenReader reader (" { \"a\" : [ 1 , true ], \"b\": {} } ");
+	
+	QCOMPARE(reader.token (), JsonTokenReader::NoToken);
+	QCOMPARE(reader.next (), JsonTokenReader::BeginMap);
+	QCOMPARE(reader.next (), JsonTokenReader::Key);
+	QCOMPARE(reader.string (), QString ("a"));
+	QCOMPARE(reader.next (), JsonTokenReader::BeginList);
+	QCOMPARE(reader.next (), JsonTokenReader::Number);
+	QCOMPARE(reader.next (), JsonTokenReader::Bool);
+	QCOMPARE(reader.next (), JsonTokenReader::EndList);
+	QCOMPARE(reader.next (), JsonTokenReader::Key);
+	QCOMPARE(reader.string (), QString ("b"));
+	QCOMPARE(reader.next (), JsonTokenReader::BeginMap);
+	QCOMPARE(reader.next (), JsonTokenReader::EndMap);
+	QCOMPARE(reader.next (), JsonTokenReader::EndMap);
+	QCOMPARE(reader.next (), JsonTokenReader::EndOfData);
+	QCOMPARE(reader.next (), JsonTokenReader::EndOfData);
+	QVERIFY(!reader.hasError ());
+	QCOMPARE(reader.errorOffset (), -1);
+}
+
+void JsonTokenReaderTest::readPlainValues () {
+	JsonTokenReader reader ("[\"foo\",false,null]");
+	
+	QCOMPARE(reader.next (), JsonTokenReader::BeginList);
+	QCOMPARE(reader.next (), JsonTokenReader::String);
+	QCOMPARE(reader.value (), QVariant ("foo"));
+	QCOMPARE(reader.next (), JsonTokenReader::Bool);
+	QCOMPARE(reader.value (), QVariant (false));
+	QCOMPARE(reader.next (), JsonTokenReader::Null);
+	QVERIFY(!reader.value ().isValid ());
+	QCOMPARE(reader.next (), JsonTokenReader::EndList);
+}
+
+void JsonTokenReaderTest::readNumbers () {
+	JsonTokenReader reader ("[0,-12,9223372036854775807,-9223372036854775808,"
+				"18446744073709551616,1.5,-2e3]");
+				
+	QCOMPARE(reader.next (), JsonTokenReader::BeginList);
+	
+	reader.next ();
+	QCOMPARE(reader.value (), QVariant (0));
+	
+	reader.next ();
+	QCOMPARE(reader.value (), QVariant (-12));
+	
+	reader.next ();
+	QVERIFY(reader.isInteger ());
+	QCOMPARE(reader.toInteger (), std::numeric_limits< qint64 >::max ());
+	QCOMPARE(reader.value ().userType (), int (QMetaType::LongLong));
+	
+	reader.next ();
+	QVERIFY(reader.isInteger ());
+	QCOMPARE(reader.toInteger (), std::numeric_limits< qint64 >::min ());
+	
+	reader.next ();
+	QVERIFY(!reader.isInteger ());
+	QCOMPARE(reader.toDouble (), 18446744073709551616.0);
+	
+	reader.next ();
+	QCOMPARE(reader.value (), QVariant (1.5));
+	
+	reader.next ();
+	QCOMPARE(reader.value (), QVariant (-2000.0));
+	
+	QCOMPARE(reader.next (), JsonTokenReader::EndList);
+}
+
+void JsonTokenReaderTest::readEscapedStrings () {
+	JsonTokenReader reader ("\"a\\\"b\\\\c\\/\\n\\t\\u00e4\\ud83d\\ude00 \xE2\x82\xAC\"");
+	
+	QCOMPARE(reader.next (), JsonTokenReader::String);
+	QCOMPARE(reader.string (), QString::fromUtf8 ("a\"b\\c/\n\t\xC3\xA4\xF0\x9F\x98\x80 \xE2\x82\xAC"));
+	QCOMPARE(reader.next (), JsonTokenReader::EndOfData);
+}
+
+void JsonTokenReaderTest::readValueMatchesQJsonDocument () {
+	QByteArray json = "{\"list\":[1.5,\"two\",{\"three\":null}],\"empty\":{},\"b\":true}";
+	JsonTokenReader reader (json);
+	
+	reader.next ();
+	QVariant value = reader.readValue ();
+	
+	QCOMPARE(reader.token (), JsonTokenReader::EndMap);
+	QCOMPARE(QJsonDocument::fromVariant (value), QJsonDocument::fromJson (json));
+	QCOMPARE(reader.next (), JsonTokenReader::EndOfData);
+}
+
+void JsonTokenReaderTest::skipValue () {
+	JsonTokenReader reader ("[{\"a\":[1,{}]},2]");
+	
+	QCOMPARE(reader.next (), JsonTokenReader::BeginList);
+	QCOMPARE(reader.next (), JsonTokenReader::BeginMap);
+	QVERIFY(reader.skipValue ());
+	QCOMPARE(reader.token (), JsonTokenReader::EndMap);
+	QCOMPARE(reader.next (), JsonTokenReader::Number);
+	QCOMPARE(reader.toInteger (), qint64 (2));
+}
+
+void JsonTokenReaderTest::invalidJson_data () {
+	QTest::addColumn< QByteArray > ("json");
+	QTest::addColumn< int > ("offset");
+	
+	QTest::newRow ("empty") << QByteArray ("") << 0;
+	QTest::newRow ("unclosed map") << QByteArray ("{\"a\":1") << 6;
+	QTest::newRow ("missing colon") << QByteArray ("{\"a\" 1}") << 5;
+	QTest::newRow ("trailing comma") << QByteArray ("[1,]") << 3;
+	QTest::newRow ("wrong bracket") << QByteArray ("[1}") << 2;
+	QTest::newRow ("bad literal") << QByteArray ("[tru]") << 1;
+	QTest::newRow ("leading zero") << QByteArray ("01") << 1;
+	QTest::newRow ("bad escape") << QByteArray ("\"\\x\"") << 1;
+	QTest::newRow ("control char") << QByteArray ("\"a\nb\"") << 2;
+	QTest::newRow ("trailing data") << QByteArray ("{} {}") << 3;
+}
+
+void JsonTokenReaderTest::invalidJson () {
+	QFETCH(QByteArray, json);
+	QFETCH(int, offset);
+	
+	JsonTokenReader reader (json);
+	while (reader.next () != JsonTokenReader::EndOfData && !reader.hasError ());
+	
+	QVERIFY(reader.hasError ());
+	QCOMPARE(reader.token (), JsonTokenReader::Error);
+	QCOMPARE(reader.errorOffset (), offset);
+	QCOMPARE(reader.next (), JsonTokenReader::Error);
+}
+
+QTEST_MAIN(JsonTokenReaderTest)
+#include "tst_jsontokenreader.moc"
@@ -18,6 +18,7 @@
 
 #include <QtTest/QtTest>
 #include <QObject>
+#include <QThread>
 #include <memory>
 
 using namespace Nuria;
@@ -43,6 +44,10 @@ private slots:
 	void testFieldGetter ();
 	void testFieldSetter ();
 	void testReadOnlyField ();
+	void testFieldReadIntoWriteFrom ();
+	
+	void forMetaObjectSharesWrappers ();
+	void concurrentFirstAccess ();
 	
 private:
 	QtMetaObjectWrapper *wrapper;
@@ -206,5 +211,77 @@ void QtMetaObjectWrapperTest::testReadOnlyField () {
 	
 }
 
+void QtMetaObjectWrapperTest::testFieldReadIntoWriteFrom () {
+	QTest::ignoreMessage (QtDebugMsg, "dtor");
+	TestObject obj (123);
+	MetaField a = wrapper->fieldByName ("a");
+	MetaField ro = wrapper->fieldByName ("ro");
+	
+	int value = 0;
+	QVERIFY(a.readInto (&obj, &value, QMetaType::Int));
+	QCOMPARE(value, 123);
+	
+	QString string;
+	QVERIFY(a.readInto (&obj, &string, QMetaType::QString));
+	QCOMPARE(string, QString ("123"));
+	
+	value = 456;
+	QVERIFY(a.writeFrom (&obj, &value, QMetaType::Int));
+	QCOMPARE(obj.m_a, 456);
+	
+	QVERIFY(!ro.writeFrom (&obj, &value, QMetaType::Int));
+	QVERIFY(ro.readInto (&obj, &value, QMetaType::Int));
+	QCOMPARE(value, 456);
+	
+}
+
+void QtMetaObjectWrapperTest::forMetaObjectSharesWrappers () {
+	QtMetaObjectWrapper *first = QtMetaObjectWrapper::forMetaObject (&TestObject::staticMetaObject);
+	QtMetaObjectWrapper *second = QtMetaObjectWrapper::forMetaObject (&TestObject::staticMetaObject);
+	QtMetaObjectWrapper *other = QtMetaObjectWrapper::forMetaObject (&QObject::staticMetaObject);
+	
+	QVERIFY(first);
+	QCOMPARE(first, second);
+	QVERIFY(first != other);
+	QCOMPARE(other->className (), QByteArray ("QObject"));
+	
+}
+
+// Reads the members of a wrapper, counting unexpected results.
+class ReaderThread : public QThread {
+public:
+	ReaderThread (QtMetaObjectWrapper *wrapper, QAtomicInt *mismatches)
+		: wrapper (wrapper), mismatches (mismatches) {}
+	
+	void run () override {
+		if (wrapper->methodCount () != 2 || wrapper->fieldCount () != 2 || wrapper->annotationCount () != 2) {
+			mismatches->ref ();
+		}
+		
+	}
+	
+	QtMetaObjectWrapper *wrapper;
+	QAtomicInt *mismatches;
+};
+
+void QtMetaObjectWrapperTest::concurrentFirstAccess () {
+	QtMetaObjectWrapper fresh (&TestObject::staticMetaObject);
+	QAtomicInt mismatches;
+	
+	QList< ReaderThread * > threads;
+	for (int i = 0; i < 4; i++) {
+		threads.append (new ReaderThread (&fresh, &mismatches));
+		threads.last ()->start ();
+	}
+	
+	for (ReaderThread *thread : threads) {
+		thread->wait ();
+		delete thread;
+	}
+	
+	QCOMPARE(mismatches.load (), 0);
+	
+}
+
 QTEST_MAIN(QtMetaObjectWrapperTest)
 #include "tst_qtmetaobjectwrapper.moc"
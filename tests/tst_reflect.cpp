@@ -0,0 +1,171 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nuria/reflect.hpp>
+
+#include <QtTest/QtTest>
+#include <QObject>
+
+using namespace Nuria;
+
+class ReflectTest : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void unreflectedType ();
+	void forEachFieldVisitsAllFields ();
+	void fieldGetAndSet ();
+	void invokeMethod ();
+	
+	void reflectedMetaObjectFields ();
+	void reflectedMetaObjectMethods ();
+	void reflectedMetaObjectIsRegistered ();
+	void reflectedMetaObjectHasTypeIds ();
+	
+};
+
+struct Point {
+	int x;
+	QString label;
+	
+	int doubled () const { return x * 2; }
+	void moveBy (int delta) { x += delta; }
+};
+
+namespace Nuria {
+template< >
+struct Reflect< Point > : ReflectedType< Point > {
+	static constexpr const char *name () { return "Point"; }
+	
+	template< typename Visitor >
+	static void fields (Visitor &&visit) {
+		visit (NURIA_REFLECT_FIELD(Point, label));
+		visit (NURIA_REFLECT_FIELD(Point, x));
+	}
+	
+	template< typename Visitor >
+	static void methods (Visitor &&visit) {
+		visit (NURIA_REFLECT_METHOD(Point, doubled));
+		visit (NURIA_REFLECT_METHOD(Point, moveBy));
+	}
+	
+};
+}
+
+Q_DECLARE_METATYPE(Point *)
+
+// Collects the names and values of visited fields.
+struct FieldCollector {
+	QStringList *names;
+	QVariantList *values;
+	
+	template< typename T >
+	void operator() (const char *name, const T &value) const {
+		names->append (name);
+		values->append (QVariant::fromValue (value));
+	}
+	
+};
+
+void ReflectTest::unreflectedType () {
+	QVERIFY(!Reflect< QObject >::IsReflected);
+	QVERIFY(Reflect< Point >::IsReflected);
+}
+
+void ReflectTest::forEachFieldVisitsAllFields () {
+	Point point { 5, "five" };
+	QStringList names;
+	QVariantList values;
+	
+	forEachField (point, FieldCollector { &names, &values });
+	QCOMPARE(names, QStringList ({ "label", "x" }));
+	QCOMPARE(values, QVariantList ({ QString ("five"), 5 }));
+	
+	// Works on const objects too
+	const Point &constPoint = point;
+	forEachField (constPoint, FieldCollector { &names, &values });
+	QCOMPARE(names.size (), 4);
+}
+
+void ReflectTest::fieldGetAndSet () {
+	Point point { 1, "" };
+	auto field = NURIA_REFLECT_FIELD(Point, x);
+	
+	QCOMPARE(field.name, "x");
+	QCOMPARE(field.get (point), 1);
+	field.set (point, 7);
+	QCOMPARE(point.x, 7);
+}
+
+void ReflectTest::invokeMethod () {
+	Point point { 3, "" };
+	auto doubled = NURIA_REFLECT_METHOD(Point, doubled);
+	auto moveBy = NURIA_REFLECT_METHOD(Point, moveBy);
+	
+	QCOMPARE(doubled.invoke (point), 6);
+	moveBy.invoke (point, 2);
+	QCOMPARE(point.x, 5);
+}
+
+void ReflectTest::reflectedMetaObjectFields () {
+	MetaObject *meta = reflectedMetaObject< Point > ();
+	Point point { 4, "four" };
+	
+	QCOMPARE(meta->className (), QByteArray ("Point"));
+	QCOMPARE(meta->fieldCount (), 2);
+	QCOMPARE(meta->field (0).name (), QByteArray ("label"));
+	QCOMPARE(meta->field (0).typeName (), QByteArray ("QString"));
+	QCOMPARE(meta->field (1).name (), QByteArray ("x"));
+	QCOMPARE(meta->field (1).typeName (), QByteArray ("int"));
+	
+	QCOMPARE(meta->fieldByName ("x").read (&point), QVariant (4));
+	QVERIFY(meta->fieldByName ("x").write (&point, 9));
+	QCOMPARE(point.x, 9);
+}
+
+void ReflectTest::reflectedMetaObjectMethods () {
+	MetaObject *meta = reflectedMetaObject< Point > ();
+	Point point { 4, "" };
+	
+	QCOMPARE(meta->methodCount (), 2);
+	MetaMethod doubled = meta->method ({ "doubled" });
+	MetaMethod moveBy = meta->method ({ "moveBy", "int" });
+	QVERIFY(doubled.isValid ());
+	QVERIFY(moveBy.isValid ());
+	QCOMPARE(doubled.returnType (), QByteArray ("int"));
+	QCOMPARE(moveBy.returnType (), QByteArray ("void"));
+	
+	moveBy.callback (&point) (3);
+	QCOMPARE(point.x, 7);
+	QCOMPARE(doubled.callback (&point) ().toInt (), 14);
+}
+
+void ReflectTest::reflectedMetaObjectIsRegistered () {
+	MetaObject *meta = reflectedMetaObject< Point > ();
+	QCOMPARE(reflectedMetaObject< Point > (), meta);
+	QCOMPARE(MetaObject::byName ("Point"), meta);
+}
+
+void ReflectTest::reflectedMetaObjectHasTypeIds () {
+	MetaObject *meta = reflectedMetaObject< Point > ();
+	QCOMPARE(meta->pointerMetaTypeId (), qMetaTypeId< Point * > ());
+	QCOMPARE(meta->metaTypeId (), 0);
+	QCOMPARE(MetaObject::of< Point > (), meta);
+	QCOMPARE(MetaObject::byTypeId (qMetaTypeId< Point * > ()), meta);
+}
+
+QTEST_MAIN(ReflectTest)
+#include "tst_reflect.moc"
@@ -15,8 +15,10 @@
  */
 
 #include <nuria/runtimemetaobject.hpp>
+#include <private/enumtable.hpp>
 
 #include <QtTest/QtTest>
+#include <cstddef>
 #include <QObject>
 #include <memory>
 
@@ -37,20 +39,34 @@ private slots:
 	void verifyMethodAnnotations ();
 	void testMethodCreator ();
 	void addMethodReplacesOldWithNewMethodIfNotUnique ();
+	void finalizeSharesEqualElements ();
+	void addAfterFinalizeKeepsElements ();
+	void elementsVisibleBeforeFinalize ();
+	void resolveOverloadedMethod ();
+	void invokeMethodUsingInvoker ();
+	void invokeMethodWithoutInvoker ();
 	
 	void verifyEnumOrdering ();
 	void verifyEnumAnnotations ();
 	void verifyEnumValueOrdering ();
+	void enumAnnotationBounds ();
+	void convertEnumKeysAndValues ();
+	void enumTableWithUnsortedDuplicateKeys ();
 	
 	void verifyFieldOrdering ();
 	void verifyFieldAnnotations ();
 	void testFieldGetter ();
 	void testFieldSetter ();
 	void testReadOnlyField ();
+	void testPlainField ();
 	
 	void findByName ();
 	void findByTypeId ();
 	void findByPointerTypeId ();
+	void registeringAfterLookupIsVisible ();
+	void allTypesContainsRegisteredTypes ();
+	void findTypesInheritingAndWithAnnotation ();
+	void reregisteringDropsOldTypeIds ();
 	
 private:
 	RuntimeMetaObject *testMeta;
@@ -240,6 +256,147 @@ void RuntimeMetaObjectTest::addMethodReplacesOldWithNewMethodIfNotUnique () {
 	
 }
 
+void RuntimeMetaObjectTest::finalizeSharesEqualElements () {
+	RuntimeMetaObject meta ("A");
+	RuntimeMetaObject::AnnotationMap annotations { { "Foo", 1 }, { "Bar", "text" } };
+	
+	for (int i = 0; i < 20; i++) {
+		QByteArray name = "method" + QByteArray::number (i);
+		meta.addMethod (MetaMethod::Method, name, QByteArray ("int"), { QByteArray ("a") },
+				{ QByteArray ("QString") }, annotations, noopCreator);
+	}
+	
+	// 
+	meta.finalize ();
+	QVERIFY(meta.savedBytes () > 0);
+	
+	MetaMethod m = meta.method (5);
+	QCOMPARE(meta.methodCount (), 20);
+	QCOMPARE(m.name (), QByteArray ("method13"));
+	QCOMPARE(m.returnType (), QByteArray ("int"));
+	QCOMPARE(m.argumentTypes (), QVector< QByteArray > { "QString" });
+	QCOMPARE(m.annotationCount (), 2);
+	QCOMPARE(m.annotation (0).name (), QByteArray ("Bar"));
+	QCOMPARE(m.annotation (0).value (), QVariant ("text"));
+	QCOMPARE(m.annotation (1).name (), QByteArray ("Foo"));
+	QCOMPARE(m.annotation (1).value (), QVariant (1));
+}
+
+void RuntimeMetaObjectTest::addAfterFinalizeKeepsElements () {
+	RuntimeMetaObject meta ("A");
+	
+	meta.addEnum ("Enum", { { "Foo", 1 } }, { { "A", 1 }, { "B", 2 } });
+	auto getter = [](void *) { return QVariant (); };
+	meta.addField ("b", "int", { }, getter);
+	meta.finalize ();
+	
+	meta.addField ("a", "int", { }, getter);
+	meta.finalize ();
+	
+	QCOMPARE(meta.fieldCount (), 2);
+	QCOMPARE(meta.field (0).name (), QByteArray ("a"));
+	QCOMPARE(meta.field (1).name (), QByteArray ("b"));
+	QCOMPARE(meta.field (1).access (), MetaField::ReadOnly);
+	
+	MetaEnum e = meta.enumAt (0);
+	QCOMPARE(meta.enumCount (), 1);
+	QCOMPARE(e.elementCount (), 2);
+	QCOMPARE(e.key (1), QByteArray ("B"));
+	QCOMPARE(e.value (1), 2);
+	QCOMPARE(e.annotation (0).value (), QVariant (1));
+}
+
+void RuntimeMetaObjectTest::elementsVisibleBeforeFinalize () {
+	RuntimeMetaObject meta ("A");
+	
+	meta.addMethod (MetaMethod::Method, "foo", "int", { }, { }, { }, noopCreator);
+	meta.addEnum ("Enum", { }, { { "A", 1 } });
+	meta.addField ("b", "int", { }, [](void *) { return QVariant (2); });
+	
+	QCOMPARE(meta.methodCount (), 1);
+	QCOMPARE(meta.method (0).name (), QByteArray ("foo"));
+	QCOMPARE(meta.enumCount (), 1);
+	QCOMPARE(meta.enumAt (0).value (0), 1);
+	QCOMPARE(meta.fieldByName ("b").read (nullptr), QVariant (2));
+	
+	// Elements added after a lookup are visible too
+	meta.addField ("a", "int", { }, [](void *) { return QVariant (1); });
+	QCOMPARE(meta.fieldCount (), 2);
+	QCOMPARE(meta.fieldByName ("a").read (nullptr), QVariant (1));
+	QCOMPARE(meta.fieldByName ("b").read (nullptr), QVariant (2));
+	
+}
+
+void RuntimeMetaObjectTest::resolveOverloadedMethod () {
+	RuntimeMetaObject meta ("A");
+	
+	meta.addMethod (MetaMethod::Method, "foo", "int", { }, { }, { }, noopCreator);
+	meta.addMethod (MetaMethod::Method, "foo", "int", { "a" }, { "int" }, { }, noopCreator);
+	meta.addMethod (MetaMethod::Method, "foo", "int", { "a" }, { "QString" }, { }, noopCreator);
+	meta.addMethod (MetaMethod::Method, "foo", "int", { "a", "b" }, { "int", "int" }, { }, noopCreator);
+	
+	// 
+	meta.finalize ();
+	
+	// Ask twice, the second time is answered by the cache.
+	for (int i = 0; i < 2; i++) {
+		int index = meta.methodIndex ({ "foo", "QString" });
+		QVERIFY(index >= 0);
+		QCOMPARE(meta.method (index).argumentTypes (), QVector< QByteArray > { "QString" });
+		QCOMPARE(meta.methodIndex ({ "foo", "int", "int" }), 3);
+		QCOMPARE(meta.methodIndex ({ "foo" }), 0);
+		QCOMPARE(meta.methodIndex ({ "foo", "double" }), -1);
+		QCOMPARE(meta.methodIndex ({ "bar" }), -1);
+		QVERIFY(!meta.method ({ "foo", "double" }).isValid ());
+	}
+	
+}
+
+static int addToInstance (void *instance, int value) {
+	return *static_cast< int * > (instance) + value;
+}
+
+void RuntimeMetaObjectTest::invokeMethodUsingInvoker () {
+	RuntimeMetaObject meta ("A");
+	meta.addMethod (MetaMethod::Method, "add", "int", { "value" }, { "int" }, { },
+			noopCreator, Callback (addToInstance));
+	
+	// 
+	meta.finalize ();
+	MetaMethod method = meta.method (0);
+	
+	int first = 1;
+	int second = 10;
+	int value = 5;
+	void *args[] = { &value };
+	int types[] = { QMetaType::Int };
+	
+	QCOMPARE(method.invoke (&first, args, types), QVariant (6));
+	QCOMPARE(method.invoke (&second, args, types), QVariant (15));
+	QCOMPARE(method.call< int > (&first, 2), 3);
+}
+
+void RuntimeMetaObjectTest::invokeMethodWithoutInvoker () {
+	RuntimeMetaObject meta ("A");
+	auto creator = [](void *instance, RuntimeMetaObject::InvokeAction) {
+		return Callback::fromLambda ([instance](int value) { return addToInstance (instance, value); });
+	};
+	
+	meta.addMethod (MetaMethod::Method, "add", "int", { "value" }, { "int" }, { }, creator);
+	
+	// 
+	meta.finalize ();
+	MetaMethod method = meta.method (0);
+	
+	int first = 1;
+	int value = 5;
+	void *args[] = { &value };
+	int types[] = { QMetaType::Int };
+	
+	QCOMPARE(method.invoke (&first, args, types), QVariant (6));
+	QCOMPARE(method.call< int > (&first, 2), 3);
+}
+
 void RuntimeMetaObjectTest::verifyEnumOrdering () {
 	RuntimeMetaObject meta ("A");
 	
@@ -287,6 +444,68 @@ void RuntimeMetaObjectTest::verifyEnumValueOrdering () {
 	QCOMPARE(e.value (1), 2);
 }
 
+void RuntimeMetaObjectTest::enumAnnotationBounds () {
+	RuntimeMetaObject meta ("A");
+	
+	meta.addEnum ("Enum", { { "First", 1 }, { "Second", 2 }, { "Second", 3 },
+				{ "Third", 4 } }, { });
+	
+	// 
+	meta.finalize ();
+	
+	MetaEnum e = meta.enumAt (0);
+	QCOMPARE(e.annotationLowerBound ("Second"), 1);
+	QCOMPARE(e.annotationUpperBound ("Second"), 2);
+	QCOMPARE(e.annotationLowerBound ("Third"), 3);
+	QCOMPARE(e.annotationUpperBound ("Third"), 3);
+	QCOMPARE(e.annotationLowerBound ("Fourth"), -1);
+	QCOMPARE(e.annotationUpperBound ("Fourth"), -1);
+}
+
+void RuntimeMetaObjectTest::convertEnumKeysAndValues () {
+	RuntimeMetaObject meta ("A");
+	
+	// Contiguous values, with two keys sharing one value
+	meta.addEnum ("Dense", { }, { { "A", 0 }, { "B", 1 }, { "C", 2 }, { "D", 1 } });
+	
+	// Values too far apart for a plain array
+	meta.addEnum ("Sparse", { }, { { "Low", -100000 }, { "Mid", 7 }, { "High", 1 << 30 } });
+	meta.addEnum ("Empty", { }, { });
+	meta.finalize ();
+	
+	MetaEnum dense = meta.enumByName ("Dense");
+	QCOMPARE(dense.valueToKey (0), QByteArray ("A"));
+	QCOMPARE(dense.valueToKey (1), QByteArray ("B"));
+	QCOMPARE(dense.valueToKey (2), QByteArray ("C"));
+	QCOMPARE(dense.valueToKey (3), QByteArray ());
+	QCOMPARE(dense.valueToKey (-1), QByteArray ());
+	QCOMPARE(dense.keyToValue ("D"), 1);
+	QCOMPARE(dense.keyToValue ("E"), -1);
+	
+	MetaEnum sparse = meta.enumByName ("Sparse");
+	QCOMPARE(sparse.valueToKey (-100000), QByteArray ("Low"));
+	QCOMPARE(sparse.valueToKey (7), QByteArray ("Mid"));
+	QCOMPARE(sparse.valueToKey (1 << 30), QByteArray ("High"));
+	QCOMPARE(sparse.valueToKey (8), QByteArray ());
+	QCOMPARE(sparse.keyToValue ("High"), 1 << 30);
+	QCOMPARE(sparse.keyToValue ("Nope"), -1);
+	
+	MetaEnum empty = meta.enumByName ("Empty");
+	QCOMPARE(empty.valueToKey (0), QByteArray ());
+	QCOMPARE(empty.keyToValue ("A"), -1);
+}
+
+void RuntimeMetaObjectTest::enumTableWithUnsortedDuplicateKeys () {
+	
+	// Back-ends other than RuntimeMetaObject may return keys in any order.
+	Internal::EnumTable table ({ "C", "A", "C", "B" }, { 3, 1, 4, 2 });
+	QCOMPARE(table.indexOfKey ("C"), 0);
+	QCOMPARE(table.indexOfKey ("A"), 1);
+	QCOMPARE(table.indexOfKey ("B"), 3);
+	QCOMPARE(table.indexOfKey ("D"), -1);
+	QCOMPARE(table.indexOfValue (4), 2);
+}
+
 static QVariant noopGetter (void *) { return QVariant (); }
 static bool noopSetter (void *, const QVariant &) { return false; }
 
@@ -377,6 +596,43 @@ void RuntimeMetaObjectTest::testReadOnlyField () {
 	QVERIFY(!f.write (this, 123));
 }
 
+struct PlainData {
+	int number;
+	QString text;
+};
+
+void RuntimeMetaObjectTest::testPlainField () {
+	RuntimeMetaObject meta ("PlainData");
+	
+	meta.addPlainField ("number", "int", { }, offsetof(PlainData, number));
+	meta.addPlainField ("text", "QString", { }, offsetof(PlainData, text), MetaField::ReadOnly);
+	
+	// 
+	meta.finalize ();
+	MetaField number = meta.fieldByName ("number");
+	MetaField text = meta.fieldByName ("text");
+	PlainData data { 5, "foo" };
+	
+	QCOMPARE(number.offset (), int (offsetof(PlainData, number)));
+	QCOMPARE(number.read (&data), QVariant (5));
+	
+	int intValue = 0;
+	QVERIFY(number.readInto (&data, &intValue, QMetaType::Int));
+	QCOMPARE(intValue, 5);
+	
+	QString stringValue;
+	QVERIFY(number.readInto (&data, &stringValue, QMetaType::QString));
+	QCOMPARE(stringValue, QString ("5"));
+	
+	intValue = 7;
+	QVERIFY(number.writeFrom (&data, &intValue, QMetaType::Int));
+	QCOMPARE(data.number, 7);
+	
+	QVERIFY(text.readInto (&data, &stringValue, QMetaType::QString));
+	QCOMPARE(stringValue, QString ("foo"));
+	QVERIFY(!text.writeFrom (&data, &stringValue, QMetaType::QString));
+}
+
 // Move this into a new tst_metaobject?
 void RuntimeMetaObjectTest::findByName () {
 	QCOMPARE(MetaObject::byName ("Test"), (MetaObject *)this->testMeta);
@@ -390,5 +646,55 @@ void RuntimeMetaObjectTest::findByPointerTypeId () {
 	QCOMPARE(MetaObject::byTypeId (qMetaTypeId< Test * > ()), (MetaObject *)this->testMeta);
 }
 
+void RuntimeMetaObjectTest::registeringAfterLookupIsVisible () {
+	QVERIFY(!MetaObject::byName ("LateType"));
+	
+	RuntimeMetaObject *meta = new RuntimeMetaObject ("LateType");
+	meta->finalize ();
+	MetaObject::registerMetaObject (meta);
+	
+	QCOMPARE(MetaObject::byName ("LateType"), (MetaObject *)meta);
+}
+
+void RuntimeMetaObjectTest::allTypesContainsRegisteredTypes () {
+	MetaObjectMap types = MetaObject::allTypes ();
+	QCOMPARE(types.value ("Test"), (MetaObject *)this->testMeta);
+	QVERIFY(types.contains ("LateType"));
+}
+
+void RuntimeMetaObjectTest::findTypesInheritingAndWithAnnotation () {
+	RuntimeMetaObject *meta = new RuntimeMetaObject ("Derived");
+	meta->setBaseClasses ({ "Base" });
+	meta->setAnnotations ({ { "Plugin", true }, { "Plugin", false } });
+	meta->finalize ();
+	MetaObject::registerMetaObject (meta);
+	
+	MetaObjectMap inheriting = MetaObject::typesInheriting ("Base");
+	QCOMPARE(inheriting.size (), 1);
+	QCOMPARE(inheriting.value ("Derived"), (MetaObject *)meta);
+	
+	MetaObjectMap annotated = MetaObject::typesWithAnnotation ("Plugin");
+	QCOMPARE(annotated.size (), 1);
+	QCOMPARE(annotated.value ("Derived"), (MetaObject *)meta);
+	
+	QVERIFY(MetaObject::typesInheriting ("Derived").isEmpty ());
+	QVERIFY(MetaObject::typesWithAnnotation ("Nothing").isEmpty ());
+}
+
+void RuntimeMetaObjectTest::reregisteringDropsOldTypeIds () {
+	RuntimeMetaObject *first = new RuntimeMetaObject ("Reregistered");
+	first->setQtMetaTypeId (QMetaType::QPoint);
+	first->finalize ();
+	MetaObject::registerMetaObject (first);
+	QCOMPARE(MetaObject::byTypeId (QMetaType::QPoint), (MetaObject *)first);
+	
+	RuntimeMetaObject *second = new RuntimeMetaObject ("Reregistered");
+	second->finalize ();
+	MetaObject::registerMetaObject (second);
+	
+	QCOMPARE(MetaObject::byName ("Reregistered"), (MetaObject *)second);
+	QVERIFY(!MetaObject::byTypeId (QMetaType::QPoint));
+}
+
 QTEST_MAIN(RuntimeMetaObjectTest)
 #include "tst_runtimemetaobject.moc"
@@ -14,15 +14,21 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nuria/structuredwriter.hpp>
+#include <nuria/jsontokenreader.hpp>
+#include <nuria/runtimemetaobject.hpp>
 #include <nuria/serializer.hpp>
 
 #include <QtTest/QtTest>
+#include <QJsonDocument>
 #include <QObject>
 
 #include "structures.hpp"
 
 using namespace Nuria;
 
+Q_DECLARE_METATYPE(QString *)
+
 class SerializerTest : public QObject {
 	Q_OBJECT
 public:
@@ -37,6 +43,11 @@ private slots:
 	void serializeWithNuriaConversion ();
 	void serializeWithQtConversion ();
 	void serializeWithCustomConverter ();
+	void serializeAfterChangingExclude ();
+	void serializeAfterChangingAllowedTypes ();
+	void serializePointerField ();
+	void serializeIntoWriter ();
+	void serializeIntoWriterWithFailedField ();
 	
 	void deserializeSimple ();
 	void deserializeComplex ();
@@ -47,6 +58,10 @@ private slots:
 	void deserializeWithQtConversion ();
 	void deserializeWithCustomConverter ();
 	void deserializeUsingConstructor ();
+	void deserializeFromTokenReader ();
+	void deserializeFromTokenReaderWithFailedField ();
+	void deserializeFromTokenReaderUsingConstructor ();
+	void populateFromTokenReaderWithInvalidJson ();
 	
 };
 
@@ -220,6 +235,101 @@ void SerializerTest::serializeWithCustomConverter () {
 	QCOMPARE(result, expected);
 }
 
+void SerializerTest::serializeAfterChangingExclude () {
+	QVariantMap expected { { "digit", 123 }, { "string", "hello" } };
+	Simple simple;
+	
+	simple.digit = 123;
+	simple.string = "hello";
+	
+	// 
+	Serializer serializer;
+	QCOMPARE(serializer.serialize (&simple, "Simple").size (), 4);
+	
+	serializer.setExclude ({ "number", "boolean" });
+	QCOMPARE(serializer.serialize (&simple, "Simple"), expected);
+	
+	serializer.setExclude ({ });
+	QCOMPARE(serializer.serialize (&simple, "Simple").size (), 4);
+}
+
+void SerializerTest::serializeAfterChangingAllowedTypes () {
+	Custom custom;
+	custom.foo = 321;
+	custom.dateTime = QDateTime::currentDateTime ();
+	
+	// 
+	Serializer serializer;
+	QVariantMap result = serializer.serialize (&custom, "Custom");
+	QCOMPARE(result["dateTime"].userType (), int (QMetaType::QString));
+	
+	serializer.setAllowedTypes (QVector< QByteArray > { "QDateTime" });
+	result = serializer.serialize (&custom, "Custom");
+	QCOMPARE(result["dateTime"].userType (), int (QMetaType::QDateTime));
+	QCOMPARE(result["dateTime"].toDateTime (), custom.dateTime);
+}
+
+static bool dereferenceString (QVariant &variant, int toType) {
+	if (variant.userType () != qMetaTypeId< QString * > () || toType != QMetaType::QString) {
+		return false;
+	}
+	
+	variant = *variant.value< QString * > ();
+	return true;
+}
+
+void SerializerTest::serializePointerField () {
+	QVariantMap expected { { "text", "hello" } };
+	QString text ("hello");
+	qRegisterMetaType< QString * > ();
+	
+	RuntimeMetaObject meta ("WithPointer");
+	meta.addField ("text", "QString*", { }, [&text](void *) { return QVariant::fromValue (&text); });
+	meta.finalize ();
+	
+	// The pointer must not be stored as-is, even though QString is allowed.
+	Serializer serializer (Serializer::defaultMetaObjectFinder, Serializer::defaultInstanceCreator,
+	                       dereferenceString);
+	QVariantMap result = serializer.serialize (&text, &meta);
+	
+	QCOMPARE(result, expected);
+	QVERIFY(serializer.failedFields ().isEmpty ());
+}
+
+void SerializerTest::serializeIntoWriter () {
+	Complex complex;
+	complex.simple.digit = 123;
+	complex.simple.string = "hello";
+	complex.simple.number = 12.5f;
+	complex.simple.boolean = true;
+	complex.outer = 42;
+	
+	// 
+	Serializer serializer;
+	serializer.setRecursionDepth (Serializer::InfiniteRecursion);
+	QVariantMap expected = serializer.serialize (&complex, "Complex");
+	
+	QByteArray result;
+	JsonWriter writer (&result);
+	QVERIFY(serializer.serialize (&complex, "Complex", writer));
+	QCOMPARE(QJsonDocument::fromJson (result), QJsonDocument::fromVariant (expected));
+}
+
+void SerializerTest::serializeIntoWriterWithFailedField () {
+	Fail fail;
+	fail.works = true;
+	fail.someList.append (123);
+	
+	// 
+	QByteArray result;
+	JsonWriter writer (&result);
+	Serializer serializer;
+	
+	QVERIFY(!serializer.serialize (&fail, "Fail", writer));
+	QCOMPARE(result, QByteArray ("{\"works\":true}"));
+	QCOMPARE(serializer.failedFields (), QStringList { "someList" });
+}
+
 void SerializerTest::deserializeSimple () {
 	QVariantMap data { { "digit", 123 }, { "string", "hello" },
 			   { "number", 12.34f }, { "boolean", true } };
@@ -391,5 +501,65 @@ void SerializerTest::deserializeUsingConstructor () {
 	delete constr;
 }
 
+void SerializerTest::deserializeFromTokenReader () {
+	JsonTokenReader reader ("{\"outer\":42,\"unknown\":[1,{}],\"simple\":{\"digit\":123,"
+				"\"string\":\"hello\",\"number\":12.5,\"boolean\":true}}");
+	
+	// 
+	Serializer serializer;
+	serializer.setRecursionDepth (Serializer::InfiniteRecursion);
+	Complex *result = (Complex *)serializer.deserialize (reader, "Complex");
+	
+	QVERIFY(result);
+	QCOMPARE(reader.token (), JsonTokenReader::EndMap);
+	QCOMPARE(result->outer, 42);
+	QCOMPARE(result->simple.digit, 123);
+	QCOMPARE(result->simple.string, QString ("hello"));
+	QCOMPARE(result->simple.number, 12.5f);
+	QCOMPARE(result->simple.boolean, true);
+	QVERIFY(serializer.failedFields ().isEmpty ());
+	
+	delete result;
+}
+
+void SerializerTest::deserializeFromTokenReaderWithFailedField () {
+	JsonTokenReader reader ("{\"works\":true,\"someList\":[1,2,3]}");
+	
+	// 
+	Serializer serializer;
+	Fail *fail = (Fail *)serializer.deserialize (reader, "Fail");
+	
+	QVERIFY(fail);
+	QCOMPARE(fail->works, true);
+	QVERIFY(fail->someList.isEmpty ());
+	QCOMPARE(serializer.failedFields (), QStringList { "someList" });
+	
+	delete fail;
+}
+
+void SerializerTest::deserializeFromTokenReaderUsingConstructor () {
+	JsonTokenReader reader ("{\"integer\":123,\"string\":\"foo\"}");
+	Serializer serializer;
+	
+	QTest::ignoreMessage (QtDebugMsg, "int 123");
+	WithConstructor *constr = (WithConstructor *)serializer.deserialize (reader, "WithConstructor");
+	
+	QVERIFY(constr);
+	QCOMPARE(constr->integer, 123);
+	QCOMPARE(constr->string, QString ("foo"));
+	
+	delete constr;
+}
+
+void SerializerTest::populateFromTokenReaderWithInvalidJson () {
+	JsonTokenReader reader ("{\"digit\":123,\"string\":}");
+	Serializer serializer;
+	Simple simple;
+	
+	QVERIFY(!serializer.populate (&simple, "Simple", reader));
+	QVERIFY(reader.hasError ());
+	QCOMPARE(simple.digit, 123);
+}
+
 QTEST_MAIN(SerializerTest)
 #include "tst_serializer.moc"
@@ -0,0 +1,174 @@
+/* Copyright (c) 2014-2015, The Nuria Project
+ * The NuriaProject Framework is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the License,
+ * or (at your option) any later version.
+ * 
+ * The NuriaProject Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with The NuriaProject Framework.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <nuria/structuredwriter.hpp>
+
+#include <QtTest/QtTest>
+#include <QJsonDocument>
+#include <QBuffer>
+#include <QObject>
+#include <limits>
+
+using namespace Nuria;
+
+class StructuredWriterTest : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void jsonPlainValues ();
+	void jsonDoubles ();
+	void jsonEscapesStrings ();
+	void jsonNestedVariant ();
+	void jsonIntoDevice ();
+	
+	void cborIntegers ();
+	void cborStrings ();
+	void cborSimpleValues ();
+	void cborMapAndList ();
+	
+};
+
+void StructuredWriterTest::jsonPlainValues () {
+	QByteArray result;
+	
+	{
+		JsonWriter writer (&result);
+		writer.beginList ();
+		writer.writeNull ();
+		writer.writeBool (true);
+		writer.writeBool (false);
+		writer.writeInt (-123);
+		writer.writeInt (std::numeric_limits< qint64 >::min ());
+		writer.writeUInt (std::numeric_limits< quint64 >::max ());
+		writer.writeString ("foo");
+		writer.writeBytes ("bar");
+		writer.endList ();
+	}
+	
+	QCOMPARE(result, QByteArray ("[null,true,false,-123,-9223372036854775808,"
+				     "18446744073709551615,\"foo\",\"bar\"]"));
+}
+
+void StructuredWriterTest::jsonDoubles () {
+	QByteArray result;
+	JsonWriter writer (&result);
+	writer.beginList ();
+	writer.writeDouble (2.0);
+	writer.writeDouble (-0.5);
+	writer.writeDouble (qQNaN ());
+	writer.writeDouble (qInf ());
+	writer.endList ();
+	
+	QCOMPARE(result, QByteArray ("[2,-0.5,null,null]"));
+}
+
+void StructuredWriterTest::jsonEscapesStrings () {
+	QString string = QString::fromUtf8 ("a\"b\\c\n\t\x01 \xC3\xA4 \xE2\x82\xAC \xF0\x9F\x98\x80");
+	QByteArray result;
+	
+	JsonWriter writer (&result);
+	writer.beginList ();
+	writer.writeString (string);
+	writer.endList ();
+	
+	QCOMPARE(result, QByteArray ("[\"a\\\"b\\\\c\\n\\t\\u0001 \xC3\xA4 \xE2\x82\xAC \xF0\x9F\x98\x80\"]"));
+	QCOMPARE(QJsonDocument::fromJson (result).toVariant (), QVariant (QVariantList { string }));
+}
+
+void StructuredWriterTest::jsonNestedVariant () {
+	QVariantMap map {
+		{ "list", QVariantList { 1, "two", QVariantMap { { "three", 3 } } } },
+		{ "strings", QStringList { "a", "b" } },
+		{ "empty", QVariantMap () },
+		{ "number", 1.5 },
+		{ "boolean", true }
+	};
+	
+	QByteArray result;
+	JsonWriter writer (&result);
+	writer.writeVariant (map);
+	
+	QCOMPARE(result, QJsonDocument::fromVariant (map).toJson (QJsonDocument::Compact));
+}
+
+void StructuredWriterTest::jsonIntoDevice () {
+	QBuffer buffer;
+	buffer.open (QIODevice::WriteOnly);
+	
+	QString string (StructuredWriter::BufferSize, QLatin1Char ('x'));
+	QByteArray quoted = "\"" + string.toLatin1 () + "\"";
+	QByteArray expected = "[" + quoted + "," + quoted + "]";
+	
+	JsonWriter writer (&buffer);
+	writer.beginList ();
+	writer.writeString (string);
+	writer.writeString (string);
+	writer.endList ();
+	
+	QVERIFY(buffer.data ().length () >= StructuredWriter::BufferSize);
+	QVERIFY(writer.flush ());
+	QCOMPARE(buffer.data (), expected);
+	QVERIFY(!writer.hasError ());
+}
+
+void StructuredWriterTest::cborIntegers () {
+	QByteArray result;
+	CborWriter writer (&result);
+	writer.writeUInt (0);
+	writer.writeUInt (23);
+	writer.writeUInt (24);
+	writer.writeUInt (500);
+	writer.writeUInt (70000);
+	writer.writeUInt (Q_UINT64_C(0x100000000));
+	writer.writeInt (-1);
+	writer.writeInt (-500);
+	
+	QCOMPARE(result.toHex (), QByteArray ("00" "17" "1818" "1901f4" "1a00011170"
+					      "1b0000000100000000" "20" "3901f3"));
+}
+
+void StructuredWriterTest::cborStrings () {
+	QByteArray result;
+	CborWriter writer (&result);
+	writer.writeString ("a");
+	writer.writeString (QString::fromUtf8 ("\xC3\xBC"));
+	writer.writeBytes (QByteArray ("\x01\x02", 2));
+	
+	QCOMPARE(result.toHex (), QByteArray ("6161" "62c3bc" "420102"));
+}
+
+void StructuredWriterTest::cborSimpleValues () {
+	QByteArray result;
+	CborWriter writer (&result);
+	writer.writeBool (false);
+	writer.writeBool (true);
+	writer.writeNull ();
+	writer.writeDouble (1.5);
+	
+	QCOMPARE(result.toHex (), QByteArray ("f4" "f5" "f6" "fb3ff8000000000000"));
+}
+
+void StructuredWriterTest::cborMapAndList () {
+	QByteArray result;
+	CborWriter writer (&result);
+	writer.writeVariant (QVariantMap { { "a", QVariantList { 1, -2 } } });
+	
+	QCOMPARE(result.toHex (), QByteArray ("bf" "6161" "9f" "01" "21" "ff" "ff"));
+}
+
+QTEST_MAIN(StructuredWriterTest)
+#include "tst_structuredwriter.moc"